@@ -0,0 +1,294 @@
+/*
+	Many agents planned in parallel over one shared map
+
+	A warehouse of shelf rows with aisles between them, and agents that
+	each have a cell to reach.  Every cycle plans a path for every agent
+	from scratch and moves it a few steps along, the planning spread over
+	a work-stealing pool of threads (dpool.h).  The map is one DMap that
+	no task writes to; each worker has one index planner, which holds all
+	the search state, and takes the agent to plan for through the
+	callbacks' data.  Nothing else is shared, so the cycles give the same
+	paths with any number of threads.
+
+	The cycles are run with 1, 2, 4, ... threads up to the maximum, and
+	for each it reports the plans per second, the speedup over one thread
+	and the tasks stolen between workers.
+
+	build:	cc -O2 -o dagents dagents.c dstar.c dmap.c dtrace.c dpool.c -lm -lpthread
+	usage:	dagents [-n agents] [-c cycles] [-t maxthreads] [-l] [size]
+
+	-n sets the number of agents (default 128), -c the cycles (default
+	10) and -t the most threads (default the number of processors); -l
+	plans with D* Lite.  size is the side of the square map (default
+	500).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "dstar.h"
+#include "dmap.h"
+#include "dpool.h"
+
+int gblGridX;
+int gblGridY;
+DMap *gblMap;
+
+#define CELL(x, y) ((int64_t)(y) * gblGridX + (x))
+
+// one agent: where it is, where it is going and what its last plan found
+typedef struct {
+	int64_t at;
+	int64_t goal;
+	double pathcost;
+	int64_t expanded;
+} Agent;
+
+// what a worker plans with; the callbacks get this as their data
+typedef struct {
+	DStarPlanner *planner;
+	Agent *agent;			// the one being planned for
+} Worker;
+
+typedef struct {
+	Agent *agent;
+	Worker *worker;
+	int steps;			// taken along each path per cycle
+} Cycle;
+
+// the callbacks of the index planners: the map is shared, the robot is
+// the agent of the worker
+double cellCost(int64_t to, int64_t from, void *data);
+double cellCost(int64_t to, int64_t from, void *data) {
+	return(DMapStepCost(gblMap, to, from));
+}
+
+double cellH(int64_t cell, void *data);
+double cellH(int64_t cell, void *data) {
+	Worker *w = (Worker *)data;
+	double dx, dy;
+
+	dx = w->agent->at % gblGridX - cell % gblGridX;
+	dy = w->agent->at / gblGridX - cell / gblGridX;
+
+	return(sqrt(dx*dx + dy*dy));
+}
+
+int cellRobot(int64_t cell, void *data);
+int cellRobot(int64_t cell, void *data) {
+	return(cell == ((Worker *)data)->agent->at);
+}
+
+int cellNeighbors(int64_t cell, int64_t *neighbor, void *data);
+int cellNeighbors(int64_t cell, int64_t *neighbor, void *data) {
+	int deltax[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+	int deltay[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+	int i, x, y, n;
+
+	n = 0;
+	for(i=0;i<8;i++) {
+		x = cell % gblGridX + deltax[i];
+		y = cell / gblGridX + deltay[i];
+		if(x >= 0 && x < gblGridX && y >= 0 && y < gblGridY)
+			neighbor[n++] = CELL(x, y);
+	}
+
+	return(n);
+}
+
+double now(void);
+double now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec + 1e-9 * ts.tv_nsec);
+}
+
+// rows of shelves two cells deep with an aisle every 20 cells, and a
+// clear band around the edge
+void warehouse(int size);
+void warehouse(int size) {
+	int x, y;
+
+	for(y=4;y<size-4;y+=5) {
+		for(x=4;x<size-4;x+=20)
+			DMapAddRect(gblMap, y + 1, x, y, x + 15 < size - 5 ? x + 15 : size - 5);
+	}
+}
+
+// a free cell at random
+int64_t freeCell(void);
+int64_t freeCell(void) {
+	int x, y;
+
+	do {
+		x = rand() % gblGridX;
+		y = rand() % gblGridY;
+	} while(DMapOccupied(gblMap, x, y));
+
+	return(CELL(x, y));
+}
+
+// Plans a path for agent i from scratch, then moves it along; an agent at
+// its goal is given a new one.  The goal for the next cycle is drawn from
+// the agent's own numbers so that it does not depend on the order the
+// tasks run in.
+void planAgent(int64_t i, int worker, void *arg);
+void planAgent(int64_t i, int worker, void *arg) {
+	Cycle *cycle = (Cycle *)arg;
+	Worker *w = &cycle->worker[worker];
+	Agent *a = &cycle->agent[i];
+	double costR[2] = {DMAP_OBSTACLE, DMAP_OBSTACLE};
+	int64_t path, cell, parent;
+	int step;
+
+	w->agent = a;
+	DStarPlannerRobotAtIndex(w->planner, a->at);
+	DStarPlannerSearchIndex(w->planner, &a->goal, 1, costR, &path);
+	a->expanded = DStarPlannerExpanded(w->planner);
+
+	a->pathcost = 0.0;
+	for(cell=a->at;(parent = DStarPlannerParent(w->planner, cell)) >= 0;cell=parent)
+		a->pathcost += cellCost(parent, cell, NULL);
+
+	for(step=0;step<cycle->steps && (parent = DStarPlannerParent(w->planner, a->at)) >= 0;step++)
+		a->at = parent;
+	if(a->at == a->goal) {
+		do
+			a->goal = (a->goal * 2654435761u + i) % ((int64_t)gblGridX * gblGridY);
+		while(DMapOccupiedCell(gblMap, a->goal));
+	}
+}
+
+int main(int argc, char *argv[]) {
+	int size = 500, numAgents = 128, numCycles = 10, maxThreads, threads, i, c;
+	int engine = DSTAR_ENGINE_DSTAR;
+	DStarIndexCallbacks icb;
+	DStarParams params;
+	Agent *start, *agent;
+	Worker *worker;
+	Cycle cycle;
+	DPool *pool;
+	double t, base = 0.0, total, check, firstCheck = 0.0;
+	int64_t expanded, stolen;
+
+	maxThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	for(argc--,argv++;argc>0;argc--,argv++) {
+		if(argc > 1 && strcmp(argv[0], "-n") == 0) {
+			numAgents = atoi(argv[1]);
+			argc--, argv++;
+		}
+		else if(argc > 1 && strcmp(argv[0], "-c") == 0) {
+			numCycles = atoi(argv[1]);
+			argc--, argv++;
+		}
+		else if(argc > 1 && strcmp(argv[0], "-t") == 0) {
+			maxThreads = atoi(argv[1]);
+			argc--, argv++;
+		}
+		else if(strcmp(argv[0], "-l") == 0)
+			engine = DSTAR_ENGINE_LITE;
+		else if(argc == 1 && argv[0][0] != '-')
+			size = atoi(argv[0]);
+		else {
+			printf("usage: dagents [-n agents] [-c cycles] [-t maxthreads] [-l] [size]\n");
+			return(1);
+		}
+	}
+	if(size < 20 || numAgents < 1 || numCycles < 1 || maxThreads < 1) {
+		printf("size must be at least 20 and the counts at least 1\n");
+		return(1);
+	}
+
+	gblGridX = gblGridY = size;
+	gblMap = DMapCreate(size, size);
+	start = (Agent *)malloc(sizeof(Agent) * numAgents);
+	agent = (Agent *)malloc(sizeof(Agent) * numAgents);
+	worker = (Worker *)calloc(maxThreads, sizeof(Worker));
+	if(gblMap == NULL || start == NULL || agent == NULL || worker == NULL) {
+		printf("Not enough memory\n");
+		return(1);
+	}
+	warehouse(size);
+	srand(1);
+	for(i=0;i<numAgents;i++) {
+		start[i].at = freeCell();
+		start[i].goal = freeCell();
+	}
+
+	// one planner per worker, each with the worker as its callbacks' data
+	DStarDefaultParams(&params);
+	params.maxExpand = 0;
+	params.engine = engine;
+	icb.hcalc = cellH;
+	icb.robotNode = cellRobot;
+	icb.neighbors = cellNeighbors;
+	icb.cost = cellCost;
+	icb.printNode = NULL;
+	icb.pruneNeighbors = NULL;
+	for(i=0;i<maxThreads;i++) {
+		icb.data = &worker[i];
+		worker[i].planner = DStarPlannerCreateIndex(&icb, (int64_t)size * size, &params);
+		if(worker[i].planner == NULL) {
+			printf("Not enough memory for %d planners\n", maxThreads);
+			return(1);
+		}
+	}
+	printf("%d x %d warehouse, %d agents, %d cycles, %.1f MB per worker\n", size, size, numAgents, numCycles,
+	       DStarPlannerBytes(worker[0].planner) / 1e6);
+
+	for(threads=1;;threads*=2) {
+		if(threads > maxThreads)
+			threads = maxThreads;
+
+		pool = DPoolCreate(threads);
+		if(pool == NULL) {
+			printf("Unable to start %d threads\n", threads);
+			return(1);
+		}
+
+		// every thread count starts the agents from the same cells
+		memcpy(agent, start, sizeof(Agent) * numAgents);
+		cycle.agent = agent;
+		cycle.worker = worker;
+		cycle.steps = size / 20;
+		expanded = stolen = 0;
+		check = 0.0;
+		t = now();
+		for(c=0;c<numCycles;c++) {
+			DPoolRun(pool, planAgent, numAgents, &cycle);
+			for(i=0;i<numAgents;i++) {
+				expanded += agent[i].expanded;
+				check += agent[i].pathcost;
+			}
+			for(i=0;i<threads;i++)
+				stolen += DPoolStolen(pool, i);
+		}
+		total = now() - t;
+		if(threads == 1) {
+			base = total;
+			firstCheck = check;
+		}
+
+		printf("%3d threads %10.0f plans/s %12.0f expanded/s  speedup %5.2f  stolen %6" PRId64 "%s\n",
+		       threads, numAgents * numCycles / total, expanded / total, base / total, stolen,
+		       check == firstCheck ? "" : "  paths differ from 1 thread");
+		DPoolDestroy(pool);
+
+		if(threads == maxThreads)
+			break;
+	}
+
+	for(i=0;i<maxThreads;i++)
+		DStarPlannerDestroy(worker[i].planner);
+	free(worker);
+	free(agent);
+	free(start);
+	DMapDestroy(gblMap);
+
+	return(0);
+}
@@ -0,0 +1,546 @@
+/*
+	Benchmark for the kinds of D* planner
+
+	Plans across a W x H grid scattered with rectangular obstacles with
+	three planners, each running both search engines, D* and D* Lite:
+
+	node	a Node struct per cell, function pointer callbacks
+	compact	an index planner that keeps the node state in its own
+		compact arrays, function pointer callbacks
+	inline	the same arrays in a planner generated from dstarinline.h,
+		with the callbacks expanded into the search at compile time
+	pruned	the compact planner with the neighbor pruning of dmap.h
+
+	For each it reports the memory per cell, the expansion rate of the
+	initial search and the expansions and latency of a replan after an
+	obstacle drops onto the path.  Built with -DDSTAR_STATS it also
+	counts the nodes put on OPEN, and how many fewer pruning puts there.  With -e it runs the scenario of dmain.c
+	instead: the 60 x 20 grid, its obstacles and robot move, repeated reps
+	times.
+
+	build:	cc -O2 -o dbench dbench.c dstar.c dmap.c dtrace.c -lm
+	usage:	dbench [width height [obstacles [seed]]]
+		dbench -e [reps]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include <time.h>
+#include "dstar.h"
+#include "dmap.h"
+
+int gblGridX = 1000;
+int gblGridY = 1000;
+int gblGoal[2];
+int gblRobot[2];
+int gblStart[2];		// where the robot is for the initial search
+int gblMove[2];			// where it is for the replan
+DMap *gblMap;
+Node *gblGrid;
+
+#define CELL(x, y) ((int64_t)(y) * gblGridX + (x))
+
+// cell index callbacks, shared by all the planners
+double cellCost(int64_t to, int64_t from, void *data);
+double cellCost(int64_t to, int64_t from, void *data) {
+	return(DMapStepCost(gblMap, to, from));
+}
+
+double cellH(int64_t cell, void *data);
+double cellH(int64_t cell, void *data) {
+	double dx, dy;
+
+	dx = gblRobot[0] - cell % gblGridX;
+	dy = gblRobot[1] - cell / gblGridX;
+
+	return(sqrt(dx*dx + dy*dy));
+}
+
+int cellRobot(int64_t cell, void *data);
+int cellRobot(int64_t cell, void *data) {
+	return(cell == CELL(gblRobot[0], gblRobot[1]));
+}
+
+int cellNeighbors(int64_t cell, int64_t *neighbor, void *data);
+int cellNeighbors(int64_t cell, int64_t *neighbor, void *data) {
+	int deltax[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+	int deltay[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+	int i, x, y, n;
+
+	n = 0;
+	for(i=0;i<8;i++) {
+		x = cell % gblGridX + deltax[i];
+		y = cell / gblGridX + deltay[i];
+		if(x >= 0 && x < gblGridX && y >= 0 && y < gblGridY)
+			neighbor[n++] = CELL(x, y);
+	}
+
+	return(n);
+}
+
+int cellPrune(int64_t cell, int64_t parent, int64_t *neighbor, int *numKept, void *data);
+int cellPrune(int64_t cell, int64_t parent, int64_t *neighbor, int *numKept, void *data) {
+	return(DMapPruneNeighbors(gblMap, cell, parent, neighbor, numKept));
+}
+
+// the Node callbacks just use the id, which is the cell index
+double nodeCost(Node *to, Node *from, void *data);
+double nodeCost(Node *to, Node *from, void *data) {
+	return(cellCost(to->id, from->id, data));
+}
+
+double nodeH(Node *p, void *data);
+double nodeH(Node *p, void *data) {
+	return(cellH(p->id, data));
+}
+
+int nodeRobot(Node *p, void *data);
+int nodeRobot(Node *p, void *data) {
+	return(cellRobot(p->id, data));
+}
+
+int nodeNeighbors(Node *p, Node **neighbor, void *data);
+int nodeNeighbors(Node *p, Node **neighbor, void *data) {
+	int64_t cell[8];
+	int i, n;
+
+	n = cellNeighbors(p->id, cell, data);
+	for(i=0;i<n;i++)
+		neighbor[i] = &(gblGrid[cell[i]]);
+
+	return(n);
+}
+
+// the cell callbacks again, as compile-time policies
+#define DSI_NAME(x) grid##x
+#define DSI_DATA void
+#define DSI_NEIGHBORS(d, n, buf) cellNeighbors((n), (buf), (d))
+#define DSI_COST(d, to, from) cellCost((to), (from), (d))
+#define DSI_HCALC(d, n) cellH((n), (d))
+#define DSI_ROBOT(d, n) cellRobot((n), (d))
+#include "dstarinline.h"
+
+double now(void);
+double now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec + 1e-9 * ts.tv_nsec);
+}
+
+#define NODE 0
+#define COMPACT 1
+#define INLINE 2
+#define PRUNED 3
+#define NUMKINDS 4
+
+// the kinds that are DStarPlannerCreateIndex planners
+#define INDEX(kind) ((kind) == COMPACT || (kind) == PRUNED)
+
+#define NUMENGINES 2
+
+typedef struct {
+	double bytes;
+	int64_t expanded[2];
+	int64_t opened[2];		// inserts and reinserts, -1 without DSTAR_STATS
+	double seconds[2];
+	double pathcost;
+} Result;
+
+// the planner being run, one of these is set
+DStarPlanner *gblPlanner;
+gridPlanner *gblInline;
+
+// backpointer of a cell, -1 if none
+int64_t parentCell(int kind, int64_t cell);
+int64_t parentCell(int kind, int64_t cell) {
+	if(kind == INLINE)
+		return(gridPlannerParent(gblInline, cell));
+	if(INDEX(kind))
+		return(DStarPlannerParent(gblPlanner, cell));
+	return(gblGrid[cell].parent == NULL ? -1 : ((Node *)gblGrid[cell].parent)->id);
+}
+
+// copy of the node of a cell
+void cellNode(int kind, int64_t cell, Node *node);
+void cellNode(int kind, int64_t cell, Node *node) {
+	if(kind == INLINE)
+		gridPlannerNode(gblInline, cell, node);
+	else if(INDEX(kind))
+		DStarPlannerNode(gblPlanner, cell, node);
+	else
+		*node = gblGrid[cell];
+}
+
+// the initial search from the goal; returns the nodes expanded
+int64_t search(int kind, double costR[2]);
+int64_t search(int kind, double costR[2]) {
+	int64_t goalCell, pathCell;
+	Node *seed, *path;
+
+	goalCell = CELL(gblGoal[0], gblGoal[1]);
+	if(kind == INLINE) {
+		gridPlannerSearch(gblInline, &goalCell, 1, costR, &pathCell);
+		return(gridPlannerExpanded(gblInline));
+	}
+	if(INDEX(kind))
+		DStarPlannerSearchIndex(gblPlanner, &goalCell, 1, costR, &pathCell);
+	else {
+		gblGrid[goalCell].g = 0.0;
+		seed = &(gblGrid[goalCell]);
+		DStarPlannerSearch(gblPlanner, &seed, 1, costR, &path);
+	}
+	return(DStarPlannerExpanded(gblPlanner));
+}
+
+// the replan from the changed cells; returns the nodes expanded
+int64_t replan(int kind, int64_t *seedCell, Node **seed, int64_t numSeeds, double costR[2]);
+int64_t replan(int kind, int64_t *seedCell, Node **seed, int64_t numSeeds, double costR[2]) {
+	int64_t pathCell;
+	Node *path;
+
+	if(kind == INLINE) {
+		gridPlannerReplan(gblInline, seedCell, numSeeds, costR, &pathCell);
+		return(gridPlannerExpanded(gblInline));
+	}
+	if(INDEX(kind))
+		DStarPlannerReplanIndex(gblPlanner, seedCell, numSeeds, costR, &pathCell);
+	else
+		DStarPlannerReplan(gblPlanner, seed, numSeeds, costR, &path);
+	return(DStarPlannerExpanded(gblPlanner));
+}
+
+// nodes the last call put on OPEN, -1 if they were not counted
+int64_t opened(int kind);
+int64_t opened(int kind) {
+	DStarStats stats;
+
+	if(kind == INLINE) {
+		if(gridPlannerStats(gblInline, &stats) < 0)
+			return(-1);
+	}
+	else if(DStarPlannerStats(gblPlanner, &stats) < 0)
+		return(-1);
+	return(stats.inserts + stats.reinserts);
+}
+
+// Runs the initial search and the replan reps times with one kind of
+// planner and one engine
+int run(int kind, int engine, int64_t *wall, int64_t numWall, int reps, Result *result);
+int run(int kind, int engine, int64_t *wall, int64_t numWall, int reps, Result *result) {
+	DStarCallbacks cb;
+	DStarIndexCallbacks icb;
+	DStarParams params;
+	Node **seed, robotNode;
+	int64_t *seedCell, cell, numCells, numSeeds, i;
+	double costR[2], t;
+	int rep;
+
+	numCells = (int64_t)gblGridX * gblGridY;
+
+	DStarDefaultParams(&params);
+	params.maxExpand = 0;
+	params.engine = engine;
+
+	seed = (Node **)malloc(sizeof(Node *) * (numWall + 1));
+	seedCell = (int64_t *)malloc(sizeof(int64_t) * (numWall + 1));
+
+	gblPlanner = NULL;
+	gblInline = NULL;
+	if(kind == INLINE)
+		gblInline = gridPlannerCreate(NULL, numCells, &params);
+	else if(INDEX(kind)) {
+		icb.hcalc = cellH;
+		icb.robotNode = cellRobot;
+		icb.neighbors = cellNeighbors;
+		icb.cost = cellCost;
+		icb.printNode = NULL;
+		icb.pruneNeighbors = kind == PRUNED ? cellPrune : NULL;
+		icb.data = NULL;
+		gblPlanner = DStarPlannerCreateIndex(&icb, numCells, &params);
+	}
+	else {
+		gblGrid = (Node *)calloc(numCells, sizeof(Node));
+		cb.gcalc = NULL;
+		cb.hcalc = nodeH;
+		cb.robotNode = nodeRobot;
+		cb.neighbors = nodeNeighbors;
+		cb.cost = nodeCost;
+		cb.printNode = NULL;
+		cb.pruneNeighbors = NULL;
+		cb.data = NULL;
+		gblPlanner = DStarPlannerCreate(&cb, &params);
+	}
+	if((gblPlanner == NULL && gblInline == NULL) || (kind == NODE && gblGrid == NULL)) {
+		printf("Not enough memory\n");
+		return(-1);
+	}
+
+	// the node grid is paged in when it is reset below; page in the
+	// compact arrays the same way with an untimed search
+	gblRobot[0] = gblStart[0];
+	gblRobot[1] = gblStart[1];
+	DMapSettle(gblMap);
+	if(kind != NODE) {
+		costR[0] = costR[1] = 1e+7;
+		search(kind, costR);
+	}
+
+	result->seconds[0] = result->seconds[1] = 0.0;
+	for(rep=0;rep<reps;rep++) {
+		gblRobot[0] = gblStart[0];
+		gblRobot[1] = gblStart[1];
+		if(kind == NODE) {
+			// a new search would leave what the last one had on
+			// OPEN closed, so start from a new planner
+			DStarPlannerDestroy(gblPlanner);
+			gblPlanner = DStarPlannerCreate(&cb, &params);
+			for(cell=0;cell<numCells;cell++) {
+				gblGrid[cell].id = cell;
+				gblGrid[cell].state = NEW;
+				gblGrid[cell].parent = NULL;
+			}
+		}
+
+		// initial search, on a map with nothing changed since
+		costR[0] = costR[1] = 1e+7;
+		DMapSettle(gblMap);
+		t = now();
+		result->expanded[0] = search(kind, costR);
+		result->seconds[0] += now() - t;
+		result->opened[0] = opened(kind);
+
+		// drop the wall and move the robot, then replan from the wall
+		// cells that were on the tree
+		for(i=0;i<numWall;i++)
+			DMapSetCell(gblMap, wall[i], 1);
+		for(numSeeds=0,i=0;i<numWall;i++) {
+			if(parentCell(kind, wall[i]) >= 0) {
+				seedCell[numSeeds] = wall[i];
+				seed[numSeeds++] = kind == NODE ? &(gblGrid[wall[i]]) : NULL;
+			}
+		}
+		gblRobot[0] = gblMove[0];
+		gblRobot[1] = gblMove[1];
+		cell = CELL(gblRobot[0], gblRobot[1]);
+		if(kind == INLINE)
+			gridPlannerRobotAt(gblInline, cell);
+		else if(INDEX(kind))
+			DStarPlannerRobotAtIndex(gblPlanner, cell);
+		else
+			DStarPlannerRobotAt(gblPlanner, &(gblGrid[cell]));
+
+		cellNode(kind, CELL(gblRobot[0], gblRobot[1]), &robotNode);
+		costR[0] = robotNode.state == NEW ? 1e+7 : robotNode.f;
+		costR[1] = robotNode.state == NEW ? 1e+7 : robotNode.g;
+
+		t = now();
+		result->expanded[1] = replan(kind, seedCell, seed, numSeeds, costR);
+		result->seconds[1] += now() - t;
+		result->opened[1] = opened(kind);
+
+		// cost of the path the robot would now follow
+		result->pathcost = 0.0;
+		for(cell=CELL(gblRobot[0], gblRobot[1]); parentCell(kind, cell) >= 0; cell=parentCell(kind, cell))
+			result->pathcost += cellCost(parentCell(kind, cell), cell, NULL);
+
+		// put the grid back for the next run
+		for(i=0;i<numWall;i++)
+			DMapSetCell(gblMap, wall[i], 0);
+	}
+
+	if(kind == INLINE)
+		result->bytes = gridPlannerBytes(gblInline);
+	else
+		result->bytes = DStarPlannerBytes(gblPlanner);
+	// a Node per cell plus the x/y NodeInfo the example allocates
+	if(kind == NODE)
+		result->bytes += (double)numCells * (sizeof(Node) + 2 * sizeof(int));
+
+	gridPlannerDestroy(gblInline);
+	DStarPlannerDestroy(gblPlanner);
+	free(gblGrid);
+	gblGrid = NULL;
+	free(seed);
+	free(seedCell);
+
+	result->seconds[0] /= reps;
+	result->seconds[1] /= reps;
+
+	return(0);
+}
+
+// The scenario of dmain.c: two obstacles, then a third drops in while the
+// robot moves from (10, 5) to (12, 15)
+int64_t example(int64_t *wall);
+int64_t example(int64_t *wall) {
+	int obstacle[3][4] = {{17, 15, 0, 17}, {12, 5, 10, 15}, {18, 30, 10, 35}};
+	int64_t numWall;
+	int i, x, y;
+
+	gblGridX = 60;
+	gblGridY = 20;
+	gblGoal[0] = 50;
+	gblGoal[1] = 15;
+	gblStart[0] = 10;
+	gblStart[1] = 5;
+	gblMove[0] = 12;
+	gblMove[1] = 15;
+
+	gblMap = DMapCreate(gblGridX, gblGridY);
+	if(gblMap == NULL)
+		return(-1);
+	for(i=0;i<2;i++)
+		DMapAddRect(gblMap, obstacle[i][0], obstacle[i][1], obstacle[i][2], obstacle[i][3]);
+
+	numWall = 0;
+	for(y=obstacle[2][2];y<=obstacle[2][0];y++) {
+		for(x=obstacle[2][1];x<=obstacle[2][3];x++)
+			wall[numWall++] = CELL(x, y);
+	}
+
+	return(numWall);
+}
+
+// A grid scattered with random rectangles, and a wall across the middle
+int64_t scatter(int numObstacles, unsigned int seed, int64_t *wall);
+int64_t scatter(int numObstacles, unsigned int seed, int64_t *wall) {
+	int64_t numWall;
+	int i, x, y, w, h, m;
+
+	// goal near one corner, robot near the other
+	gblGoal[0] = gblGridX - 1 - gblGridX / 20;
+	gblGoal[1] = gblGridY - 1 - gblGridY / 20;
+	gblStart[0] = gblMove[0] = gblGridX / 20;
+	gblStart[1] = gblMove[1] = gblGridY / 20;
+
+	// scatter obstacles, keeping the goal and robot free
+	gblMap = DMapCreate(gblGridX, gblGridY);
+	if(gblMap == NULL)
+		return(-1);
+	srand(seed);
+	for(i=0;i<numObstacles;i++) {
+		w = 1 + rand() % (gblGridX / 20 + 1);
+		h = 1 + rand() % (gblGridY / 20 + 1);
+		x = rand() % gblGridX;
+		y = rand() % gblGridY;
+		DMapAddRect(gblMap, y + h - 1, x, y, x + w - 1);
+	}
+	DMapClearRect(gblMap, gblGoal[1] + gblGridY / 20, gblGoal[0] - gblGridX / 20,
+		      gblGoal[1] - gblGridY / 20, gblGoal[0] + gblGridX / 20);
+	DMapClearRect(gblMap, gblStart[1] + gblGridY / 20, gblStart[0] - gblGridX / 20,
+		      gblStart[1] - gblGridY / 20, gblStart[0] + gblGridX / 20);
+
+	// the wall that appears before the replan: a bar across the middle
+	// of the grid's diagonal, perpendicular to it
+	numWall = 0;
+	m = (gblGridX < gblGridY ? gblGridX : gblGridY) / 4;
+	for(i=-m;i<=m;i++) {
+		x = gblGridX / 2 + i;
+		y = gblGridY / 2 - i;
+		if(x >= 0 && x < gblGridX && y >= 0 && y < gblGridY && !DMapOccupied(gblMap, x, y)) {
+			wall[numWall++] = CELL(x, y);
+			// diagonal walls leak, so make it two cells thick
+			if(x + 1 < gblGridX && !DMapOccupied(gblMap, x + 1, y))
+				wall[numWall++] = CELL(x + 1, y);
+		}
+	}
+
+	return(numWall);
+}
+
+int main(int argc, char *argv[]) {
+	int numObstacles = 200;
+	unsigned int seed = 1;
+	int reps = 1;
+	int64_t numCells, *wall, numWall;
+	int i, e;
+	Result result[NUMENGINES][NUMKINDS];
+	char *name[NUMKINDS] = {"node", "compact", "inline", "pruned"};
+	char *engineName[NUMENGINES] = {"D*", "D*Lite"};
+
+	if(argc > 1 && strcmp(argv[1], "-e") == 0) {
+		reps = argc > 2 ? atoi(argv[2]) : 10000;
+		if(reps < 1) {
+			printf("reps must be at least 1\n");
+			return(1);
+		}
+		wall = (int64_t *)malloc(sizeof(int64_t) * 60 * 20);
+		numWall = example(wall);
+	}
+	else {
+		if(argc > 2) {
+			gblGridX = atoi(argv[1]);
+			gblGridY = atoi(argv[2]);
+		}
+		if(argc > 3)
+			numObstacles = atoi(argv[3]);
+		if(argc > 4)
+			seed = atoi(argv[4]);
+		if(gblGridX < 20 || gblGridY < 20) {
+			printf("The grid must be at least 20 x 20\n");
+			return(1);
+		}
+		wall = (int64_t *)malloc(sizeof(int64_t) * ((int64_t)gblGridX + gblGridY + 2));
+		numWall = scatter(numObstacles, seed, wall);
+	}
+	if(wall == NULL || numWall < 0) {
+		printf("Not enough memory for the map\n");
+		return(1);
+	}
+	numCells = (int64_t)gblGridX * gblGridY;
+
+	for(e=0;e<NUMENGINES;e++) {
+		for(i=0;i<NUMKINDS;i++) {
+			if(run(i, e, wall, numWall, reps, &result[e][i]) < 0)
+				return(1);
+		}
+	}
+
+	if(reps > 1)
+		printf("\ndmain scenario, %d x %d grid, mean of %d runs\n", gblGridX, gblGridY, reps);
+	else
+		printf("\n%d x %d grid, %d obstacles, seed %u\n", gblGridX, gblGridY, numObstacles, seed);
+	printf("%-7s %-8s %10s %10s %12s %14s %12s %12s %10s\n", "engine", "planner", "MB", "bytes/cell",
+	       "expanded", "expanded/s", "replanned", "replan ms", "pathcost");
+	for(e=0;e<NUMENGINES;e++) {
+		for(i=0;i<NUMKINDS;i++) {
+			printf("%-7s %-8s %10.3f %10.1f %12" PRId64 " %14.0f %12" PRId64 " %12.4f %10.2f\n",
+			       engineName[e], name[i],
+			       result[e][i].bytes / 1e6, result[e][i].bytes / numCells,
+			       result[e][i].expanded[0], result[e][i].expanded[0] / result[e][i].seconds[0],
+			       result[e][i].expanded[1], 1e3 * result[e][i].seconds[1],
+			       result[e][i].pathcost);
+		}
+	}
+	printf("compact uses %.1f%% of the node memory, %+.1f%% expansion rate on the initial search\n",
+	       100.0 * result[0][COMPACT].bytes / result[0][NODE].bytes,
+	       100.0 * ((result[0][COMPACT].expanded[0] / result[0][COMPACT].seconds[0]) /
+			(result[0][NODE].expanded[0] / result[0][NODE].seconds[0]) - 1.0));
+	printf("inline runs %.2fx the compact expansion rate on the initial search, %.2fx on the replan\n",
+	       (result[0][INLINE].expanded[0] / result[0][INLINE].seconds[0]) /
+	       (result[0][COMPACT].expanded[0] / result[0][COMPACT].seconds[0]),
+	       (result[0][INLINE].expanded[1] / result[0][INLINE].seconds[1]) /
+	       (result[0][COMPACT].expanded[1] / result[0][COMPACT].seconds[1]));
+	if(result[0][COMPACT].opened[0] >= 0) {
+		printf("pruning puts %.1f%% as many nodes on OPEN on the initial search, %.1f%% on the replan\n",
+		       100.0 * result[0][PRUNED].opened[0] / result[0][COMPACT].opened[0],
+		       100.0 * result[0][PRUNED].opened[1] / result[0][COMPACT].opened[1]);
+		printf("D* Lite: %.1f%% on the initial search, %.1f%% on the replan\n",
+		       100.0 * result[1][PRUNED].opened[0] / result[1][COMPACT].opened[0],
+		       100.0 * result[1][PRUNED].opened[1] / result[1][COMPACT].opened[1]);
+	}
+	printf("D* Lite on the compact planner replans with %.1f%% of the D* expansions in %.2fx the time,"
+	       " using %.1f%% of its memory\n",
+	       100.0 * result[1][COMPACT].expanded[1] / result[0][COMPACT].expanded[1],
+	       result[1][COMPACT].seconds[1] / result[0][COMPACT].seconds[1],
+	       100.0 * result[1][COMPACT].bytes / result[0][COMPACT].bytes);
+
+	free(wall);
+	DMapDestroy(gblMap);
+
+	return(0);
+}
@@ -0,0 +1,254 @@
+/*
+	Checks of the planner on small grids
+
+	Each check sets up a case a change to the planner once got wrong,
+	runs it with both kinds of planner, and prints one line per run, ok
+	or FAILED with what was wrong.  The exit status is the number of
+	failed runs, so it can be run after every change.
+
+	stale h	D*: the robot cannot be reached, so the search returns
+		NOPATH, then the robot moves and the goal goes on OPEN
+		again, by a replan or a new search.  The goal's h must be
+		the one from where the robot is now, not the one cached
+		from where it was.
+
+	build:	cc -O2 -o dcheck dcheck.c dstar.c dmap.c dtrace.c -lm
+	usage:	dcheck
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <math.h>
+#include "dstar.h"
+#include "dmap.h"
+
+int gblGridX = 10;
+int gblGridY = 10;
+int gblRobot[2];
+DMap *gblMap;
+Node *gblGrid;
+
+#define CELL(x, y) ((int64_t)(y) * gblGridX + (x))
+
+// the callbacks of the index planner; occupied cells are not neighbors,
+// so a walled-in cell cannot be reached at all
+double cellCost(int64_t to, int64_t from, void *data);
+double cellCost(int64_t to, int64_t from, void *data) {
+	return(DMapStepCost(gblMap, to, from));
+}
+
+double cellH(int64_t cell, void *data);
+double cellH(int64_t cell, void *data) {
+	double dx, dy;
+
+	dx = gblRobot[0] - cell % gblGridX;
+	dy = gblRobot[1] - cell / gblGridX;
+
+	return(sqrt(dx*dx + dy*dy));
+}
+
+int cellRobot(int64_t cell, void *data);
+int cellRobot(int64_t cell, void *data) {
+	return(cell == CELL(gblRobot[0], gblRobot[1]));
+}
+
+int cellNeighbors(int64_t cell, int64_t *neighbor, void *data);
+int cellNeighbors(int64_t cell, int64_t *neighbor, void *data) {
+	int deltax[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+	int deltay[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+	int i, x, y, n;
+
+	n = 0;
+	for(i=0;i<8;i++) {
+		x = cell % gblGridX + deltax[i];
+		y = cell / gblGridX + deltay[i];
+		if(x >= 0 && x < gblGridX && y >= 0 && y < gblGridY && !DMapOccupied(gblMap, x, y))
+			neighbor[n++] = CELL(x, y);
+	}
+
+	return(n);
+}
+
+// the same for a planner on Node structs, one per cell of gblGrid
+double nodeCost(Node *to, Node *from, void *data);
+double nodeCost(Node *to, Node *from, void *data) {
+	return(cellCost(to->id, from->id, data));
+}
+
+double nodeG(Node *p, void *data);
+double nodeG(Node *p, void *data) {
+	Node *q = (Node *)p->parent;
+
+	return(q == NULL ? 0.0 : q->g + nodeCost(q, p, data));
+}
+
+double nodeH(Node *p, void *data);
+double nodeH(Node *p, void *data) {
+	return(cellH(p->id, data));
+}
+
+int nodeRobot(Node *p, void *data);
+int nodeRobot(Node *p, void *data) {
+	return(cellRobot(p->id, data));
+}
+
+int nodeNeighbors(Node *p, Node **neighbor, void *data);
+int nodeNeighbors(Node *p, Node **neighbor, void *data) {
+	int64_t cell[8];
+	int i, n;
+
+	n = cellNeighbors(p->id, cell, data);
+	for(i=0;i<n;i++)
+		neighbor[i] = &gblGrid[cell[i]];
+
+	return(n);
+}
+
+// a D* planner of either kind, NULL if there is not enough memory
+DStarPlanner *newPlanner(int compact);
+DStarPlanner *newPlanner(int compact) {
+	DStarCallbacks cb;
+	DStarIndexCallbacks icb;
+	DStarParams params;
+	int64_t i;
+
+	DStarDefaultParams(&params);
+	params.maxExpand = 0;
+
+	if(compact) {
+		icb.hcalc = cellH;
+		icb.robotNode = cellRobot;
+		icb.neighbors = cellNeighbors;
+		icb.cost = cellCost;
+		icb.printNode = NULL;
+		icb.pruneNeighbors = NULL;
+		icb.data = NULL;
+		return(DStarPlannerCreateIndex(&icb, (int64_t)gblGridX * gblGridY, &params));
+	}
+
+	for(i=0;i<(int64_t)gblGridX * gblGridY;i++) {
+		gblGrid[i].id = i;
+		gblGrid[i].state = NEW;
+		gblGrid[i].parent = NULL;
+		gblGrid[i].g = 0.0;
+	}
+	cb.gcalc = nodeG;
+	cb.hcalc = nodeH;
+	cb.robotNode = nodeRobot;
+	cb.neighbors = nodeNeighbors;
+	cb.cost = nodeCost;
+	cb.printNode = NULL;
+	cb.pruneNeighbors = NULL;
+	cb.data = NULL;
+	return(DStarPlannerCreate(&cb, &params));
+}
+
+// search from the goal, 0 for g; the Node planner searches again from the
+// Node structs the last search left
+int search(DStarPlanner *planner, int compact, int64_t goal, int replan);
+int search(DStarPlanner *planner, int compact, int64_t goal, int replan) {
+	double costR[2] = {1e+7, 1e+7};
+	int64_t pathCell;
+	Node *path, *seed;
+
+	if(compact) {
+		if(replan)
+			return(DStarPlannerReplanIndex(planner, &goal, 1, costR, &pathCell));
+		return(DStarPlannerSearchIndex(planner, &goal, 1, costR, &pathCell));
+	}
+
+	seed = &gblGrid[goal];
+	seed->g = 0.0;
+	if(replan)
+		return(DStarPlannerReplan(planner, &seed, 1, costR, &path));
+	return(DStarPlannerSearch(planner, &seed, 1, costR, &path));
+}
+
+// h the planner holds for a cell
+double heldH(DStarPlanner *planner, int compact, int64_t cell);
+double heldH(DStarPlanner *planner, int compact, int64_t cell) {
+	Node node;
+
+	if(!compact)
+		return(gblGrid[cell].h);
+	DStarPlannerNode(planner, cell, &node);
+
+	return(node.h);
+}
+
+// stale h: a search that finds no path, a move, then a replan or a new
+// search from the same goal
+int staleH(int compact, int replan);
+int staleH(int compact, int replan) {
+	DStarPlanner *planner;
+	int64_t goal;
+	int status;
+	double h, want;
+
+	// the robot starts walled in at (1, 1)
+	gblRobot[0] = gblRobot[1] = 1;
+	goal = CELL(8, 8);
+
+	planner = newPlanner(compact);
+	if(planner == NULL) {
+		printf("Not enough memory for a planner\n");
+		return(1);
+	}
+	status = search(planner, compact, goal, 0);
+	if(status != DSTAR_NOPATH) {
+		printf("stale h  %-5s %-6s FAILED: the first search gave %d, not NOPATH\n",
+		       compact ? "index" : "node", replan ? "replan" : "search", status);
+		DStarPlannerDestroy(planner);
+		return(1);
+	}
+
+	gblRobot[0] = 6;
+	gblRobot[1] = 6;
+	if(compact)
+		DStarPlannerRobotAtIndex(planner, CELL(gblRobot[0], gblRobot[1]));
+	else
+		DStarPlannerRobotAt(planner, &gblGrid[CELL(gblRobot[0], gblRobot[1])]);
+	search(planner, compact, goal, replan);
+
+	h = heldH(planner, compact, goal);
+	want = cellH(goal, NULL);
+	DStarPlannerDestroy(planner);
+
+	if(fabs(h - want) > 1e-9) {
+		printf("stale h  %-5s %-6s FAILED: goal h %.3lf, not %.3lf\n",
+		       compact ? "index" : "node", replan ? "replan" : "search", h, want);
+		return(1);
+	}
+	printf("stale h  %-5s %-6s ok\n", compact ? "index" : "node", replan ? "replan" : "search");
+
+	return(0);
+}
+
+int main(int argc, char *argv[]) {
+	int compact, replan, x, y, failed = 0;
+
+	gblMap = DMapCreate(gblGridX, gblGridY);
+	gblGrid = (Node *)calloc((size_t)gblGridX * gblGridY, sizeof(Node));
+	if(gblMap == NULL || gblGrid == NULL) {
+		printf("Not enough memory for a %d x %d grid\n", gblGridX, gblGridY);
+		return(1);
+	}
+
+	// wall in (1, 1)
+	for(x=0;x<=2;x++) {
+		for(y=0;y<=2;y++) {
+			if(x != 1 || y != 1)
+				DMapSetCell(gblMap, CELL(x, y), 1);
+		}
+	}
+
+	for(compact=0;compact<=1;compact++) {
+		for(replan=0;replan<=1;replan++)
+			failed += staleH(compact, replan);
+	}
+
+	printf("%d failed\n", failed);
+
+	return(failed);
+}
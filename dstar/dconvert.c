@@ -0,0 +1,276 @@
+/*
+	Converts a raster map to a binary costmap
+
+	Reads a PGM image, binary (P5) or plain (P2), or an ASCII grid, and
+	writes the costmap file of dcostmap.h that a planner maps at startup
+	instead of parsing the raster again.  The first row of the input is
+	the top of the map, so it becomes the highest y, with the origin in
+	the lower left as in the examples.
+
+	A PGM pixel's darkness is 1 - value / maxval.  Darker than the
+	occupied threshold is lethal, lighter than the free threshold costs 0,
+	and in between the cost rises in a line from 1 to 254.
+
+	An ASCII grid is one line per row, either bare or after the header of
+	the grid benchmark .map files ("type", "height", "width", "map").
+	'.', 'G', 'S' and ' ' are free, a digit d costs 28 d, and anything else
+	('@', 'O', 'T', 'W', '#', ...) is lethal.  Short rows are padded with
+	free cells to the longest.
+
+	build:	cc -O2 -o dconvert dconvert.c dcostmap.c
+	usage:	dconvert [-t tile] [-o occupied] [-f free] input output
+
+	-t tiles the raster in tile x tile squares (a power of two from 8 to
+	4096; default 0, row-major).  -o and -f set the PGM thresholds
+	(defaults 0.65 and 0.196).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <inttypes.h>
+#include "dcostmap.h"
+
+double gblOccupied = 0.65;
+double gblFree = 0.196;
+
+// the next number of a PGM header, skipping white space and comments; -1
+// at the end of the file
+long pgmNumber(FILE *fp);
+long pgmNumber(FILE *fp) {
+	long n;
+	int c;
+
+	for(;;) {
+		c = getc(fp);
+		if(c == '#') {
+			while(c != '\n' && c != EOF)
+				c = getc(fp);
+		}
+		if(c == EOF)
+			return(-1);
+		if(isdigit(c))
+			break;
+	}
+	for(n=0;isdigit(c);c=getc(fp))
+		n = n * 10 + c - '0';
+
+	return(n);
+}
+
+// cost of a PGM pixel
+int pixelCost(long value, long maxval);
+int pixelCost(long value, long maxval) {
+	double dark = 1.0 - (double)value / maxval;
+
+	if(dark >= gblOccupied)
+		return(DCOSTMAP_LETHAL);
+	if(dark <= gblFree)
+		return(0);
+
+	return(1 + (int)(253.0 * (dark - gblFree) / (gblOccupied - gblFree)));
+}
+
+// cost of a character of an ASCII grid
+int charCost(int c);
+int charCost(int c) {
+	if(c == '.' || c == 'G' || c == 'S' || c == ' ')
+		return(0);
+	if(isdigit(c))
+		return(28 * (c - '0'));
+
+	return(DCOSTMAP_LETHAL);
+}
+
+// A PGM image after its magic number; the rows are read one at a time, so
+// the image is never all in memory
+int convertPGM(FILE *fp, int binary, char *output, int tile);
+int convertPGM(FILE *fp, int binary, char *output, int tile) {
+	long width, height, maxval, value;
+	unsigned char *row;
+	DCostMap *map;
+	int64_t lethal = 0;
+	int x, y, size, early = 0;
+
+	width = pgmNumber(fp);
+	height = pgmNumber(fp);
+	maxval = pgmNumber(fp);
+	if(width <= 0 || height <= 0 || width > INT32_MAX || height > INT32_MAX || maxval <= 0 || maxval > 65535) {
+		printf("Bad PGM header\n");
+		return(1);
+	}
+	if(width < 3) {
+		printf("The image is %ld pixels wide; a costmap needs at least 3\n", width);
+		return(1);
+	}
+
+	// the single white space character after maxval has been read
+	size = maxval > 255 ? 2 : 1;
+	row = (unsigned char *)malloc((size_t)width * size);
+	map = DCostMapCreate(output, (int)width, (int)height, tile);
+	if(row == NULL || map == NULL) {
+		printf("Unable to create %s: %s\n", output, strerror(errno));
+		return(1);
+	}
+
+	for(y=(int)height-1;y>=0;y--) {
+		if(binary && fread(row, size, width, fp) != (size_t)width) {
+			early = 1;
+			break;
+		}
+		for(x=0;x<width;x++) {
+			if(!binary)
+				value = pgmNumber(fp);
+			else if(size == 2)
+				value = (row[2*x] << 8) | row[2*x+1];
+			else
+				value = row[x];
+			if(value < 0) {
+				early = 1;
+				y = 0;
+				break;
+			}
+			DCostMapSetCell(map, (int64_t)y * width + x, pixelCost(value, maxval));
+			lethal += pixelCost(value, maxval) == DCOSTMAP_LETHAL;
+		}
+	}
+	DCostMapClose(map);
+	free(row);
+
+	// what was converted of a short image is no map of it
+	if(early) {
+		printf("The image ends early\n");
+		remove(output);
+		return(1);
+	}
+	printf("%ld x %ld, %" PRId64 " lethal cells\n", width, height, lethal);
+
+	return(0);
+}
+
+// An ASCII grid.  Its size is not known until the end, so it is read into
+// memory first.
+int convertASCII(FILE *fp, char *output, int tile);
+int convertASCII(FILE *fp, char *output, int tile) {
+	char *text = NULL, *line, *next;
+	size_t bytes = 0, capacity = 0, n;
+	long width = 0, height = 0, length, x, y;
+	DCostMap *map;
+	int64_t lethal = 0;
+
+	do {
+		if(bytes + 65536 > capacity) {
+			capacity = 2 * capacity + 65536;
+			text = (char *)realloc(text, capacity + 1);
+			if(text == NULL) {
+				printf("Not enough memory for the grid\n");
+				return(1);
+			}
+		}
+		n = fread(text + bytes, 1, capacity - bytes, fp);
+		bytes += n;
+	} while(n > 0);
+	text[bytes] = 0;
+
+	// skip the .map header, which ends with the line "map"
+	line = text;
+	if(strncmp(line, "type", 4) == 0) {
+		for(;*line;line=next) {
+			next = strchr(line, '\n');
+			next = next == NULL ? line + strlen(line) : next + 1;
+			if(strncmp(line, "map", 3) == 0) {
+				line = next;
+				break;
+			}
+		}
+	}
+
+	for(next=line;*next;next++) {
+		for(length=0;next[length] && next[length] != '\n' && next[length] != '\r';length++)
+			;
+		if(length > width)
+			width = length;
+		height++;
+		next += length;
+		if(*next == '\r' && next[1] == '\n')
+			next++;
+		if(*next == 0)
+			break;
+	}
+	if(width == 0 || height == 0) {
+		printf("The grid is empty\n");
+		return(1);
+	}
+	if(width < 3) {
+		printf("The grid is %ld cells wide; a costmap needs at least 3\n", width);
+		return(1);
+	}
+
+	map = DCostMapCreate(output, (int)width, (int)height, tile);
+	if(map == NULL) {
+		printf("Unable to create %s: %s\n", output, strerror(errno));
+		return(1);
+	}
+	for(y=height-1;y>=0;y--) {
+		for(x=0;x<width;x++) {
+			if(*line && *line != '\n' && *line != '\r') {
+				DCostMapSetCell(map, (int64_t)y * width + x, charCost(*line));
+				lethal += charCost(*line++) == DCOSTMAP_LETHAL;
+			}
+		}
+		while(*line && *line != '\n')
+			line++;
+		if(*line)
+			line++;
+	}
+	printf("%ld x %ld, %" PRId64 " lethal cells\n", width, height, lethal);
+
+	DCostMapClose(map);
+	free(text);
+
+	return(0);
+}
+
+int main(int argc, char *argv[]) {
+	int tile = 0, status, c;
+	FILE *fp;
+
+	for(argc--,argv++;argc>2 && argv[0][0] == '-';argc-=2,argv+=2) {
+		if(strcmp(argv[0], "-t") == 0)
+			tile = atoi(argv[1]);
+		else if(strcmp(argv[0], "-o") == 0)
+			gblOccupied = atof(argv[1]);
+		else if(strcmp(argv[0], "-f") == 0)
+			gblFree = atof(argv[1]);
+		else
+			break;
+	}
+	if(argc != 2 || gblFree < 0.0 || gblOccupied <= gblFree) {
+		printf("usage: dconvert [-t tile] [-o occupied] [-f free] input output\n");
+		return(1);
+	}
+
+	fp = fopen(argv[0], "rb");
+	if(fp == NULL) {
+		printf("Unable to open %s\n", argv[0]);
+		return(1);
+	}
+	c = getc(fp);
+	if(c == 'P') {
+		c = getc(fp);
+		if(c != '2' && c != '5') {
+			printf("Only P2 and P5 PGM images can be read\n");
+			return(1);
+		}
+		status = convertPGM(fp, c == '5', argv[1], tile);
+	}
+	else {
+		ungetc(c, fp);
+		status = convertASCII(fp, argv[1], tile);
+	}
+	fclose(fp);
+
+	return(status);
+}
@@ -0,0 +1,152 @@
+/*
+  Memory-mapped binary costmap.
+
+  Opening a map reads its header and maps the file; the raster is used
+  where it lies, so the time to open does not grow with the map and only
+  the pages a planner touches are ever read from disk.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "dcostmap.h"
+
+// log2 of a tile side this code can use, or -2 if it is not one
+static int      tileShift(uint32_t tile)
+{
+  int             s;
+
+  if (tile == 0)
+    return (-1);
+  for (s = 3; s <= 12; s++) {
+    if (tile == (uint32_t) 1 << s)
+      return (s);
+  }
+
+  return (-2);
+}
+
+// bytes of the raster of a width x height map, padded out to whole tiles
+static uint64_t rasterBytes(uint64_t width, uint64_t height, uint32_t tile)
+{
+  if (tile == 0)
+    return (width * height);
+
+  return (((width + tile - 1) / tile) * ((height + tile - 1) / tile) * tile * tile);
+}
+
+// a map over the mapping of a file whose header has been checked
+static DCostMap *wrap(void *base, size_t bytes)
+{
+  DCostMapHeader *header = (DCostMapHeader *) base;
+  DCostMap       *map;
+
+  map = (DCostMap *) malloc(sizeof(DCostMap));
+  if (map == NULL) {
+    munmap(base, bytes);
+    errno = ENOMEM;
+    return (NULL);
+  }
+  map->width = (int)header->width;
+  map->height = (int)header->height;
+  map->tileShift = tileShift(header->tile);
+  map->tilesX = header->tile == 0 ? 0 : (header->width + header->tile - 1) / header->tile;
+  map->cost = (uint8_t *) base + header->offset;
+  map->base = base;
+  map->bytes = bytes;
+
+  return (map);
+}
+
+DCostMap       *DCostMapOpen(const char *path)
+{
+  DCostMapHeader  header;
+  struct stat     st;
+  void           *base;
+  int             fd, saved;
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return (NULL);
+  if (fstat(fd, &st) < 0 || read(fd, &header, sizeof(header)) != (ssize_t) sizeof(header)) {
+    saved = errno;
+    close(fd);
+    errno = saved == 0 ? EINVAL : saved;
+    return (NULL);
+  }
+
+  if (memcmp(header.magic, DCOSTMAP_MAGIC, sizeof(DCOSTMAP_MAGIC)) != 0 || header.order != DCOSTMAP_ORDER
+      || header.version != DCOSTMAP_VERSION || header.offset < sizeof(header)
+      || header.width < 3 || header.height == 0 || header.width > INT32_MAX || header.height > INT32_MAX
+      || tileShift(header.tile) < -1 || header.offset > (uint64_t) st.st_size
+      || (uint64_t) st.st_size - header.offset < rasterBytes(header.width, header.height, header.tile)) {
+    close(fd);
+    errno = EINVAL;
+    return (NULL);
+  }
+
+  // copy-on-write, so cells can be set without changing the file
+  base = mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  saved = errno;
+  close(fd);
+  if (base == MAP_FAILED) {
+    errno = saved;
+    return (NULL);
+  }
+
+  return (wrap(base, (size_t) st.st_size));
+}
+
+DCostMap       *DCostMapCreate(const char *path, int width, int height, int tile)
+{
+  DCostMapHeader *header;
+  size_t          bytes;
+  void           *base;
+  int             fd, saved;
+
+  if (width < 3 || height <= 0 || tileShift(tile) < -1) {
+    errno = EINVAL;
+    return (NULL);
+  }
+
+  fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return (NULL);
+
+  // the file is sparse until cells are set, so the raster starts as zeros
+  bytes = DCOSTMAP_OFFSET + rasterBytes(width, height, tile);
+  if (ftruncate(fd, (off_t) bytes) < 0)
+    base = MAP_FAILED;
+  else
+    base = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  saved = errno;
+  close(fd);
+  if (base == MAP_FAILED) {
+    errno = saved;
+    return (NULL);
+  }
+
+  header = (DCostMapHeader *) base;
+  memcpy(header->magic, DCOSTMAP_MAGIC, sizeof(DCOSTMAP_MAGIC));
+  header->order = DCOSTMAP_ORDER;
+  header->version = DCOSTMAP_VERSION;
+  header->offset = DCOSTMAP_OFFSET;
+  header->width = width;
+  header->height = height;
+  header->tile = tile;
+
+  return (wrap(base, bytes));
+}
+
+void            DCostMapClose(DCostMap * map)
+{
+  if (map == NULL)
+    return;
+
+  munmap(map->base, map->bytes);
+  free(map);
+}
@@ -0,0 +1,111 @@
+// Include file for the memory-mapped binary costmap
+
+#ifndef DCOSTMAP_H
+#define DCOSTMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A costmap file is a DCostMapHeader, zeros up to its offset, then one
+// byte of cost per cell.  Everything is in the byte order of the machine
+// that wrote it; the order field tells a reader whether that was its own.
+// With tile 0 the raster is row-major.  Otherwise the map is cut into
+// tile x tile squares, stored row-major and each row-major inside, the
+// ones on the right and top edges padded out to full squares; a planner
+// that keeps to a small area then touches few pages.  The raster starts
+// on a page boundary so the file can be mapped and used as it is.
+#define DCOSTMAP_MAGIC "DCOSTMP"		// 8 bytes with the terminating 0
+#define DCOSTMAP_VERSION 1
+#define DCOSTMAP_ORDER 0x01020304
+#define DCOSTMAP_OFFSET 4096		// of the raster in files this code writes
+
+// A cell of cost c < DCOSTMAP_LETHAL multiplies the length of every step
+// into it by 1 + c, so straight-line distance stays a lower bound.  A
+// lethal cell adds DCOSTMAP_OBSTACLE to the step, the same as an occupied
+// cell of a DMap.
+#define DCOSTMAP_LETHAL 255
+#define DCOSTMAP_OBSTACLE 1e+7
+
+typedef struct {
+  char     magic[8];
+  uint32_t order;		// DCOSTMAP_ORDER as written
+  uint32_t version;
+  uint64_t offset;		// bytes from the start of the file to the raster
+  uint32_t width;
+  uint32_t height;
+  uint32_t tile;		// side of a tile, a power of two, or 0
+  uint32_t reserved[9];		// 0
+} DCostMapHeader;
+
+// A map is the file mapped into memory.  It is mapped copy-on-write, so
+// cells can be changed with DCostMapSetCell without touching the file;
+// only the pages written to are copied.  A map made by DCostMapCreate is
+// shared with its file instead.
+typedef struct {
+  int width;
+  int height;
+  int tileShift;		// log2 of the tile side, -1 if row-major
+  int64_t tilesX;		// tiles across a row of them
+  uint8_t *cost;		// the raster, inside the mapping
+  void *base;			// the mapping
+  size_t bytes;			// of the mapping
+} DCostMap;
+
+// function prototypes
+
+// Maps a costmap file.  NULL if it cannot be opened or mapped, with errno
+// set by the call that failed, or if its header is not one this code can
+// read, with errno EINVAL.  Nothing is read until it is used.
+DCostMap *DCostMapOpen(const char *path);
+
+// Creates a costmap file of width x height cells, all 0, tiled if tile is
+// not 0, and maps it shared so that what is set is written to the file.
+// tile must be 0 or a power of two from 8 to 4096, and the map at least
+// 3 cells wide, as DCostMapStepCost needs.  NULL as for DCostMapOpen.
+DCostMap *DCostMapCreate(const char *path, int width, int height, int tile);
+
+// unmaps the map; what was set in a created one is already in its file
+void DCostMapClose(DCostMap *map);
+
+// offset in the raster of the cell with index y * width + x
+static inline int64_t DCostMapOffset(const DCostMap *map, int64_t cell)
+{
+  int64_t x, y, s;
+
+  if (map->tileShift < 0)
+    return (cell);
+  x = cell % map->width;
+  y = cell / map->width;
+  s = map->tileShift;
+
+  return ((((y >> s) * map->tilesX + (x >> s)) << (2 * s)) + ((y & ((1 << s) - 1)) << s) + (x & ((1 << s) - 1)));
+}
+
+// cost of the cell with index y * width + x; no bounds check
+static inline int DCostMapCell(const DCostMap *map, int64_t cell)
+{
+  return (map->cost[DCostMapOffset(map, cell)]);
+}
+
+static inline void DCostMapSetCell(DCostMap *map, int64_t cell, int cost)
+{
+  map->cost[DCostMapOffset(map, cell)] = (uint8_t) cost;
+}
+
+// Cost of the step between two 8-connected neighbors, given as cell
+// indices, in the same way as DMapStepCost: straight if the indices differ
+// by 1 or by a row, scaled or made an obstacle by the cell stepped into.
+// A row is more than 2 cells, so a map is never narrower than 3.
+static inline double DCostMapStepCost(const DCostMap *map, int64_t to, int64_t from)
+{
+  int64_t d = to - from;
+  double c;
+  int cost;
+
+  c = (d == 1 || d == -1 || d == map->width || d == -map->width) ? 1.0 : 1.41421356237309504880;
+  cost = DCostMapCell(map, to);
+
+  return (cost == DCOSTMAP_LETHAL ? DCOSTMAP_OBSTACLE + c : c * (1 + cost));
+}
+
+#endif
@@ -0,0 +1,337 @@
+/*
+	Planning episodes on a graph built as the search reaches it
+
+	The world is the unbounded one of dsparse.c: one block of 16 x 16
+	cells in five is rock.  No node exists until the neighbors callback
+	first reaches its cell; a hash table on the coordinates finds the ones
+	already made.  Each episode plans from a goal to a robot some distance
+	away in a random direction, then throws the whole graph away.
+
+	The episodes run three times over, with the nodes from
+
+	malloc		a Node and its nodeInfo each from malloc, freed one by
+			one at the end of the episode, as callers had to do
+	arena		DStarPlannerNewNode, each node and its nodeInfo side by
+			side in the planner's arena, all taken back at once by
+			DStarPlannerReleaseNodes
+	huge		the same, with the arena on huge pages
+
+	and for each it reports the nodes made, the time spent searching and
+	releasing the nodes, and the summed cost of the paths, which is the
+	same for all three.
+
+	build:	cc -O2 -o depisode depisode.c dstar.c dtrace.c -lm
+	usage:	depisode [-l] [episodes [distance [seed]]]
+
+	-l plans with D* Lite.  The defaults are 100 episodes of 300 cells.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include "dstar.h"
+#include "dmap.h"
+
+#define MALLOC 0
+#define ARENA 1
+#define HUGEPAGES 2
+
+// what a node knows of its cell
+typedef struct {
+	int32_t x;
+	int32_t y;
+} CellInfo;
+
+int gblKind;
+int32_t gblRobot[2];
+int32_t gblGoal[2];
+DStarPlanner *gblPlanner;
+Node **gblTable;		// the nodes made in this episode, by cell
+int64_t gblTableSize;		// a power of two
+int64_t gblTableUsed;
+int gblNoMem;			// a node could not be made
+
+#define KEY(x, y) (((uint64_t)(uint32_t)(y) << 32) | (uint32_t)(x))
+#define INFO(n) ((CellInfo *)(n)->nodeInfo)
+
+// rock by the hash of the 16 x 16 block, never in the blocks of the robot
+// or the goal
+int blocked(int32_t x, int32_t y);
+int blocked(int32_t x, int32_t y) {
+	uint32_t h;
+
+	if((x >> 4) == (gblRobot[0] >> 4) && (y >> 4) == (gblRobot[1] >> 4))
+		return(0);
+	if((x >> 4) == (gblGoal[0] >> 4) && (y >> 4) == (gblGoal[1] >> 4))
+		return(0);
+
+	h = (uint32_t)(x >> 4) * 73856093u ^ (uint32_t)(y >> 4) * 19349663u;
+	h ^= h >> 13;
+	h *= 0x5bd1e995u;
+	h ^= h >> 15;
+
+	return(h % 5 == 0);
+}
+
+// the slot of a cell's node in the table, or the empty slot it would go in
+int64_t slot(int32_t x, int32_t y);
+int64_t slot(int32_t x, int32_t y) {
+	int64_t i;
+
+	for(i=(int64_t)((KEY(x, y) * 0x9e3779b97f4a7c15ull) >> 32) & (gblTableSize - 1);
+	    gblTable[i] != NULL && (INFO(gblTable[i])->x != x || INFO(gblTable[i])->y != y);
+	    i=(i + 1) & (gblTableSize - 1))
+		;
+
+	return(i);
+}
+
+// doubles the table once it is half full; -1 if there is not enough memory
+int grow(void);
+int grow(void) {
+	Node **old = gblTable;
+	int64_t oldSize = gblTableSize, i;
+
+	gblTable = (Node **)calloc(2 * oldSize, sizeof(Node *));
+	if(gblTable == NULL) {
+		gblTable = old;
+		return(-1);
+	}
+	gblTableSize = 2 * oldSize;
+	for(i=0;i<oldSize;i++) {
+		if(old[i] != NULL)
+			gblTable[slot(INFO(old[i])->x, INFO(old[i])->y)] = old[i];
+	}
+	free(old);
+
+	return(0);
+}
+
+// the node of a cell, made NEW the first time it is asked for
+Node *cellNode(int32_t x, int32_t y);
+Node *cellNode(int32_t x, int32_t y) {
+	int64_t i;
+	Node *n;
+
+	i = slot(x, y);
+	if(gblTable[i] != NULL)
+		return(gblTable[i]);
+
+	if(2 * (gblTableUsed + 1) > gblTableSize) {
+		if(grow() < 0)
+			return(NULL);
+		i = slot(x, y);
+	}
+	if(gblKind == MALLOC) {
+		n = (Node *)malloc(sizeof(Node));
+		if(n == NULL)
+			return(NULL);
+		n->nodeInfo = malloc(sizeof(CellInfo));
+		if(n->nodeInfo == NULL) {
+			free(n);
+			return(NULL);
+		}
+		n->id = gblTableUsed;
+		n->state = NEW;
+		n->parent = NULL;
+		n->openIndex = -1;
+	}
+	else {
+		n = DStarPlannerNewNode(gblPlanner, sizeof(CellInfo));
+		if(n == NULL)
+			return(NULL);
+	}
+	INFO(n)->x = x;
+	INFO(n)->y = y;
+	gblTable[i] = n;
+	gblTableUsed++;
+
+	return(n);
+}
+
+// the callbacks
+double hfunction(Node *p, void *data);
+double hfunction(Node *p, void *data) {
+	double dx, dy;
+
+	dx = gblRobot[0] - INFO(p)->x;
+	dy = gblRobot[1] - INFO(p)->y;
+
+	return(sqrt(dx*dx + dy*dy));
+}
+
+int robot(Node *p, void *data);
+int robot(Node *p, void *data) {
+	return(INFO(p)->x == gblRobot[0] && INFO(p)->y == gblRobot[1]);
+}
+
+int getNeighbors(Node *parent, Node **neighbor, void *data);
+int getNeighbors(Node *parent, Node **neighbor, void *data) {
+	int deltax[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+	int deltay[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+	int i, n;
+	Node *p;
+
+	n = 0;
+	for(i=0;i<8;i++) {
+		p = cellNode(INFO(parent)->x + deltax[i], INFO(parent)->y + deltay[i]);
+		if(p != NULL)
+			neighbor[n++] = p;
+		else
+			gblNoMem = 1;
+	}
+
+	return(n);
+}
+
+double cost(Node *to, Node *from, void *data);
+double cost(Node *to, Node *from, void *data) {
+	double c;
+
+	c = INFO(to)->x != INFO(from)->x && INFO(to)->y != INFO(from)->y ? DMAP_DIAGONAL : DMAP_STRAIGHT;
+
+	return(blocked(INFO(to)->x, INFO(to)->y) ? DMAP_OBSTACLE + c : c);
+}
+
+// cost of the path the backpointers give from the robot
+double pathCost(void);
+double pathCost(void) {
+	Node *p, *parent;
+	double c = 0.0;
+
+	for(p=gblTable[slot(gblRobot[0], gblRobot[1])];p != NULL && p->parent != NULL;p=parent) {
+		parent = (Node *)p->parent;
+		c += cost(parent, p, NULL);
+	}
+
+	return(c);
+}
+
+// The episodes with the nodes of one kind; the seed makes them the same
+// each time.  Returns -1 if the nodes ran out.
+int episodes(int kind, int numEpisodes, int distance, unsigned int seed);
+int episodes(int kind, int numEpisodes, int distance, unsigned int seed) {
+	double costR[2], angle, searchTime = 0.0, releaseTime = 0.0, sum = 0.0, t;
+	int64_t nodes = 0, peak = 0, i;
+	size_t bytes = 0;
+	Node *root, *path;
+	int e;
+
+	gblKind = kind;
+	if(kind != MALLOC)
+		DStarPlannerArena(gblPlanner, 0, kind == HUGEPAGES ? DSTAR_ARENA_HUGE : 0);
+	srand(seed);
+
+	for(e=0;e<numEpisodes;e++) {
+		gblRobot[0] = rand() % 100000 - 50000;
+		gblRobot[1] = rand() % 100000 - 50000;
+		angle = 2.0 * 3.14159265358979 * (rand() / (RAND_MAX + 1.0));
+		gblGoal[0] = gblRobot[0] + (int32_t)(distance * cos(angle));
+		gblGoal[1] = gblRobot[1] + (int32_t)(distance * sin(angle));
+
+		t = DStarNow();
+		root = cellNode(gblGoal[0], gblGoal[1]);
+		if(root == NULL)
+			return(-1);
+		root->g = 0;
+		root->h = hfunction(root, NULL);
+		root->f = root->g + root->h;
+		DStarPlannerRobotAt(gblPlanner, cellNode(gblRobot[0], gblRobot[1]));
+		costR[0] = costR[1] = 1e+9;
+		DStarPlannerSearch(gblPlanner, &root, 1, costR, &path);
+		searchTime += DStarNow() - t;
+		if(gblNoMem)
+			return(-1);
+		sum += pathCost();
+		nodes += gblTableUsed;
+		peak = gblTableUsed > peak ? gblTableUsed : peak;
+		if(kind != MALLOC)
+			bytes = DStarPlannerBytes(gblPlanner);
+
+		// the planner lets go of the nodes before they go
+		t = DStarNow();
+		if(kind == MALLOC) {
+			DStarPlannerReset(gblPlanner);
+			for(i=0;i<gblTableSize;i++) {
+				if(gblTable[i] != NULL) {
+					free(gblTable[i]->nodeInfo);
+					free(gblTable[i]);
+				}
+			}
+		}
+		else
+			DStarPlannerReleaseNodes(gblPlanner);
+		releaseTime += DStarNow() - t;
+		memset(gblTable, 0, sizeof(Node *) * gblTableSize);
+		gblTableUsed = 0;
+	}
+
+	printf("%-8s %12" PRId64 " %12" PRId64 " %12.2f %12.2f %12.2f", kind == MALLOC ? "malloc" : kind == ARENA ? "arena" : "huge",
+	       nodes, peak, 1e3 * searchTime, 1e3 * releaseTime, sum);
+	if(kind != MALLOC)
+		printf(" %10.1f MB planner", bytes / 1e6);
+	printf("\n");
+
+	return(0);
+}
+
+int main(int argc, char *argv[]) {
+	int numEpisodes = 100, distance = 300, engine = DSTAR_ENGINE_DSTAR, kind;
+	unsigned int seed = 1;
+	DStarCallbacks cb;
+	DStarParams params;
+
+	for(argc--,argv++;argc>0 && argv[0][0] == '-';argc--,argv++) {
+		if(strcmp(argv[0], "-l") == 0)
+			engine = DSTAR_ENGINE_LITE;
+		else {
+			printf("usage: depisode [-l] [episodes [distance [seed]]]\n");
+			return(1);
+		}
+	}
+	if(argc > 0)
+		numEpisodes = atoi(argv[0]);
+	if(argc > 1)
+		distance = atoi(argv[1]);
+	if(argc > 2)
+		seed = atoi(argv[2]);
+	if(numEpisodes < 1 || distance < 10 || distance > 100000) {
+		printf("There must be an episode, of 10 to 100000 cells\n");
+		return(1);
+	}
+
+	gblTableSize = 1024;
+	gblTable = (Node **)calloc(gblTableSize, sizeof(Node *));
+	DStarDefaultParams(&params);
+	params.maxExpand = 0;
+	params.engine = engine;
+	cb.gcalc = NULL;
+	cb.hcalc = hfunction;
+	cb.robotNode = robot;
+	cb.neighbors = getNeighbors;
+	cb.cost = cost;
+	cb.printNode = NULL;
+	cb.pruneNeighbors = NULL;
+	cb.data = NULL;
+	gblPlanner = DStarPlannerCreate(&cb, &params);
+	if(gblTable == NULL || gblPlanner == NULL) {
+		printf("Not enough memory for the planner\n");
+		return(1);
+	}
+
+	printf("%d episodes of %d cells, %s\n", numEpisodes, distance, engine == DSTAR_ENGINE_LITE ? "D* Lite" : "D*");
+	printf("%-8s %12s %12s %12s %12s %12s\n", "", "nodes", "most", "search ms", "release ms", "pathcost");
+	for(kind=MALLOC;kind<=HUGEPAGES;kind++) {
+		if(episodes(kind, numEpisodes, distance, seed) < 0) {
+			printf("Not enough memory for the nodes\n");
+			return(1);
+		}
+	}
+
+	DStarPlannerDestroy(gblPlanner);
+	free(gblTable);
+
+	return(0);
+}
@@ -0,0 +1,163 @@
+/*
+  Compressed sparse row graph.
+
+  The slots are laid out with a counting sort on the ends of the edges:
+  one pass counts the slots of each node, a prefix sum turns the counts
+  into first, and a second pass drops each edge into the next free slot
+  at both of its ends.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "dgraph.h"
+
+DGraph         *DGraphCreate(int64_t numNodes, const DGraphEdge * edge, int64_t numEdges, const double *xy)
+{
+  DGraph         *graph;
+  int64_t        *next, e, n, s;
+
+  if (numNodes <= 0 || numNodes >= (int64_t) UINT32_MAX || numEdges < 0)
+    return (NULL);
+  for (e = 0; e < numEdges; e++) {
+    if (edge[e].a < 0 || edge[e].a >= numNodes || edge[e].b < 0 || edge[e].b >= numNodes ||
+	edge[e].a == edge[e].b || !(edge[e].ab >= 0.0) || !(edge[e].ba >= 0.0))
+      return (NULL);
+  }
+
+  graph = (DGraph *) calloc(1, sizeof(DGraph));
+  if (graph == NULL)
+    return (NULL);
+  graph->numNodes = numNodes;
+  graph->numEdges = numEdges;
+  graph->first = (int64_t *) calloc(numNodes + 1, sizeof(int64_t));
+  graph->adj = (uint32_t *) malloc(sizeof(uint32_t) * (2 * numEdges + 1));
+  graph->costIn = (double *) malloc(sizeof(double) * (2 * numEdges + 1));
+  graph->costOut = (double *) malloc(sizeof(double) * (2 * numEdges + 1));
+  graph->mark = (uint64_t *) calloc((numNodes + 63) / 64, sizeof(uint64_t));
+  graph->changed = (int64_t *) malloc(sizeof(int64_t) * numNodes);
+  if (xy != NULL)
+    graph->xy = (double *) malloc(sizeof(double) * 2 * numNodes);
+  next = (int64_t *) malloc(sizeof(int64_t) * numNodes);
+  if (graph->first == NULL || graph->adj == NULL || graph->costIn == NULL || graph->costOut == NULL ||
+      graph->mark == NULL || graph->changed == NULL || (xy != NULL && graph->xy == NULL) || next == NULL) {
+    free(next);
+    DGraphDestroy(graph);
+    return (NULL);
+  }
+  if (xy != NULL)
+    memcpy(graph->xy, xy, sizeof(double) * 2 * numNodes);
+
+  // the slots of node n start at first[n]
+  for (e = 0; e < numEdges; e++) {
+    graph->first[edge[e].a + 1]++;
+    graph->first[edge[e].b + 1]++;
+  }
+  for (n = 0; n < numNodes; n++) {
+    if (graph->first[n + 1] > INT_MAX) {
+      free(next);
+      DGraphDestroy(graph);
+      return (NULL);
+    }
+    if (graph->first[n + 1] > graph->maxDegree)
+      graph->maxDegree = (int) graph->first[n + 1];
+    graph->first[n + 1] += graph->first[n];
+  }
+  memcpy(next, graph->first, sizeof(int64_t) * numNodes);
+
+  // each edge at both its ends, in the order given
+  for (e = 0; e < numEdges; e++) {
+    s = next[edge[e].a]++;
+    graph->adj[s] = (uint32_t) edge[e].b;
+    graph->costIn[s] = edge[e].ba;
+    graph->costOut[s] = edge[e].ab;
+
+    s = next[edge[e].b]++;
+    graph->adj[s] = (uint32_t) edge[e].a;
+    graph->costIn[s] = edge[e].ab;
+    graph->costOut[s] = edge[e].ba;
+  }
+  free(next);
+
+  return (graph);
+}
+
+void            DGraphDestroy(DGraph * graph)
+{
+  if (graph == NULL)
+    return;
+
+  free(graph->first);
+  free(graph->adj);
+  free(graph->costIn);
+  free(graph->costOut);
+  free(graph->xy);
+  free(graph->mark);
+  free(graph->changed);
+  free(graph);
+}
+
+int64_t         DGraphSlot(const DGraph * graph, int64_t from, int64_t to)
+{
+  int64_t         s;
+
+  for (s = graph->first[from]; s < graph->first[from + 1]; s++) {
+    if (graph->adj[s] == (uint32_t) to)
+      return (s);
+  }
+
+  return (-1);
+}
+
+// puts a node on the changed list if it is not there already
+static void     change(DGraph * graph, int64_t n)
+{
+  if ((graph->mark[n >> 6] >> (n & 63)) & 1)
+    return;
+
+  graph->mark[n >> 6] |= (uint64_t) 1 << (n & 63);
+  graph->changed[graph->numChanged++] = n;
+}
+
+int             DGraphSetCost(DGraph * graph, int64_t from, int64_t to, double cost)
+{
+  int64_t         s, t;
+
+  if (!(cost >= 0.0))
+    return (-1);
+  s = DGraphSlot(graph, from, to);
+  if (s < 0)
+    return (-1);
+  t = DGraphSlot(graph, to, from);
+
+  graph->costOut[s] = cost;
+  graph->costIn[t] = cost;
+  change(graph, from);
+  change(graph, to);
+
+  return (0);
+}
+
+void            DGraphSettle(DGraph * graph)
+{
+  int64_t         i, n;
+
+  for (i = 0; i < graph->numChanged; i++) {
+    n = graph->changed[i];
+    graph->mark[n >> 6] &= ~((uint64_t) 1 << (n & 63));
+  }
+  graph->numChanged = 0;
+}
+
+size_t          DGraphBytes(const DGraph * graph)
+{
+  size_t          bytes;
+
+  bytes = sizeof(DGraph) + sizeof(int64_t) * (graph->numNodes + 1);
+  bytes += (sizeof(uint32_t) + 2 * sizeof(double)) * 2 * graph->numEdges;
+  bytes += sizeof(uint64_t) * ((graph->numNodes + 63) / 64) + sizeof(int64_t) * graph->numNodes;
+  if (graph->xy != NULL)
+    bytes += sizeof(double) * 2 * graph->numNodes;
+
+  return (bytes);
+}
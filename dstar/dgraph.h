@@ -0,0 +1,147 @@
+// Include file for the compressed sparse row graph and its planner
+
+#ifndef DGRAPH_H
+#define DGRAPH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+#include "dstar.h"
+
+// the cost of a step that cannot be taken: the missing way of a one-way
+// edge, or an edge that has been closed
+#define DGRAPH_NOEDGE HUGE_VAL
+
+// an edge between nodes a and b, with the cost of the step each way
+typedef struct {
+  int64_t a;
+  int64_t b;
+  double ab;			// step from a to b
+  double ba;			// step from b to a
+} DGraphEdge;
+
+// A graph in compressed sparse row form.  The edges of node n are the
+// slots first[n] .. first[n+1] - 1, and every edge has a slot at each of
+// its ends.  A slot holds the node at the other end and the costs of the
+// steps both ways, each in an array of its own, so expanding a node reads
+// three short runs of memory and no cost is ever computed.  Costs are
+// changed in place with DGraphSetCost, which puts both ends of the edge on
+// the changed list; that list is what a replan takes, and DGraphSettle
+// empties it once every planner has replanned.
+typedef struct {
+  int64_t numNodes;
+  int64_t numEdges;
+  int maxDegree;		// most slots of any node
+  int64_t *first;		// numNodes + 1 entries
+  uint32_t *adj;		// the node at the other end of each slot
+  double *costIn;		// the step from adj[s] to the slot's node
+  double *costOut;		// the step from the slot's node to adj[s]
+  double *xy;			// 2 coordinates per node, NULL if none
+  uint64_t *mark;		// one bit per node on the changed list
+  int64_t *changed;		// nodes whose edges changed since DGraphSettle
+  int64_t numChanged;
+} DGraph;
+
+// function prototypes
+
+// A graph of numNodes nodes, fewer than 2^32 - 1, and the edges given.
+// Two nodes should share at most one edge.  xy, if not NULL, gives 2
+// coordinates per node; the planner's heuristic is the straight-line
+// distance between them, so no step may then cost less than the distance
+// it covers.  Without them the heuristic is 0.  NULL if an edge has an end
+// out of range, joins a node to itself or has a negative cost, or if there
+// is not enough memory.
+DGraph *DGraphCreate(int64_t numNodes, const DGraphEdge *edge, int64_t numEdges, const double *xy);
+void DGraphDestroy(DGraph *graph);
+
+// the slot of the edge to node to among the slots of node from, -1 if they
+// share no edge; it looks through the slots of from
+int64_t DGraphSlot(const DGraph *graph, int64_t from, int64_t to);
+
+// Sets the cost of the step from node from to node to, DGRAPH_NOEDGE to
+// close it, and puts both on the changed list.  -1 if they share no edge
+// or the cost is negative.
+int DGraphSetCost(DGraph *graph, int64_t from, int64_t to, double cost);
+
+// empty the changed list, once every planner has replanned with it
+void DGraphSettle(DGraph *graph);
+
+// memory used by the graph
+size_t DGraphBytes(const DGraph *graph);
+
+// the cost of the step from node from to node to, DGRAPH_NOEDGE if there
+// is none; as a planner's cost callback would give it
+static inline double DGraphCost(const DGraph *graph, int64_t to, int64_t from)
+{
+  int64_t s = DGraphSlot(graph, to, from);
+
+  return (s < 0 ? DGRAPH_NOEDGE : graph->costIn[s]);
+}
+
+// the neighbors of node n into buf, in the order of its slots
+static inline int DGraphNeighbors(const DGraph *graph, int64_t n, int64_t *buf)
+{
+  const uint32_t *adj = graph->adj + graph->first[n];
+  int i, numSlots = (int) (graph->first[n + 1] - graph->first[n]);
+
+  for (i = 0; i < numSlots; i++)
+    buf[i] = adj[i];
+
+  return (numSlots);
+}
+
+// What a graph planner plans on: the graph, and the node the robot is at,
+// which the caller keeps up to date and tells the planner of with
+// graphPlannerRobotAt.  Planners with one each can share a graph as long
+// as nobody changes its costs while they plan.
+typedef struct {
+  const DGraph *graph;
+  int64_t robot;
+} DGraphRobot;
+
+// the straight-line distance from node n to the robot's
+static inline double DGraphH(const DGraphRobot *robot, int64_t n)
+{
+  const double *xy = robot->graph->xy;
+  double dx, dy;
+
+  if (xy == NULL || robot->robot < 0)
+    return (0.0);
+
+  dx = xy[2 * n] - xy[2 * robot->robot];
+  dy = xy[2 * n + 1] - xy[2 * robot->robot + 1];
+
+  return (sqrt(dx * dx + dy * dy));
+}
+
+// The planner generated from dstarinline.h, whose calls are the
+// DStarPlanner*Index calls named graphPlanner*: graphPlannerSearch,
+// graphPlannerReplan and so on.  The neighbors come straight out of the
+// slots and the cost of each edge from beside them, by position, so an
+// expansion makes no calls through pointers at all.
+#define DSI_NAME(x) graph##x
+#define DSI_DATA DGraphRobot
+#define DSI_NEIGHBORS(d, n, buf) DGraphNeighbors((d)->graph, (n), (buf))
+#define DSI_COST(d, to, from) DGraphCost((d)->graph, (to), (from))
+#define DSI_COSTIN(d, n, i, m) ((d)->graph->costIn[(d)->graph->first[n] + (i)])
+#define DSI_COSTOUT(d, n, i, m) ((d)->graph->costOut[(d)->graph->first[n] + (i)])
+#define DSI_HCALC(d, n) DGraphH((d), (n))
+#define DSI_ROBOT(d, n) ((n) == (d)->robot)
+#include "dstarinline.h"
+
+// a planner over robot->graph; params may be NULL for the defaults, and
+// maxNeighbors is raised to the graph's maxDegree if it is below it
+static inline graphPlanner *DGraphPlannerCreate(DGraphRobot *robot, const DStarParams *params)
+{
+  DStarParams p;
+
+  DStarDefaultParams(&p);
+  if (params != NULL)
+    p = *params;
+  if (p.maxNeighbors < robot->graph->maxDegree)
+    p.maxNeighbors = robot->graph->maxDegree;
+
+  return (graphPlannerCreate(robot, robot->graph->numNodes, &p));
+}
+
+#endif
@@ -0,0 +1,218 @@
+/*
+  Indexed d-ary heap used as the D* OPEN list.
+
+  Entries are ordered on (f, k), the same tie-break as the LESS macro in
+  dstar.c.  Entries with equal (f, k) come out in the order they were
+  (re)inserted, which is the order the old sorted linked list gave.  Each
+  item records its own position in the heap, so it can be re-keyed or
+  removed in O(log n).  Each entry also carries a stamp for the caller,
+  e.g. to tell which keys were computed before something changed.
+
+  This file is a template.  Define the following, then include it:
+
+    DHEAP_TYPE        name of the heap type, e.g. NodeHeap
+    DHEAP_ENTRY       name of the entry type, e.g. NodeHeapEntry
+    DHEAP_NAME(x)     prefixes the generated functions, e.g. nodeHeap##x
+    DHEAP_ITEM        type of the stored items
+    DHEAP_POS(item)   lvalue holding the item's position in the heap; it may
+                      use the variable heap, the heap being worked on
+    DHEAP_FIELDS      optional extra members of the heap type, e.g. the
+                      array DHEAP_POS indexes; the owner sets them up
+    DHEAP_ARITY       branching factor, 2 or 4 (default 4)
+
+  It can be included several times with different definitions.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifndef DHEAP_ARITY
+#define DHEAP_ARITY 4
+#endif
+
+typedef struct {
+  double          f;
+  double          k;
+  uint64_t        seq;			       // insertion order, breaks (f, k) ties
+  DHEAP_ITEM      item;
+  uint32_t        stamp;		       // the caller's, not used for ordering
+} DHEAP_ENTRY;
+
+typedef struct {
+  DHEAP_ENTRY    *entry;
+  int64_t         size;
+  int64_t         capacity;
+  uint64_t        seq;
+#ifdef DHEAP_FIELDS
+  DHEAP_FIELDS
+#endif
+} DHEAP_TYPE;
+
+#define DHEAP_LESS(a, b) ((a)->f < (b)->f || ((a)->f == (b)->f &&		\
+			   ((a)->k < (b)->k || ((a)->k == (b)->k && (a)->seq < (b)->seq))))
+
+static inline void DHEAP_NAME(Init)(DHEAP_TYPE * heap)
+{
+  heap->entry = NULL;
+  heap->size = 0;
+  heap->capacity = 0;
+  heap->seq = 0;
+}
+
+static inline void DHEAP_NAME(Free)(DHEAP_TYPE * heap)
+{
+  free(heap->entry);
+  DHEAP_NAME(Init)(heap);
+}
+
+// make room for at least n entries; returns -1 if the memory is not there
+static inline int DHEAP_NAME(Reserve)(DHEAP_TYPE * heap, int64_t n)
+{
+  DHEAP_ENTRY    *e;
+  int64_t         cap;
+
+  if (n <= heap->capacity)
+    return (0);
+
+  cap = heap->capacity > 0 ? heap->capacity : 256;
+  while (cap < n)
+    cap *= 2;
+
+  e = (DHEAP_ENTRY *) realloc(heap->entry, sizeof(DHEAP_ENTRY) * cap);
+  if (e == NULL)
+    return (-1);
+
+  heap->entry = e;
+  heap->capacity = cap;
+  return (0);
+}
+
+static inline void DHEAP_NAME(SiftUp)(DHEAP_TYPE * heap, int64_t pos)
+{
+  DHEAP_ENTRY     e = heap->entry[pos];
+  int64_t         parent;
+
+  while (pos > 0) {
+    parent = (pos - 1) / DHEAP_ARITY;
+    if (!DHEAP_LESS(&e, &heap->entry[parent]))
+      break;
+    heap->entry[pos] = heap->entry[parent];
+    DHEAP_POS(heap->entry[pos].item) = pos;
+    pos = parent;
+  }
+  heap->entry[pos] = e;
+  DHEAP_POS(e.item) = pos;
+}
+
+static inline void DHEAP_NAME(SiftDown)(DHEAP_TYPE * heap, int64_t pos)
+{
+  DHEAP_ENTRY     e = heap->entry[pos];
+  int64_t         child, best, last;
+
+  for (;;) {
+    child = pos * DHEAP_ARITY + 1;
+    if (child >= heap->size)
+      break;
+
+    // find the smallest child
+    best = child;
+    last = child + DHEAP_ARITY < heap->size ? child + DHEAP_ARITY : heap->size;
+    for (child++; child < last; child++) {
+      if (DHEAP_LESS(&heap->entry[child], &heap->entry[best]))
+	best = child;
+    }
+
+    if (!DHEAP_LESS(&heap->entry[best], &e))
+      break;
+    heap->entry[pos] = heap->entry[best];
+    DHEAP_POS(heap->entry[pos].item) = pos;
+    pos = best;
+  }
+  heap->entry[pos] = e;
+  DHEAP_POS(e.item) = pos;
+}
+
+// insert an item; the caller must have reserved room for it
+static inline void DHEAP_NAME(Push)(DHEAP_TYPE * heap, DHEAP_ITEM item, double f, double k, uint32_t stamp)
+{
+  DHEAP_ENTRY    *e = &heap->entry[heap->size];
+
+  e->f = f;
+  e->k = k;
+  e->seq = heap->seq++;
+  e->item = item;
+  e->stamp = stamp;
+  heap->size++;
+
+  DHEAP_NAME(SiftUp)(heap, heap->size - 1);
+}
+
+// change the key of the entry at pos; it goes behind any entries with an equal key
+static inline void DHEAP_NAME(Update)(DHEAP_TYPE * heap, int64_t pos, double f, double k, uint32_t stamp)
+{
+  DHEAP_ENTRY    *e = &heap->entry[pos];
+  DHEAP_ENTRY     old = *e;
+
+  e->f = f;
+  e->k = k;
+  e->seq = heap->seq++;
+  e->stamp = stamp;
+
+  if (DHEAP_LESS(e, &old))
+    DHEAP_NAME(SiftUp)(heap, pos);
+  else
+    DHEAP_NAME(SiftDown)(heap, pos);
+}
+
+// take the entry at pos out of the heap
+static inline void DHEAP_NAME(Remove)(DHEAP_TYPE * heap, int64_t pos)
+{
+  DHEAP_ENTRY    *last;
+
+  heap->size--;
+  if (pos == heap->size)
+    return;
+
+  last = &heap->entry[heap->size];
+  heap->entry[pos] = *last;
+  if (pos > 0 && DHEAP_LESS(&heap->entry[pos], &heap->entry[(pos - 1) / DHEAP_ARITY]))
+    DHEAP_NAME(SiftUp)(heap, pos);
+  else
+    DHEAP_NAME(SiftDown)(heap, pos);
+}
+
+// remove and return the smallest item; the heap must not be empty
+static inline DHEAP_ITEM DHEAP_NAME(Pop)(DHEAP_TYPE * heap)
+{
+  DHEAP_ITEM      item = heap->entry[0].item;
+
+  DHEAP_NAME(Remove)(heap, 0);
+  return (item);
+}
+
+static int      DHEAP_NAME(Compare)(const void *a, const void *b)
+{
+  const DHEAP_ENTRY *x = (const DHEAP_ENTRY *) a;
+  const DHEAP_ENTRY *y = (const DHEAP_ENTRY *) b;
+
+  return (DHEAP_LESS(x, y) ? -1 : DHEAP_LESS(y, x) ? 1 : 0);
+}
+
+// sort the entries into expansion order; a sorted array is still a valid heap
+static inline void DHEAP_NAME(Sort)(DHEAP_TYPE * heap)
+{
+  int64_t         i;
+
+  qsort(heap->entry, heap->size, sizeof(DHEAP_ENTRY), DHEAP_NAME(Compare));
+  for (i = 0; i < heap->size; i++)
+    DHEAP_POS(heap->entry[i].item) = i;
+}
+
+#undef DHEAP_LESS
+#undef DHEAP_TYPE
+#undef DHEAP_ENTRY
+#undef DHEAP_NAME
+#undef DHEAP_ITEM
+#undef DHEAP_POS
+#undef DHEAP_FIELDS
+#undef DHEAP_ARITY
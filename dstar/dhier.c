@@ -0,0 +1,808 @@
+/*
+  Hierarchical planner for large grids, after HPA* (Botea, Mueller and
+  Schaeffer, "Near Optimal Hierarchical Path-Finding").
+
+  Two planners are generated from dstarinline.h.  The cluster planner
+  searches the cells of one cluster at a time, with D* Lite so that a
+  query settles exactly the nodes it is asked for; it finds the costs
+  between the abstract nodes of a cluster, joins the robot and the goal
+  to the graph and finds the cells of the path.  The abstract planner
+  runs D* over the abstract nodes, with the engine the caller asked for.
+
+  Abstract nodes 0 and 1 are the robot and the goal, the others come in
+  pairs across the borders.  An id is reused once the border it was on
+  is rebuilt without it, so the graph does not grow with the updates.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "dhier.h"
+
+#define DHIER_ROBOT 0
+#define DHIER_GOAL  1
+#define DHIER_RUN   6			       // runs this long get an entrance at each end
+
+// an abstract node
+typedef struct {
+  int64_t         cell;
+  int32_t         cluster;		       // -1 if the id is free
+  int32_t         slot;			       // its place in the cluster's list
+  int64_t         twin;			       // the node across the border
+} DHierNode;
+
+typedef struct {
+  int64_t        *node;			       // abstract nodes on its four borders
+  int             numNodes;
+  double         *dist;			       // [i * numNodes + j]: from node i to node j
+  int             dirty;
+} DHierCluster;
+
+// the border of a cluster with the one east of it or north of it
+typedef struct {
+  int64_t        *node;			       // in pairs, this side first
+  int             numNodes;
+  int             dirty;
+} DHierBorder;
+
+// the policies of both planners, defined below DHier
+static inline int clusterNeighbors(DHier * hier, int64_t n, int64_t * buf);
+static inline double clusterCost(DHier * hier, int64_t to, int64_t from);
+static inline double clusterH(DHier * hier, int64_t n);
+static inline int clusterRobot(DHier * hier, int64_t n);
+static inline int abstractNeighbors(DHier * hier, int64_t n, int64_t * buf);
+static inline double abstractCost(DHier * hier, int64_t to, int64_t from);
+static inline double abstractH(DHier * hier, int64_t n);
+
+#define DSI_NAME(x) cluster##x
+#define DSI_DATA DHier
+#define DSI_NEIGHBORS(d, n, buf) clusterNeighbors((d), (n), (buf))
+#define DSI_COST(d, to, from) clusterCost((d), (to), (from))
+#define DSI_HCALC(d, n) clusterH((d), (n))
+#define DSI_ROBOT(d, n) clusterRobot((d), (n))
+#include "dstarinline.h"
+
+#define DSI_NAME(x) abstract##x
+#define DSI_DATA DHier
+#define DSI_NEIGHBORS(d, n, buf) abstractNeighbors((d), (n), (buf))
+#define DSI_COST(d, to, from) abstractCost((d), (to), (from))
+#define DSI_HCALC(d, n) abstractH((d), (n))
+#define DSI_ROBOT(d, n) ((n) == DHIER_ROBOT)
+#include "dstarinline.h"
+
+struct DHier {
+  int             width;
+  int             height;
+  int             size;			       // cells on a side of a cluster
+  int             clustersX;
+  int             clustersY;
+  DHierCost       cost;
+  void           *data;
+  double          blocked;
+  DStarParams     params;		       // of the abstract search
+  DHierCluster   *cluster;
+  DHierBorder    *border;		       // two per cluster: east, north
+  int             dirty;		       // some cluster or border needs rebuilding
+  int             maxNodes;		       // most abstract nodes in one cluster
+  DHierNode      *node;
+  int64_t         numNodes;		       // ids handed out, free ones included
+  int64_t         nodeCapacity;
+  int64_t        *freeNode;		       // ids to reuse, nodeCapacity entries
+  int64_t         numFree;
+  abstractPlanner *abstract;		       // NULL until the first plan
+  clusterPlanner *local;
+  // the cluster being searched and the node the search is heading for
+  int             x0;
+  int             y0;
+  int             w;
+  int             h;
+  int64_t         localRobot;		       // -1 for none
+  int             focus;		       // measure h to localRobot, else 0
+  int             reverse;		       // take each step's cost backwards
+  // the robot and goal of the current plan, joined to their clusters
+  int             robotCluster;
+  int             goalCluster;
+  double         *robotDist;		       // from the robot to each node of its cluster
+  double         *goalDist;		       // from each node of its cluster to the goal
+  double          direct;		       // robot to goal in a shared cluster
+  int64_t        *start;		       // local nodes of a query
+  int64_t        *offset;
+  int             scratchCapacity;	       // of the four arrays above
+  int64_t        *localPath;		       // filled by the queries
+  size_t          localCapacity;
+  DHierStats      stats;
+};
+
+// the cell at (x, y)
+#define HCELL(hier, x, y) ((int64_t)(y) * (hier)->width + (x))
+
+// the rectangle of cluster c
+static void     clusterRect(const DHier * hier, int c, int *x0, int *y0, int *w, int *h)
+{
+  *x0 = (c % hier->clustersX) * hier->size;
+  *y0 = (c / hier->clustersX) * hier->size;
+  *w = hier->width - *x0 < hier->size ? hier->width - *x0 : hier->size;
+  *h = hier->height - *y0 < hier->size ? hier->height - *y0 : hier->size;
+}
+
+static int      cellCluster(const DHier * hier, int64_t cell)
+{
+  return ((int)((cell / hier->width) / hier->size) * hier->clustersX + (int)((cell % hier->width) / hier->size));
+}
+
+// the cluster planner searches this cluster next
+static void     setFrame(DHier * hier, int c)
+{
+  clusterRect(hier, c, &hier->x0, &hier->y0, &hier->w, &hier->h);
+}
+
+static inline int64_t localCell(const DHier * hier, int64_t n)
+{
+  return (HCELL(hier, hier->x0 + n % hier->w, hier->y0 + n / hier->w));
+}
+
+static inline int64_t cellLocal(const DHier * hier, int64_t cell)
+{
+  return ((cell / hier->width - hier->y0) * hier->w + cell % hier->width - hier->x0);
+}
+
+static inline int clusterNeighbors(DHier * hier, int64_t n, int64_t * buf)
+{
+  static const int deltax[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+  static const int deltay[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+  int             i, x, y, num = 0;
+
+  for (i = 0; i < 8; i++) {
+    x = (int)(n % hier->w) + deltax[i];
+    y = (int)(n / hier->w) + deltay[i];
+    if (x >= 0 && x < hier->w && y >= 0 && y < hier->h)
+      buf[num++] = (int64_t) y *hier->w + x;
+  }
+
+  return (num);
+}
+
+static inline double clusterCost(DHier * hier, int64_t to, int64_t from)
+{
+  if (hier->reverse)
+    return (hier->cost(localCell(hier, from), localCell(hier, to), hier->data));
+
+  return (hier->cost(localCell(hier, to), localCell(hier, from), hier->data));
+}
+
+static inline double cellDistance(const DHier * hier, int64_t a, int64_t b)
+{
+  double          dx = (double)(a % hier->width - b % hier->width);
+  double          dy = (double)(a / hier->width - b / hier->width);
+
+  return (sqrt(dx * dx + dy * dy));
+}
+
+static inline double clusterH(DHier * hier, int64_t n)
+{
+  if (!hier->focus)
+    return (0.0);
+
+  return (cellDistance(hier, localCell(hier, n), localCell(hier, hier->localRobot)));
+}
+
+static inline int clusterRobot(DHier * hier, int64_t n)
+{
+  return (n == hier->localRobot);
+}
+
+// the other nodes of the cluster, the node across the border and the
+// robot or goal if they are in the cluster
+static inline int abstractNeighbors(DHier * hier, int64_t n, int64_t * buf)
+{
+  const DHierCluster *cl;
+  int             c, i, num = 0;
+
+  if (n == DHIER_ROBOT || n == DHIER_GOAL)
+    c = n == DHIER_ROBOT ? hier->robotCluster : hier->goalCluster;
+  else {
+    c = hier->node[n].cluster;
+    buf[num++] = hier->node[n].twin;
+  }
+
+  cl = &hier->cluster[c];
+  for (i = 0; i < cl->numNodes; i++) {
+    if (cl->node[i] != n)
+      buf[num++] = cl->node[i];
+  }
+  if (c == hier->robotCluster && n != DHIER_ROBOT)
+    buf[num++] = DHIER_ROBOT;
+  if (c == hier->goalCluster && n != DHIER_GOAL)
+    buf[num++] = DHIER_GOAL;
+
+  return (num);
+}
+
+// The edges to the robot and from the goal are never on a path; they
+// are given the cost of the edge the other way.
+static inline double abstractCost(DHier * hier, int64_t to, int64_t from)
+{
+  const DHierNode *t = &hier->node[to];
+  const DHierNode *f = &hier->node[from];
+  const DHierCluster *cl;
+
+  if ((from == DHIER_ROBOT && to == DHIER_GOAL) || (from == DHIER_GOAL && to == DHIER_ROBOT))
+    return (hier->direct);
+  if (from == DHIER_ROBOT || to == DHIER_ROBOT)
+    return (hier->robotDist[from == DHIER_ROBOT ? t->slot : f->slot]);
+  if (from == DHIER_GOAL || to == DHIER_GOAL)
+    return (hier->goalDist[to == DHIER_GOAL ? f->slot : t->slot]);
+  if (f->twin == to)
+    return (hier->cost(t->cell, f->cell, hier->data));
+
+  cl = &hier->cluster[f->cluster];
+  return (cl->dist[f->slot * cl->numNodes + t->slot]);
+}
+
+static inline double abstractH(DHier * hier, int64_t n)
+{
+  return (cellDistance(hier, hier->node[n].cell, hier->node[DHIER_ROBOT].cell));
+}
+
+// an abstract node id, -1 if there is not enough memory
+static int64_t  newNode(DHier * hier, int64_t cell, int cluster)
+{
+  DHierNode      *grown;
+  int64_t        *grownFree, id;
+
+  if (hier->numFree > 0)
+    id = hier->freeNode[--hier->numFree];
+  else {
+    if (hier->numNodes == hier->nodeCapacity) {
+      grown = (DHierNode *) realloc(hier->node, sizeof(DHierNode) * 2 * hier->nodeCapacity);
+      if (grown == NULL)
+	return (-1);
+      hier->node = grown;
+      grownFree = (int64_t *) realloc(hier->freeNode, sizeof(int64_t) * 2 * hier->nodeCapacity);
+      if (grownFree == NULL)
+	return (-1);
+      hier->freeNode = grownFree;
+      hier->nodeCapacity *= 2;
+    }
+    id = hier->numNodes++;
+  }
+
+  hier->node[id].cell = cell;
+  hier->node[id].cluster = cluster;
+  hier->node[id].slot = 0;
+  hier->node[id].twin = -1;
+
+  return (id);
+}
+
+// 1 if the steps both ways between two neighboring cells cost less than blocked
+static int      crossing(const DHier * hier, int64_t a, int64_t b)
+{
+  return (hier->cost(b, a, hier->data) < hier->blocked && hier->cost(a, b, hier->data) < hier->blocked);
+}
+
+// a pair of nodes facing each other across a border
+static int      addEntrance(DHier * hier, DHierBorder * border, int64_t a, int c, int64_t b, int other)
+{
+  int64_t         na, nb;
+
+  na = newNode(hier, a, c);
+  nb = newNode(hier, b, other);
+  if (na < 0 || nb < 0)
+    return (-1);
+
+  hier->node[na].twin = nb;
+  hier->node[nb].twin = na;
+  border->node[border->numNodes++] = na;
+  border->node[border->numNodes++] = nb;
+
+  return (0);
+}
+
+// The entrances of border b.  A run of cells free to cross straight
+// over gets one entrance in the middle if it is short, one at each end
+// if not.  Where only a diagonal step crosses, that step is an entrance.
+static int      buildBorder(DHier * hier, int b)
+{
+  DHierBorder    *border = &hier->border[b];
+  int64_t        *grown, a, step, across;
+  int             c = b / 2, other, x0, y0, w, h, n, i, s, e;
+
+  clusterRect(hier, c, &x0, &y0, &w, &h);
+  if (b % 2 == 0) {
+    other = c + 1;
+    a = HCELL(hier, x0 + w - 1, y0);
+    step = hier->width;			       // along the border
+    across = 1;
+    n = h;
+  }
+  else {
+    other = c + hier->clustersX;
+    a = HCELL(hier, x0, y0 + h - 1);
+    step = 1;
+    across = hier->width;
+    n = w;
+  }
+
+  for (i = 0; i < border->numNodes; i++) {
+    hier->node[border->node[i]].cluster = -1;
+    hier->freeNode[hier->numFree++] = border->node[i];
+  }
+  border->numNodes = 0;
+  border->dirty = 0;
+  hier->cluster[c].dirty = 1;
+  hier->cluster[other].dirty = 1;
+
+  // at most three entrances per position, two nodes each
+  grown = (int64_t *) realloc(border->node, sizeof(int64_t) * 6 * n);
+  if (grown == NULL)
+    return (-1);
+  border->node = grown;
+
+  for (s = 0; s < n; s = e + 1) {
+    // the run starting at s ends before e
+    for (e = s; e < n && crossing(hier, a + e * step, a + e * step + across); e++);
+    if (e == s)
+      continue;
+
+    if (e - s < DHIER_RUN) {
+      if (addEntrance(hier, border, a + (s + e - 1) / 2 * step, c, a + (s + e - 1) / 2 * step + across, other) < 0)
+	return (-1);
+    }
+    else if (addEntrance(hier, border, a + s * step, c, a + s * step + across, other) < 0 ||
+	     addEntrance(hier, border, a + (e - 1) * step, c, a + (e - 1) * step + across, other) < 0)
+      return (-1);
+  }
+
+  for (i = 0; i + 1 < n; i++) {
+    if (crossing(hier, a + i * step, a + i * step + across) ||
+	crossing(hier, a + (i + 1) * step, a + (i + 1) * step + across))
+      continue;
+    if (crossing(hier, a + i * step, a + (i + 1) * step + across) &&
+	addEntrance(hier, border, a + i * step, c, a + (i + 1) * step + across, other) < 0)
+      return (-1);
+    if (crossing(hier, a + (i + 1) * step, a + i * step + across) &&
+	addEntrance(hier, border, a + (i + 1) * step, c, a + i * step + across, other) < 0)
+      return (-1);
+  }
+
+  // most borders have a few entrances, so give back the rest
+  grown = (int64_t *) realloc(border->node, sizeof(int64_t) * (border->numNodes > 0 ? border->numNodes : 1));
+  if (grown != NULL)
+    border->node = grown;
+
+  return (0);
+}
+
+// make room for a query of n starts and the distances of n nodes
+static int      reserveScratch(DHier * hier, int n)
+{
+  double         *d[2];
+  int64_t        *s[2];
+
+  if (n <= hier->scratchCapacity)
+    return (0);
+
+  d[0] = (double *)realloc(hier->robotDist, sizeof(double) * n);
+  if (d[0] != NULL)
+    hier->robotDist = d[0];
+  d[1] = (double *)realloc(hier->goalDist, sizeof(double) * n);
+  if (d[1] != NULL)
+    hier->goalDist = d[1];
+  s[0] = (int64_t *) realloc(hier->start, sizeof(int64_t) * n);
+  if (s[0] != NULL)
+    hier->start = s[0];
+  s[1] = (int64_t *) realloc(hier->offset, sizeof(int64_t) * (n + 1));
+  if (s[1] != NULL)
+    hier->offset = s[1];
+  if (d[0] == NULL || d[1] == NULL || s[0] == NULL || s[1] == NULL)
+    return (-1);
+
+  hier->scratchCapacity = n;
+  return (0);
+}
+
+// Costs from the hier->start cells to a cell of the current frame, or
+// from it to them if reverse is set, written to dist; the search stops
+// once they are all settled.  Returns a DSTAR status.
+static int      clusterCosts(DHier * hier, int64_t cell, int numStarts, int reverse, double *dist)
+{
+  double          costR[2] = { HUGE_VAL, HUGE_VAL };
+  int64_t         seed = cellLocal(hier, cell), path;
+  Node            node;
+  int             i, status;
+
+  if (numStarts == 0)
+    return (DSTAR_FOUND);
+
+  hier->reverse = reverse;
+  hier->focus = 0;
+  hier->localRobot = hier->start[0];
+  status = clusterPlannerSearch(hier->local, &seed, 1, costR, &path);
+  hier->stats.localExpanded += clusterPlannerExpanded(hier->local);
+  if (status == DSTAR_FOUND || status == DSTAR_NOPATH) {
+    status = clusterPlannerQuery(hier->local, hier->start, numStarts, &hier->localPath, &hier->localCapacity,
+				 hier->offset);
+    hier->stats.localExpanded += clusterPlannerExpanded(hier->local);
+  }
+  hier->reverse = 0;
+  if (status != DSTAR_FOUND && status != DSTAR_NOPATH)
+    return (status);
+
+  for (i = 0; i < numStarts; i++) {
+    clusterPlannerNode(hier->local, hier->start[i], &node);
+    dist[i] = hier->offset[i + 1] > hier->offset[i] ? node.g : HUGE_VAL;
+  }
+
+  return (DSTAR_FOUND);
+}
+
+// The abstract nodes of cluster c and the costs between them: one search
+// from each node, which stops once the others are settled
+static int      buildCluster(DHier * hier, int c)
+{
+  DHierCluster   *cl = &hier->cluster[c];
+  const DHierBorder *border[4];
+  int             cx = c % hier->clustersX, cy = c / hier->clustersX;
+  int             i, j, k, side, n, status;
+  int64_t        *grown;
+  double         *grownDist;
+
+  // this side of its own borders, the far side of its neighbors'
+  border[0] = cx < hier->clustersX - 1 ? &hier->border[2 * c] : NULL;
+  border[1] = cy < hier->clustersY - 1 ? &hier->border[2 * c + 1] : NULL;
+  border[2] = cx > 0 ? &hier->border[2 * (c - 1)] : NULL;
+  border[3] = cy > 0 ? &hier->border[2 * (c - hier->clustersX) + 1] : NULL;
+  for (n = 0, i = 0; i < 4; i++)
+    n += border[i] == NULL ? 0 : border[i]->numNodes / 2;
+
+  grown = (int64_t *) realloc(cl->node, sizeof(int64_t) * (n > 0 ? n : 1));
+  if (grown == NULL)
+    return (DSTAR_NOMEM);
+  cl->node = grown;
+  grownDist = (double *)realloc(cl->dist, sizeof(double) * (n > 0 ? n * n : 1));
+  if (grownDist == NULL)
+    return (DSTAR_NOMEM);
+  cl->dist = grownDist;
+
+  for (k = 0, i = 0; i < 4; i++) {
+    side = i < 2 ? 0 : 1;
+    for (j = side; border[i] != NULL && j < border[i]->numNodes; j += 2) {
+      cl->node[k] = border[i]->node[j];
+      hier->node[cl->node[k]].slot = k;
+      k++;
+    }
+  }
+  cl->numNodes = n;
+  cl->dirty = 0;
+  if (n > hier->maxNodes)
+    hier->maxNodes = n;
+  if (reserveScratch(hier, n + 1) < 0)
+    return (DSTAR_NOMEM);
+
+  // column j of the table holds the costs to node j
+  setFrame(hier, c);
+  for (j = 0; j < n; j++) {
+    for (k = 0, i = 0; i < n; i++) {
+      if (i != j)
+	hier->start[k++] = cellLocal(hier, hier->node[cl->node[i]].cell);
+    }
+    status = clusterCosts(hier, hier->node[cl->node[j]].cell, k, 0, hier->goalDist);
+    if (status != DSTAR_FOUND)
+      return (status);
+    for (k = 0, i = 0; i < n; i++)
+      cl->dist[i * n + j] = i == j ? 0.0 : hier->goalDist[k++];
+  }
+  hier->stats.rebuilt++;
+
+  return (DSTAR_FOUND);
+}
+
+// the borders, then the clusters, marked by DHierUpdate
+static int      rebuild(DHier * hier)
+{
+  int             numClusters = hier->clustersX * hier->clustersY, b, c, status;
+
+  for (b = 0; b < 2 * numClusters; b++) {
+    if (hier->border[b].dirty && buildBorder(hier, b) < 0)
+      return (DSTAR_NOMEM);
+  }
+  for (c = 0; c < numClusters; c++) {
+    if (hier->cluster[c].dirty && (status = buildCluster(hier, c)) != DSTAR_FOUND)
+      return (status);
+  }
+  hier->dirty = 0;
+
+  return (DSTAR_FOUND);
+}
+
+// a planner for the graph as it is, if the last one is too small
+static int      sizeAbstract(DHier * hier)
+{
+  DStarParams     params = hier->params;
+
+  if (hier->abstract != NULL && hier->abstract->numNodes >= hier->numNodes &&
+      hier->abstract->params.maxNeighbors >= hier->maxNodes + 2)
+    return (0);
+
+  abstractPlannerDestroy(hier->abstract);
+  params.maxNeighbors = hier->maxNodes + 2;
+  if (params.maxNeighbors < MAXNEIGHBORS)
+    params.maxNeighbors = MAXNEIGHBORS;
+  hier->abstract = abstractPlannerCreate(hier, 2 * hier->numNodes, &params);
+
+  return (hier->abstract == NULL ? -1 : 0);
+}
+
+// the cell after last, grown as needed
+static int      append(int64_t ** path, size_t * capacity, int64_t * length, int64_t cell)
+{
+  int64_t        *grown;
+  size_t          cap;
+
+  if ((size_t) * length == *capacity) {
+    cap = *capacity > 0 ? 2 * *capacity : 256;
+    grown = (int64_t *) realloc(*path, sizeof(int64_t) * cap);
+    if (grown == NULL)
+      return (-1);
+    *path = grown;
+    *capacity = cap;
+  }
+  (*path)[(*length)++] = cell;
+
+  return (0);
+}
+
+// the cells from one cell to another of cluster c, the first left out
+static int      refine(DHier * hier, int c, int64_t from, int64_t to, int64_t ** path, size_t * capacity,
+		       int64_t * length)
+{
+  double          costR[2] = { HUGE_VAL, HUGE_VAL };
+  int64_t         seed, n;
+  int             status;
+
+  if (from == to)
+    return (DSTAR_FOUND);
+
+  setFrame(hier, c);
+  seed = cellLocal(hier, to);
+  hier->localRobot = cellLocal(hier, from);
+  hier->focus = 1;
+  status = clusterPlannerSearch(hier->local, &seed, 1, costR, &n);
+  hier->stats.localExpanded += clusterPlannerExpanded(hier->local);
+  hier->stats.refined++;
+  if (status != DSTAR_FOUND)
+    return (status);
+
+  for (n = clusterPlannerParent(hier->local, hier->localRobot); n >= 0; n = clusterPlannerParent(hier->local, n)) {
+    if (append(path, capacity, length, localCell(hier, n)) < 0)
+      return (DSTAR_NOMEM);
+  }
+
+  return (DSTAR_FOUND);
+}
+
+DHier          *DHierCreate(int width, int height, int clusterSize, DHierCost cost, void *data,
+			    double blocked, const DStarParams * params)
+{
+  DHier          *hier;
+  DStarParams     local;
+  int             numClusters, c;
+
+  if (width < 1 || height < 1 || clusterSize < 2)
+    return (NULL);
+
+  hier = (DHier *) calloc(1, sizeof(DHier));
+  if (hier == NULL)
+    return (NULL);
+
+  hier->width = width;
+  hier->height = height;
+  hier->size = clusterSize;
+  hier->clustersX = (width + clusterSize - 1) / clusterSize;
+  hier->clustersY = (height + clusterSize - 1) / clusterSize;
+  hier->cost = cost;
+  hier->data = data;
+  hier->blocked = blocked;
+  if (params != NULL)
+    hier->params = *params;
+  else
+    DStarDefaultParams(&hier->params);
+  hier->localRobot = -1;
+  hier->robotCluster = hier->goalCluster = -1;
+
+  numClusters = hier->clustersX * hier->clustersY;
+  hier->cluster = (DHierCluster *) calloc(numClusters, sizeof(DHierCluster));
+  hier->border = (DHierBorder *) calloc(2 * numClusters, sizeof(DHierBorder));
+  hier->nodeCapacity = 256;
+  hier->node = (DHierNode *) malloc(sizeof(DHierNode) * hier->nodeCapacity);
+  hier->freeNode = (int64_t *) malloc(sizeof(int64_t) * hier->nodeCapacity);
+
+  // searches inside a cluster have no limit and settle exactly
+  DStarDefaultParams(&local);
+  local.maxExpand = 0;
+  local.engine = DSTAR_ENGINE_LITE;
+  hier->local = clusterPlannerCreate(hier, (int64_t) clusterSize * clusterSize, &local);
+
+  if (hier->cluster == NULL || hier->border == NULL || hier->node == NULL || hier->freeNode == NULL ||
+      hier->local == NULL || reserveScratch(hier, 16) < 0) {
+    DHierDestroy(hier);
+    return (NULL);
+  }
+
+  // the robot and the goal, then everything to build
+  hier->numNodes = 2;
+  hier->node[DHIER_ROBOT].twin = hier->node[DHIER_GOAL].twin = -1;
+  for (c = 0; c < numClusters; c++) {
+    hier->cluster[c].dirty = 1;
+    hier->border[2 * c].dirty = c % hier->clustersX < hier->clustersX - 1;
+    hier->border[2 * c + 1].dirty = c / hier->clustersX < hier->clustersY - 1;
+  }
+  hier->dirty = 1;
+
+  return (hier);
+}
+
+void            DHierDestroy(DHier * hier)
+{
+  int             c;
+
+  if (hier == NULL)
+    return;
+
+  for (c = 0; hier->cluster != NULL && c < hier->clustersX * hier->clustersY; c++) {
+    free(hier->cluster[c].node);
+    free(hier->cluster[c].dist);
+  }
+  for (c = 0; hier->border != NULL && c < 2 * hier->clustersX * hier->clustersY; c++)
+    free(hier->border[c].node);
+  free(hier->cluster);
+  free(hier->border);
+  free(hier->node);
+  free(hier->freeNode);
+  abstractPlannerDestroy(hier->abstract);
+  clusterPlannerDestroy(hier->local);
+  free(hier->robotDist);
+  free(hier->goalDist);
+  free(hier->start);
+  free(hier->offset);
+  free(hier->localPath);
+  free(hier);
+}
+
+void            DHierUpdate(DHier * hier, const int64_t * cell, int64_t numCells)
+{
+  int64_t         i;
+  int             x, y, c, cx, cy;
+
+  for (i = 0; i < numCells; i++) {
+    if (cell[i] < 0 || cell[i] >= (int64_t) hier->width * hier->height)
+      continue;
+    x = (int)(cell[i] % hier->width);
+    y = (int)(cell[i] / hier->width);
+    cx = x / hier->size;
+    cy = y / hier->size;
+    c = cy * hier->clustersX + cx;
+
+    // a cell on the edge of its cluster is on a border as well
+    hier->cluster[c].dirty = 1;
+    if (x % hier->size == hier->size - 1 && cx < hier->clustersX - 1)
+      hier->border[2 * c].dirty = 1;
+    if (x % hier->size == 0 && cx > 0)
+      hier->border[2 * (c - 1)].dirty = 1;
+    if (y % hier->size == hier->size - 1 && cy < hier->clustersY - 1)
+      hier->border[2 * c + 1].dirty = 1;
+    if (y % hier->size == 0 && cy > 0)
+      hier->border[2 * (c - hier->clustersX) + 1].dirty = 1;
+    hier->dirty = 1;
+  }
+}
+
+int             DHierPlan(DHier * hier, int64_t robot, int64_t goal, int64_t ** path, size_t * capacity,
+			  int64_t * length)
+{
+  double          costR[2] = { HUGE_VAL, HUGE_VAL };
+  double          t, dist[1];
+  const DHierCluster *cl;
+  int64_t         n, p, seed = DHIER_GOAL;
+  int             c, i, status;
+
+  memset(&hier->stats, 0, sizeof(DHierStats));
+  *length = 0;
+  if (append(path, capacity, length, robot) < 0)
+    return (DSTAR_NOMEM);
+  if (robot == goal)
+    return (DSTAR_FOUND);
+
+  t = DStarNow();
+  if (hier->dirty && (status = rebuild(hier)) != DSTAR_FOUND)
+    return (status);
+  hier->stats.seconds[0] = DStarNow() - t;
+
+  // join the goal and the robot to the nodes of their clusters
+  t = DStarNow();
+  hier->node[DHIER_ROBOT].cell = robot;
+  hier->node[DHIER_GOAL].cell = goal;
+  hier->robotCluster = cellCluster(hier, robot);
+  hier->goalCluster = cellCluster(hier, goal);
+  hier->node[DHIER_ROBOT].cluster = hier->robotCluster;
+  hier->node[DHIER_GOAL].cluster = hier->goalCluster;
+
+  cl = &hier->cluster[hier->goalCluster];
+  setFrame(hier, hier->goalCluster);
+  for (i = 0; i < cl->numNodes; i++)
+    hier->start[i] = cellLocal(hier, hier->node[cl->node[i]].cell);
+  if ((status = clusterCosts(hier, goal, cl->numNodes, 0, hier->goalDist)) != DSTAR_FOUND)
+    return (status);
+
+  cl = &hier->cluster[hier->robotCluster];
+  setFrame(hier, hier->robotCluster);
+  for (i = 0; i < cl->numNodes; i++)
+    hier->start[i] = cellLocal(hier, hier->node[cl->node[i]].cell);
+  if ((status = clusterCosts(hier, robot, cl->numNodes, 1, hier->robotDist)) != DSTAR_FOUND)
+    return (status);
+
+  hier->direct = HUGE_VAL;
+  if (hier->robotCluster == hier->goalCluster) {
+    hier->start[0] = cellLocal(hier, goal);
+    if ((status = clusterCosts(hier, robot, 1, 1, dist)) != DSTAR_FOUND)
+      return (status);
+    hier->direct = dist[0];
+  }
+
+  // D* over the abstract graph, from the goal
+  if (sizeAbstract(hier) < 0)
+    return (DSTAR_NOMEM);
+  status = abstractPlannerSearch(hier->abstract, &seed, 1, costR, &n);
+  hier->stats.nodes = hier->numNodes - hier->numFree;
+  hier->stats.expanded = abstractPlannerExpanded(hier->abstract);
+  hier->stats.seconds[1] = DStarNow() - t;
+  if (status != DSTAR_FOUND)
+    return (status);
+
+  // then the cells, cluster by cluster; nodes on either side of a
+  // border are one step apart
+  t = DStarNow();
+  for (n = DHIER_ROBOT; n != DHIER_GOAL; n = p) {
+    p = abstractPlannerParent(hier->abstract, n);
+    if (p < 0)
+      return (DSTAR_NOPATH);
+
+    if (n != DHIER_ROBOT && hier->node[n].twin == p)
+      status = append(path, capacity, length, hier->node[p].cell) < 0 ? DSTAR_NOMEM : DSTAR_FOUND;
+    else {
+      c = n == DHIER_ROBOT ? hier->robotCluster : hier->node[n].cluster;
+      status = refine(hier, c, hier->node[n].cell, hier->node[p].cell, path, capacity, length);
+    }
+    if (status != DSTAR_FOUND)
+      return (status);
+  }
+  hier->stats.seconds[2] = DStarNow() - t;
+
+  return (DSTAR_FOUND);
+}
+
+void            DHierPlanStats(const DHier * hier, DHierStats * stats)
+{
+  *stats = hier->stats;
+}
+
+size_t          DHierBytes(const DHier * hier)
+{
+  size_t          bytes = sizeof(DHier);
+  int             c, numClusters = hier->clustersX * hier->clustersY;
+
+  bytes += (sizeof(DHierCluster) + 2 * sizeof(DHierBorder)) * numClusters;
+  for (c = 0; c < numClusters; c++) {
+    bytes += (sizeof(int64_t) + hier->cluster[c].numNodes * sizeof(double)) * hier->cluster[c].numNodes;
+    bytes += sizeof(int64_t) * (hier->border[2 * c].numNodes + hier->border[2 * c + 1].numNodes);
+  }
+  bytes += (sizeof(DHierNode) + sizeof(int64_t)) * hier->nodeCapacity;
+  bytes += (2 * sizeof(double) + 2 * sizeof(int64_t)) * hier->scratchCapacity;
+  bytes += sizeof(int64_t) * hier->localCapacity;
+  bytes += clusterPlannerBytes(hier->local);
+  if (hier->abstract != NULL)
+    bytes += abstractPlannerBytes(hier->abstract);
+
+  return (bytes);
+}
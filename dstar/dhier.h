@@ -0,0 +1,69 @@
+// Include file for the hierarchical planner for large grids
+
+#ifndef DHIER_H
+#define DHIER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dstar.h"
+
+// A hierarchy splits an 8-connected width x height grid into square
+// clusters.  Wherever the cells on both sides of a cluster border are
+// free for a run, the run gets an entrance, one in the middle of a short
+// run and one at each end of a long one; a diagonal step that is the only
+// way across gets one as well.  Each entrance is a pair of abstract
+// nodes, one on each side.  Within a cluster the cost between every two
+// of its abstract nodes is found once and kept.  A plan joins the robot
+// and the goal to the abstract nodes of their clusters, runs D* over the
+// abstract graph from the goal, then finds the cells of the path only
+// inside the clusters it passes through.
+//
+// Paths can only cross borders at entrances, and never diagonally through
+// a corner where four clusters meet, so a long path is typically a few
+// percent longer than the best one; a short one can be much longer.
+// Cells given to DHierUpdate only rebuild the clusters and borders they
+// are in, and that is done at the start of the next plan.  A cost of
+// blocked or more is an obstacle to the entrances; inside a cluster,
+// steps through obstacles are taken at their cost, the same as a flat
+// planner does.
+typedef struct DHier DHier;
+
+// cost of the step from one cell to a neighbor, the same as the cost
+// callback of an index planner
+typedef double (*DHierCost)(int64_t to, int64_t from, void *data);
+
+// what the last plan did
+typedef struct {
+  int64_t         nodes;		       // abstract nodes in the graph
+  int64_t         rebuilt;		       // clusters rebuilt before it
+  int64_t         expanded;		       // by the search of the abstract graph
+  int64_t         localExpanded;	       // by the searches inside clusters
+  int64_t         refined;		       // clusters the path was found in
+  double          seconds[3];		       // rebuilding, abstract search, refining
+} DHierStats;
+
+// function prototypes
+
+// A hierarchy with clusters clusterSize cells on a side; params are those
+// of the abstract search and may be NULL.  NULL if there is not enough
+// memory.  Nothing is built until the first plan.
+DHier *DHierCreate(int width, int height, int clusterSize, DHierCost cost, void *data,
+		   double blocked, const DStarParams *params);
+void DHierDestroy(DHier *hier);
+
+// the step costs into or out of these cells have changed
+void DHierUpdate(DHier *hier, const int64_t *cell, int64_t numCells);
+
+// Plans from robot to goal.  The cells of the path, robot first, go in
+// (*path)[0] .. (*path)[*length - 1]; *path holds *capacity cells and is
+// grown with realloc as needed (start with NULL and 0).  Returns
+// DSTAR_FOUND, DSTAR_NOPATH if no free path crosses the borders between
+// them, DSTAR_NOMEM, or what stopped the abstract search.
+int DHierPlan(DHier *hier, int64_t robot, int64_t goal, int64_t **path, size_t *capacity, int64_t *length);
+
+void DHierPlanStats(const DHier *hier, DHierStats *stats);
+
+// memory owned by the hierarchy, planners included
+size_t DHierBytes(const DHier *hier);
+
+#endif
@@ -0,0 +1,370 @@
+/*
+	Flat and hierarchical planning on a large grid
+
+	Plans across a W x H grid scattered with rectangular obstacles, once
+	with an index planner over every cell and once with the hierarchy of
+	dhier.h, both using the cost function of dmain.c.  The hierarchy is
+	built by its first plan; the second shows a plan on a built one.
+	Then a wall drops across the middle of the map: the flat planner
+	replans from the wall cells and the hierarchy rebuilds the clusters
+	under them.  For each it reports the nodes expanded, the time and the
+	cost of the path.
+
+	build:	cc -O2 -o dlarge dlarge.c dstar.c dmap.c dtrace.c dhier.c dcostmap.c -lm
+	usage:	dlarge [-l] [-s clustersize] [-m costmap] [-w snapshot] [width height [obstacles [seed]]]
+
+	-l runs both with D* Lite; the cluster size defaults to 64.  -m plans
+	on a costmap file made by dconvert instead of scattered rectangles;
+	it is mapped, not read, and the time that takes is reported.  The
+	robot and the goal go to the first free cells at or after the usual
+	places, and the wall is dropped into the mapped copy, not the file.
+	-w saves the flat planner to a snapshot file after its search, then
+	replaces it with one loaded from the file, as a restarted process
+	would, and the flat replan runs on that.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include "dstar.h"
+#include "dmap.h"
+#include "dhier.h"
+#include "dcostmap.h"
+
+int gblGridX = 2000;
+int gblGridY = 2000;
+int gblRobot[2];
+int gblGoal[2];
+DMap *gblMap;
+DCostMap *gblCostMap;		// the map if one was given with -m
+
+#define CELL(x, y) ((int64_t)(y) * gblGridX + (x))
+
+// the callbacks of dmain.c's compact planner
+double cellCost(int64_t to, int64_t from, void *data);
+double cellCost(int64_t to, int64_t from, void *data) {
+	if(gblCostMap != NULL)
+		return(DCostMapStepCost(gblCostMap, to, from));
+	return(DMapStepCost(gblMap, to, from));
+}
+
+double cellH(int64_t cell, void *data);
+double cellH(int64_t cell, void *data) {
+	double dx, dy;
+
+	dx = gblRobot[0] - cell % gblGridX;
+	dy = gblRobot[1] - cell / gblGridX;
+
+	return(sqrt(dx*dx + dy*dy));
+}
+
+int cellRobot(int64_t cell, void *data);
+int cellRobot(int64_t cell, void *data) {
+	return(cell == CELL(gblRobot[0], gblRobot[1]));
+}
+
+int cellNeighbors(int64_t cell, int64_t *neighbor, void *data);
+int cellNeighbors(int64_t cell, int64_t *neighbor, void *data) {
+	int deltax[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+	int deltay[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+	int i, x, y, n;
+
+	n = 0;
+	for(i=0;i<8;i++) {
+		x = cell % gblGridX + deltax[i];
+		y = cell / gblGridX + deltay[i];
+		if(x >= 0 && x < gblGridX && y >= 0 && y < gblGridY)
+			neighbor[n++] = CELL(x, y);
+	}
+
+	return(n);
+}
+
+int occupied(int x, int y);
+int occupied(int x, int y) {
+	if(gblCostMap != NULL)
+		return(DCostMapCell(gblCostMap, CELL(x, y)) == DCOSTMAP_LETHAL);
+	return(DMapOccupied(gblMap, x, y));
+}
+
+// the robot and goal near opposite corners
+void placeEnds(void);
+void placeEnds(void) {
+	gblGoal[0] = gblGridX - 1 - gblGridX / 20;
+	gblGoal[1] = gblGridY - 1 - gblGridY / 20;
+	gblRobot[0] = gblGridX / 20;
+	gblRobot[1] = gblGridY / 20;
+}
+
+// moves a place on a costmap to the first free cell at or after it
+void freeAfter(int *xy);
+void freeAfter(int *xy) {
+	int64_t cell, end = (int64_t)gblGridX * gblGridY;
+
+	for(cell=CELL(xy[0], xy[1]);cell<end && occupied(cell % gblGridX, cell / gblGridX);cell++)
+		;
+	if(cell < end) {
+		xy[0] = cell % gblGridX;
+		xy[1] = cell / gblGridX;
+	}
+}
+
+// random rectangles, leaving the robot and goal in clear squares
+void scatter(int numObstacles, unsigned int seed);
+void scatter(int numObstacles, unsigned int seed) {
+	int i, x, y, w, h;
+
+	srand(seed);
+	for(i=0;i<numObstacles;i++) {
+		w = 1 + rand() % (gblGridX / 20 + 1);
+		h = 1 + rand() % (gblGridY / 20 + 1);
+		x = rand() % gblGridX;
+		y = rand() % gblGridY;
+		DMapAddRect(gblMap, y + h - 1, x, y, x + w - 1);
+	}
+	DMapClearRect(gblMap, gblGoal[1] + gblGridY / 20, gblGoal[0] - gblGridX / 20,
+		      gblGoal[1] - gblGridY / 20, gblGoal[0] + gblGridX / 20);
+	DMapClearRect(gblMap, gblRobot[1] + gblGridY / 20, gblRobot[0] - gblGridX / 20,
+		      gblRobot[1] - gblGridY / 20, gblRobot[0] + gblGridX / 20);
+}
+
+// the wall that drops later: a bar two cells thick across the middle of
+// the diagonal
+int64_t wallCells(int64_t *wall);
+int64_t wallCells(int64_t *wall) {
+	int64_t numWall;
+	int i, x, y, m;
+
+	numWall = 0;
+	m = (gblGridX < gblGridY ? gblGridX : gblGridY) / 4;
+	for(i=-m;i<=m;i++) {
+		x = gblGridX / 2 + i;
+		y = gblGridY / 2 - i;
+		if(x >= 0 && x < gblGridX && y >= 0 && y < gblGridY && !occupied(x, y)) {
+			wall[numWall++] = CELL(x, y);
+			if(x + 1 < gblGridX && !occupied(x + 1, y))
+				wall[numWall++] = CELL(x + 1, y);
+		}
+	}
+
+	return(numWall);
+}
+
+// cost of the path the flat planner's backpointers give from the robot
+double flatCost(DStarPlanner *planner);
+double flatCost(DStarPlanner *planner) {
+	int64_t cell, parent;
+	double cost = 0.0;
+
+	for(cell=CELL(gblRobot[0], gblRobot[1]);(parent = DStarPlannerParent(planner, cell)) >= 0;cell=parent)
+		cost += cellCost(parent, cell, NULL);
+
+	return(cost);
+}
+
+// cost of a path of cells
+double pathCost(int64_t *path, int64_t length);
+double pathCost(int64_t *path, int64_t length) {
+	double cost = 0.0;
+	int64_t i;
+
+	for(i=0;i+1<length;i++)
+		cost += cellCost(path[i+1], path[i], NULL);
+
+	return(cost);
+}
+
+// one line of the table for a hierarchical plan
+void printHier(char *name, DHier *hier, int status, int64_t *path, int64_t length);
+void printHier(char *name, DHier *hier, int status, int64_t *path, int64_t length) {
+	DHierStats stats;
+
+	DHierPlanStats(hier, &stats);
+	if(status != DSTAR_FOUND) {
+		printf("%-12s status %d\n", name, status);
+		return;
+	}
+	printf("%-12s %12" PRId64 " %12.2f %12.2f   %" PRId64 " abstract + %" PRId64 " in clusters, %" PRId64
+	       " rebuilt, %" PRId64 " refined; %.1f + %.1f + %.1f ms\n",
+	       name, stats.expanded + stats.localExpanded,
+	       1e3 * (stats.seconds[0] + stats.seconds[1] + stats.seconds[2]), pathCost(path, length),
+	       stats.expanded, stats.localExpanded, stats.rebuilt, stats.refined,
+	       1e3 * stats.seconds[0], 1e3 * stats.seconds[1], 1e3 * stats.seconds[2]);
+}
+
+int main(int argc, char *argv[]) {
+	int numObstacles = 400, clusterSize = 64, engine = DSTAR_ENGINE_DSTAR;
+	char *costMapName = NULL, *snapshotName = NULL;
+	FILE *fp;
+	unsigned int seed = 1;
+	int64_t *wall, numWall, *seeds, numSeeds, cell, pathCell, *path = NULL, length, i;
+	size_t capacity = 0;
+	double costR[2], t;
+	DStarIndexCallbacks icb;
+	DStarParams params;
+	DStarPlanner *planner;
+	DHier *hier;
+	DHierStats stats;
+	Node node;
+	int status;
+
+	for(argc--,argv++;argc>0 && argv[0][0] == '-';argc--,argv++) {
+		if(strcmp(argv[0], "-l") == 0)
+			engine = DSTAR_ENGINE_LITE;
+		else if(strcmp(argv[0], "-s") == 0 && argc > 1) {
+			clusterSize = atoi(argv[1]);
+			argc--, argv++;
+		}
+		else if(strcmp(argv[0], "-m") == 0 && argc > 1) {
+			costMapName = argv[1];
+			argc--, argv++;
+		}
+		else if(strcmp(argv[0], "-w") == 0 && argc > 1) {
+			snapshotName = argv[1];
+			argc--, argv++;
+		}
+		else {
+			printf("usage: dlarge [-l] [-s clustersize] [-m costmap] [-w snapshot] [width height [obstacles [seed]]]\n");
+			return(1);
+		}
+	}
+	if(argc > 1) {
+		gblGridX = atoi(argv[0]);
+		gblGridY = atoi(argv[1]);
+	}
+	if(argc > 2)
+		numObstacles = atoi(argv[2]);
+	if(argc > 3)
+		seed = atoi(argv[3]);
+	if(costMapName != NULL) {
+		t = DStarNow();
+		gblCostMap = DCostMapOpen(costMapName);
+		if(gblCostMap == NULL) {
+			printf("Unable to map %s: %s\n", costMapName, strerror(errno));
+			return(1);
+		}
+		printf("mapped %s in %.3f ms\n", costMapName, 1e3 * (DStarNow() - t));
+		gblGridX = gblCostMap->width;
+		gblGridY = gblCostMap->height;
+	}
+	if(gblGridX < 20 || gblGridY < 20 || clusterSize < 2) {
+		printf("The grid must be at least 20 x 20 and the clusters at least 2 cells\n");
+		return(1);
+	}
+
+	gblMap = gblCostMap != NULL ? NULL : DMapCreate(gblGridX, gblGridY);
+	wall = (int64_t *)malloc(sizeof(int64_t) * ((int64_t)gblGridX + gblGridY + 2));
+	seeds = (int64_t *)malloc(sizeof(int64_t) * ((int64_t)gblGridX + gblGridY + 2));
+	if((gblMap == NULL && gblCostMap == NULL) || wall == NULL || seeds == NULL) {
+		printf("Not enough memory for the map\n");
+		return(1);
+	}
+	placeEnds();
+	if(gblCostMap != NULL) {
+		freeAfter(gblRobot);
+		freeAfter(gblGoal);
+	}
+	else
+		scatter(numObstacles, seed);
+	numWall = wallCells(wall);
+
+	DStarDefaultParams(&params);
+	params.maxExpand = 0;
+	params.engine = engine;
+	icb.hcalc = cellH;
+	icb.robotNode = cellRobot;
+	icb.neighbors = cellNeighbors;
+	icb.cost = cellCost;
+	icb.printNode = NULL;
+	icb.pruneNeighbors = NULL;
+	icb.data = NULL;
+	planner = DStarPlannerCreateIndex(&icb, (int64_t)gblGridX * gblGridY, &params);
+	hier = DHierCreate(gblGridX, gblGridY, clusterSize, cellCost, NULL, DMAP_OBSTACLE, &params);
+	if(planner == NULL || hier == NULL) {
+		printf("Not enough memory for the planners\n");
+		return(1);
+	}
+
+	if(gblCostMap != NULL)
+		printf("%d x %d costmap, %d x %d clusters, %s\n", gblGridX, gblGridY,
+		       clusterSize, clusterSize, engine == DSTAR_ENGINE_LITE ? "D* Lite" : "D*");
+	else
+		printf("%d x %d grid, %d obstacles, seed %u, %d x %d clusters, %s\n", gblGridX, gblGridY, numObstacles, seed,
+		       clusterSize, clusterSize, engine == DSTAR_ENGINE_LITE ? "D* Lite" : "D*");
+	printf("%-12s %12s %12s %12s\n", "", "expanded", "ms", "pathcost");
+
+	// the flat search
+	costR[0] = costR[1] = 1e+7;
+	cell = CELL(gblGoal[0], gblGoal[1]);
+	t = DStarNow();
+	DStarPlannerSearchIndex(planner, &cell, 1, costR, &pathCell);
+	printf("%-12s %12" PRId64 " %12.2f %12.2f\n", "flat", DStarPlannerExpanded(planner),
+	       1e3 * (DStarNow() - t), flatCost(planner));
+
+	// the hierarchy: built by the first plan, then planned again
+	status = DHierPlan(hier, CELL(gblRobot[0], gblRobot[1]), CELL(gblGoal[0], gblGoal[1]), &path, &capacity, &length);
+	printHier("hier build", hier, status, path, length);
+	status = DHierPlan(hier, CELL(gblRobot[0], gblRobot[1]), CELL(gblGoal[0], gblGoal[1]), &path, &capacity, &length);
+	printHier("hier plan", hier, status, path, length);
+
+	// a warm restart: the flat planner goes on from its snapshot
+	if(snapshotName != NULL) {
+		t = DStarNow();
+		fp = fopen(snapshotName, "wb");
+		if(fp == NULL || DStarPlannerSave(planner, fp) < 0) {
+			printf("Unable to write %s\n", snapshotName);
+			return(1);
+		}
+		fclose(fp);
+		printf("snapshot saved in %.2f ms", 1e3 * (DStarNow() - t));
+		DStarPlannerDestroy(planner);
+		t = DStarNow();
+		planner = DStarPlannerLoadIndex(&icb, snapshotName);
+		if(planner == NULL) {
+			printf("\nUnable to load %s: %s\n", snapshotName, strerror(errno));
+			return(1);
+		}
+		printf(", loaded in %.3f ms\n", 1e3 * (DStarNow() - t));
+	}
+
+	// drop the wall, replan from the wall cells on the flat tree and
+	// update the hierarchy under them
+	for(i=0;i<numWall;i++) {
+		if(gblCostMap != NULL)
+			DCostMapSetCell(gblCostMap, wall[i], DCOSTMAP_LETHAL);
+		else
+			DMapSetCell(gblMap, wall[i], 1);
+	}
+	for(numSeeds=0,i=0;i<numWall;i++) {
+		if(DStarPlannerParent(planner, wall[i]) >= 0)
+			seeds[numSeeds++] = wall[i];
+	}
+	DStarPlannerNode(planner, CELL(gblRobot[0], gblRobot[1]), &node);
+	costR[0] = node.f;
+	costR[1] = node.g;
+	t = DStarNow();
+	DStarPlannerReplanIndex(planner, seeds, numSeeds, costR, &pathCell);
+	printf("%-12s %12" PRId64 " %12.2f %12.2f\n", "flat replan", DStarPlannerExpanded(planner),
+	       1e3 * (DStarNow() - t), flatCost(planner));
+
+	DHierUpdate(hier, wall, numWall);
+	status = DHierPlan(hier, CELL(gblRobot[0], gblRobot[1]), CELL(gblGoal[0], gblGoal[1]), &path, &capacity, &length);
+	printHier("hier update", hier, status, path, length);
+
+	DHierPlanStats(hier, &stats);
+	printf("flat planner %.1f MB, hierarchy %.1f MB with %" PRId64 " abstract nodes\n",
+	       DStarPlannerBytes(planner) / 1e6, DHierBytes(hier) / 1e6, stats.nodes);
+
+	free(path);
+	DHierDestroy(hier);
+	DStarPlannerDestroy(planner);
+	DMapDestroy(gblMap);
+	DCostMapClose(gblCostMap);
+	free(wall);
+	free(seeds);
+
+	return(0);
+}
@@ -12,15 +12,23 @@
 // Include files
 #include <stdio.h>
 #include <stdlib.h>
+#include <inttypes.h>
 #include <math.h>
 #include "dstar.h"
+#include "dmap.h"
+#include "dtrace.h"
 #include <unistd.h>
 
-// global variables: goal configuration, initial configuration, obstacles
+// global variables: grid size, goal configuration, initial configuration, obstacles
+int gblGridX = 60;
+int gblGridY = 20;
 int gblGoal[2] = {50, 15};
 int gblRobot[2] = {10, 5};
-char gblImage[GRIDY + 1][GRIDX + 1];
-//double elev[GRIDY][GRIDX];
+char **gblImage;
+//double elev[gblGridY][gblGridX];
+
+// index of the grid cell at (x, y); 64 bits so grids can pass 2^31 cells
+#define CELL(x, y) ((int64_t)(y) * gblGridX + (x))
 		
 // define the number of obstacles here
 int gblNumObstacles=2;
@@ -31,6 +39,10 @@ int gblObstacle[gblMaxObstacles][4] = { 17, 15, 0, 17,
 					12, 5, 10, 15,
 					18, 30, 10, 35};
 
+// the obstacles in effect, as an occupancy bitmap; each rectangle is added
+// to it when gblNumObstacles grows to include it
+DMap *gblMap;
+
 // NodeInfo structure
 typedef struct {
 	int	x;
@@ -40,41 +52,54 @@ typedef struct {
 Node *gblGrid;
 NodeInfo *gblInfo;
 
+// node storage: Node structs, or the planner's own compact arrays (-c)
+int gblCompact = 0;
+DStarPlanner *gblPlanner;
+
+// search engine: D*, D* Lite (-l) or Anytime D* (-a)
+int gblEngine = DSTAR_ENGINE_DSTAR;
+
+// file to record the session in for dreplay (-t file), NULL for none
+char *gblTraceName = NULL;
+
+// robots of the fleet sent to the goal after the first search (-f n)
+int gblFleet = 0;
+
 //double 
 
 // Test for whether a point is in an obstacle or not
 int inObstacle(int x, int y);
 int inObstacle(int x, int y) {
-	int i;
 	
 	// uncomment this to remove the obstacles
 	// return(0);
 	
-	for(i=0;i<gblNumObstacles;i++) {
-		if(y <= gblObstacle[i][0] && y >= gblObstacle[i][2] && 
-			x >= gblObstacle[i][1] && x <= gblObstacle[i][3])
-			return(1);
-	}
+	if(x < 0 || x >= gblGridX || y < 0 || y >= gblGridY)
+		return(0);
 	
-	return(0);
+	return(DMapOccupied(gblMap, x, y));
 }
 
-double cost(Node *to, Node *from);
-double cost(Node *to, Node *from) {
-	double dx, dy;
+// cost of the step from (fx, fy) to the neighboring cell (tx, ty): 1 or
+// sqrt(2) from the map's step table, plus 1e+7 into an obstacle
+double stepCost(int tx, int ty, int fx, int fy);
+double stepCost(int tx, int ty, int fx, int fy) {
+	return(DMapStepCost(gblMap, CELL(tx, ty), CELL(fx, fy)));
+}
+
+double cost(Node *to, Node *from, void *data);
+double cost(Node *to, Node *from, void *data) {
+	NodeInfo *ti, *fi;
 	
-	dx = ((NodeInfo *)to->nodeInfo)->x - ((NodeInfo *)from->nodeInfo)->x;
-	dy = ((NodeInfo *)to->nodeInfo)->y - ((NodeInfo *)from->nodeInfo)->y;
+	ti = (NodeInfo *)to->nodeInfo;
+	fi = (NodeInfo *)from->nodeInfo;
 
-	if(inObstacle(((NodeInfo *)to->nodeInfo)->x, ((NodeInfo *)to->nodeInfo)->y))
-		return(1e+7 + sqrt(dx*dx + dy*dy));
-	else
-		return(sqrt(dx*dx + dy*dy));
+	return(stepCost(ti->x, ti->y, fi->x, fi->y));
 }
 
 // define the g function as parent plus a step
-double gfunction(Node *p);
-double gfunction(Node *p) {
+double gfunction(Node *p, void *data);
+double gfunction(Node *p, void *data) {
 	Node *q;
 	
 	if(p == NULL)
@@ -86,12 +111,13 @@ double gfunction(Node *p) {
 	// This uses movement from the initial state
 	q = (Node *)p->parent;
 
-	return(q->g + cost(q, p));
+	return(q->g + cost(q, p, data));
 }
 
-// define the h function as Euclidean distance to the robot
-double hfunction(Node *p);
-double hfunction(Node *p) {
+// define the h function as Euclidean distance to the robot at data
+double hfunction(Node *p, void *data);
+double hfunction(Node *p, void *data) {
+	int *robot = (int *)data;
 	NodeInfo *ni;
 	double h, dx, dy;
 	
@@ -104,23 +130,49 @@ double hfunction(Node *p) {
 	// return(0);
 	
 	// Uncomment this to use Euclidean distance
-	dx = gblRobot[0] - ni->x;
-	dy = gblRobot[1] - ni->y;
+	dx = robot[0] - ni->x;
+	dy = robot[1] - ni->y;
 	h = sqrt(dx * dx + dy * dy);
 	
 	return(h);
 }
 
+// The same callbacks for the compact storage, where a node is just its cell
+// index and the coordinates come from the index
+double cellCost(int64_t to, int64_t from, void *data);
+double cellCost(int64_t to, int64_t from, void *data) {
+	return(DMapStepCost(gblMap, to, from));
+}
+
+double cellH(int64_t cell, void *data);
+double cellH(int64_t cell, void *data) {
+	int *robot = (int *)data;
+	double dx, dy;
+	
+	dx = robot[0] - cell % gblGridX;
+	dy = robot[1] - cell / gblGridX;
+	
+	return(sqrt(dx * dx + dy * dy));
+}
+
+int cellRobot(int64_t cell, void *data);
+int cellRobot(int64_t cell, void *data) {
+	int *pos = (int *)data;
+	
+	return(cell == CELL(pos[0], pos[1]));
+}
+
 	
 
-// define the robotNode function
-int robot(Node *p);
-int robot(Node *p) {
+// define the robotNode function, data is the robot position
+int robot(Node *p, void *data);
+int robot(Node *p, void *data) {
+	int *pos = (int *)data;
 	NodeInfo *ni;
 	
 	ni = (NodeInfo *)p->nodeInfo;
 	
-	if(ni->x == gblRobot[0] & ni->y == gblRobot[1])
+	if(ni->x == pos[0] & ni->y == pos[1])
 		return(1);
 	
 	return(0);
@@ -151,8 +203,8 @@ int goal(Node *p) {
 #define SOUTHEAST 7
 
 // define the children function
-int getNeighbors(Node *parent, Node **neighbor);
-int getNeighbors(Node *parent, Node **neighbor) {
+int getNeighbors(Node *parent, Node **neighbor, void *data);
+int getNeighbors(Node *parent, Node **neighbor, void *data) {
 	NodeInfo *ni;
 	int i, posx, posy;
 	int deltax[8] = {1, 1, 0, -1, -1, -1, 0, 1};
@@ -169,11 +221,11 @@ int getNeighbors(Node *parent, Node **neighbor) {
 		posy = ni->y + deltay[i];
 		
 		// bounds check
-		if(posx >= 0 && posx < GRIDX && posy >= 0 && posy < GRIDY) {
+		if(posx >= 0 && posx < gblGridX && posy >= 0 && posy < gblGridY) {
 			// obstacle check
 //			if(!inObstacle(posx, posy)) {
 				// node has passed the tests: add it to the array of neighbors
-				neighbor[numNeighbors++] = &(gblGrid[posy*GRIDX + posx]);
+				neighbor[numNeighbors++] = &(gblGrid[CELL(posx, posy)]);
 //			}
 		}
 	}
@@ -181,6 +233,46 @@ int getNeighbors(Node *parent, Node **neighbor) {
 	return(numNeighbors);
 }
 
+int cellNeighbors(int64_t cell, int64_t *neighbor, void *data);
+int cellNeighbors(int64_t cell, int64_t *neighbor, void *data) {
+	int i, posx, posy;
+	int deltax[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+	int deltay[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+	int numNeighbors;
+	
+	numNeighbors = 0;
+	for(i=0;i<8;i++) {
+		posx = cell % gblGridX + deltax[i];
+		posy = cell / gblGridX + deltay[i];
+		
+		if(posx >= 0 && posx < gblGridX && posy >= 0 && posy < gblGridY)
+			neighbor[numNeighbors++] = CELL(posx, posy);
+	}
+	
+	return(numNeighbors);
+}
+
+// backpointer of a cell in either storage, -1 if it has none
+int64_t parentCell(int64_t cell);
+int64_t parentCell(int64_t cell) {
+	Node *p;
+	
+	if(gblCompact)
+		return(DStarPlannerParent(gblPlanner, cell));
+	
+	p = (Node *)gblGrid[cell].parent;
+	return(p == NULL ? -1 : p->id);
+}
+
+// copy of the node of a cell in either storage
+void cellNode(int64_t cell, Node *node);
+void cellNode(int64_t cell, Node *node) {
+	if(gblCompact)
+		DStarPlannerNode(gblPlanner, cell, node);
+	else
+		*node = gblGrid[cell];
+}
+
 // Free node function
 void freeNode(Node *p);
 void freeNode(Node *p) {
@@ -189,7 +281,6 @@ void freeNode(Node *p) {
 	ni = (NodeInfo *)p->nodeInfo;
 	ni->x = ni->y = -1;
 	p->parent = NULL;
-	p->next = NULL;
 	p->state = NEW;
 }
 
@@ -214,11 +305,38 @@ int nodeEqual(Node *a, Node *b) {
 	return(1);
 }
 
-// simple function to print a node
-void printNode(Node *p);
-void printNode(Node *p) {
-	printf("Node %05d: f %.2lf h %.2lf g %.2lf k %.2lf (%4d, %4d)\n", p->id, p->f, p->h, p->g, p->k, 
-	       ((NodeInfo *)p->nodeInfo)->x, ((NodeInfo *)p->nodeInfo)->y);
+// simple function to print a node; the id is the cell index in either storage
+void printNode(Node *p, void *data);
+void printNode(Node *p, void *data) {
+	printf("Node %05" PRId64 ": f %.2lf h %.2lf g %.2lf k %.2lf (%4d, %4d)\n", p->id, p->f, p->h, p->g, p->k, 
+	       (int)(p->id % gblGridX), (int)(p->id / gblGridX));
+}
+
+// report how a search or replan went, with its statistics if the library counts them
+void printStatus(DStarPlanner *planner, int status);
+void printStatus(DStarPlanner *planner, int status) {
+	DStarStats stats;
+
+	if(status == DSTAR_FOUND)
+		printf("Robot state reached with %" PRId64 " nodes expanded\n", DStarPlannerExpanded(planner));
+	else if(status == DSTAR_TERMINATED)
+		printf("Search terminated\n");
+	else if(status == DSTAR_LIMIT)
+		printf("Expanded more than the maximum allowable nodes (%" PRId64 "). Terminating\n", DStarPlannerExpanded(planner));
+	else if(status == DSTAR_NOMEM)
+		printf("Out of memory for the OPEN list\n");
+	if(status == DSTAR_FOUND && gblEngine == DSTAR_ENGINE_ANYTIME)
+		printf("  path cost within %.2lf times the optimal\n", DStarPlannerBound(planner));
+
+	if(DStarPlannerStats(planner, &stats) < 0)
+		return;
+
+	printf("  raise %" PRId64 " lower %" PRId64 " inserts %" PRId64 " reinserts %" PRId64 " holds %" PRId64 " rekeys %" PRId64
+	       " pruned %" PRId64 "\n",
+	       stats.raise, stats.lower, stats.inserts, stats.reinserts, stats.holds, stats.rekeys, stats.pruned);
+	printf("  hcalcs %" PRId64 " costs %" PRId64 " open max %" PRId64 "\n", stats.hcalcs, stats.costs, stats.openMax);
+	printf("  rekey %.3lf ms seed %.3lf ms expand %.3lf ms\n", 1000 * stats.seconds[DSTAR_PHASE_REKEY],
+	       1000 * stats.seconds[DSTAR_PHASE_SEED], 1000 * stats.seconds[DSTAR_PHASE_EXPAND]);
 }
 
 void drawArrow(Node *child, Node *parent);
@@ -252,7 +370,7 @@ void drawArrow(Node *child, Node *parent) {
 	gblImage[ci->y][ci->x] = c;
 	
 	if(reset <= 0) {
-		for(i=GRIDY-1;i>=0;i--)
+		for(i=gblGridY-1;i>=0;i--)
 			printf("%s\n", gblImage[i]);
 		
 		printf("ENTER # of iterations: ");
@@ -261,23 +379,178 @@ void drawArrow(Node *child, Node *parent) {
 }
 
 
-// main function
-main() {
+// Test that the goal, robot positions and obstacles fit on the grid
+int checkGrid(void);
+int checkGrid(void) {
+	int i;
+	
+	if(gblGoal[0] >= gblGridX || gblGoal[1] >= gblGridY)
+		return(0);
+	
+	// the robot moves to (12, 15) before the second search
+	if(gblRobot[0] >= gblGridX || gblRobot[1] >= gblGridY || 12 >= gblGridX || 15 >= gblGridY)
+		return(0);
+	
+	for(i=0;i<gblMaxObstacles;i++) {
+		if(gblObstacle[i][0] >= gblGridY || gblObstacle[i][3] >= gblGridX)
+			return(0);
+	}
+	
+	return(1);
+}
+
+// Anytime D*: improve the path the last call found until it is optimal
+int improve(DStarPlanner *planner, int status, double costR[2], int64_t *pathCell);
+int improve(DStarPlanner *planner, int status, double costR[2], int64_t *pathCell) {
+	Node *path;
+
+	while(status == DSTAR_FOUND && gblEngine == DSTAR_ENGINE_ANYTIME && DStarPlannerBound(planner) > 1.0) {
+		if(gblCompact)
+			status = DStarPlannerImproveIndex(planner, costR, pathCell);
+		else {
+			status = DStarPlannerImprove(planner, costR, &path);
+			*pathCell = path == NULL ? -1 : path->id;
+		}
+		printStatus(planner, status);
+	}
+
+	return(status);
+}
+
+// Sends a fleet of robots to the same goal: their paths all come from the
+// tree of the first search, extended only as far as the starts need
+void fleet(DStarPlanner *planner, int numRobots);
+void fleet(DStarPlanner *planner, int numRobots) {
+	int64_t *start, *offset, *cells = NULL, i, j;
+	Node **startNode, **nodes = NULL;
+	size_t capacity = 0;
+	int *xy, k, x, y, status;
+	double cost;
+
+	start = (int64_t *)malloc(sizeof(int64_t) * numRobots);
+	startNode = (Node **)malloc(sizeof(Node *) * numRobots);
+	offset = (int64_t *)malloc(sizeof(int64_t) * (numRobots + 1));
+	if(start == NULL || startNode == NULL || offset == NULL) {
+		printf("Not enough memory for %d robots\n", numRobots);
+		return;
+	}
+
+	// the robots are spread over the free cells
+	for(k=0;k<numRobots;k++) {
+		x = (7 * k + 3) % gblGridX;
+		y = (11 * k + 5) % gblGridY;
+		while(DMapOccupied(gblMap, x, y))
+			x = (x + 1) % gblGridX;
+		start[k] = CELL(x, y);
+		startNode[k] = gblCompact ? NULL : &(gblGrid[start[k]]);
+	}
+
+	if(gblCompact)
+		status = DStarPlannerQueryIndex(planner, start, numRobots, &cells, &capacity, offset);
+	else {
+		status = DStarPlannerQuery(planner, startNode, numRobots, &nodes, &capacity, offset);
+		if(status == DSTAR_FOUND || status == DSTAR_NOPATH) {
+			cells = (int64_t *)malloc(sizeof(int64_t) * (offset[numRobots] + 1));
+			for(i=0;cells != NULL && i<offset[numRobots];i++)
+				cells[i] = nodes[i]->id;
+		}
+	}
+	if((status != DSTAR_FOUND && status != DSTAR_NOPATH) || cells == NULL) {
+		printStatus(planner, status);
+		return;
+	}
+	printf("Fleet of %d robots routed with %" PRId64 " more nodes expanded\n", numRobots, DStarPlannerExpanded(planner));
+
+	// every path as one array of coordinates
+	xy = (int *)malloc(sizeof(int) * 2 * (offset[numRobots] + 1));
+	if(xy == NULL)
+		return;
+	DMapCoords(gblMap, cells, offset[numRobots], xy);
+	for(k=0;k<numRobots;k++) {
+		cost = 0.0;
+		for(i=offset[k];i+1<offset[k+1];i++)
+			cost += cellCost(cells[i+1], cells[i], NULL);
+		printf("Robot %02d at (%4d, %4d): %3" PRId64 " steps, cost %.2lf:", k,
+		       (int)(start[k] % gblGridX), (int)(start[k] / gblGridX), offset[k+1] - offset[k], cost);
+		for(j=offset[k];j<offset[k+1];j++)
+			printf(" (%d,%d)", xy[2*j], xy[2*j+1]);
+		printf("\n");
+	}
+
+	free(xy);
+	free(cells);
+	free(nodes);
+	free(start);
+	free(startNode);
+	free(offset);
+}
+
+// main function: dmain [-c] [-l | -a] [-f robots] [-t tracefile] [width height]
+main(int argc, char *argv[]) {
 	Node *root;
-	NodeInfo *ni;
-	Node *path, *p, *q;
-	Node *initial[50];
-	int numInitial;
+	Node *path;
+	Node node;
+	Node **initial;
+	int64_t *initialCell;
+	int64_t numInitial;
+	int64_t cell, pathCell, numCells;
 	int step;
-	int i, j, k, lo, hi, left, right;
+	int i, j, k, x, y, lo, hi, left, right;
 	FILE *fp;
 	double pathcost;
 	double costR[2];
-
+	int status;
+	DStarCallbacks cb;
+	DStarIndexCallbacks icb;
+	DStarParams params;
+	DStarPlanner *planner;
+	DTrace *trace = NULL;
+	FILE *traceFile = NULL;
+
+	while(argc > 1 && argv[1][0] == '-') {
+		if(argv[1][1] == 'c')
+			gblCompact = 1;
+		else if(argv[1][1] == 'l')
+			gblEngine = DSTAR_ENGINE_LITE;
+		else if(argv[1][1] == 'a')
+			gblEngine = DSTAR_ENGINE_ANYTIME;
+		else if(argv[1][1] == 'f' && argc > 2) {
+			gblFleet = atoi(argv[2]);
+			argc--;
+			argv++;
+		}
+		else if(argv[1][1] == 't' && argc > 2) {
+			gblTraceName = argv[2];
+			argc--;
+			argv++;
+		}
+		argc--;
+		argv++;
+	}
+	if(argc > 2) {
+		gblGridX = atoi(argv[1]);
+		gblGridY = atoi(argv[2]);
+	}
+	if(!checkGrid()) {
+		printf("Grid %d x %d is too small for the example\n", gblGridX, gblGridY);
+		return(1);
+	}
+	numCells = (int64_t)gblGridX * gblGridY;
+	
+	// build the occupancy map from the obstacles in effect
+	gblMap = DMapCreate(gblGridX, gblGridY);
+	if(gblMap == NULL) {
+		printf("Not enough memory for a %d x %d map\n", gblGridX, gblGridY);
+		return(1);
+	}
+	for(k=0;k<gblNumObstacles;k++)
+		DMapAddRect(gblMap, gblObstacle[k][0], gblObstacle[k][1], gblObstacle[k][2], gblObstacle[k][3]);
 	
 	// initialize the image
-	for(i=0;i<GRIDY;i++) {
-		for(j=0;j<GRIDX;j++) {
+	gblImage = (char **)malloc(sizeof(char *) * gblGridY);
+	for(i=0;i<gblGridY;i++) {
+		gblImage[i] = (char *)malloc(gblGridX + 1);
+		for(j=0;j<gblGridX;j++) {
 			gblImage[i][j] = '.';
 		}
 		gblImage[i][j] = '\0';
@@ -297,56 +570,121 @@ main() {
 	gblImage[gblRobot[1]][gblRobot[0]] = 'R';
 	
 	// draw the initial image
-	/*    	for(i=GRIDY-1;i>=0;i--) {
+	/*    	for(i=gblGridY-1;i>=0;i--) {
 	  printf("%s\n", gblImage[i]);
 	  }*/
 	
-       	// allocate the grid of nodes
-	gblGrid = (Node *)malloc(sizeof(Node) * GRIDX * GRIDY);
-	gblInfo = (NodeInfo *)malloc(sizeof(NodeInfo) * GRIDX * GRIDY);
-	
-	// initialize each grid cell
-	for(i=0;i<GRIDY * GRIDX;i++) {
-		gblGrid[i].nodeInfo = &(gblInfo[i]);
-		gblGrid[i].next = NULL;
-		gblGrid[i].prev = NULL;
-		gblGrid[i].parent = NULL;
-		gblGrid[i].state = NEW;
-		gblGrid[i].id = i * GRIDX;
-		gblInfo[i].x = i % GRIDX;
-		gblInfo[i].y = i / GRIDX;
+	// room for the seeds: at most the border of the grid
+	initial = (Node **)malloc(sizeof(Node *) * 2 * ((int64_t)gblGridX + gblGridY));
+	initialCell = (int64_t *)malloc(sizeof(int64_t) * 2 * ((int64_t)gblGridX + gblGridY));
+
+	costR[0] = costR[1] = 1e+7;
+
+	// build a planner for the robot, allowing each cell to be expanded a
+	// few times over
+	DStarDefaultParams(&params);
+	params.maxExpand = 25 * numCells;
+	params.engine = gblEngine;
+	
+	if(gblCompact) {
+		// the planner keeps the node state itself, nothing to allocate here
+		icb.hcalc = cellH;
+		icb.robotNode = cellRobot;
+		icb.neighbors = cellNeighbors;
+		icb.cost = cellCost;
+		icb.printNode = printNode;
+		icb.pruneNeighbors = NULL;
+		icb.data = gblRobot;
+		planner = DStarPlannerCreateIndex(&icb, numCells, &params);
 	}
-	
-	// setup the root node
-	root = &(gblGrid[gblGoal[1]*GRIDX + gblGoal[0]]);
+	else {
+		// allocate the grid of nodes
+		gblGrid = (Node *)malloc(sizeof(Node) * numCells);
+		gblInfo = (NodeInfo *)malloc(sizeof(NodeInfo) * numCells);
+		if(gblGrid == NULL || gblInfo == NULL) {
+			printf("Not enough memory for a %d x %d grid\n", gblGridX, gblGridY);
+			return(1);
+		}
+		
+		// initialize each grid cell
+		for(cell=0;cell<numCells;cell++) {
+			gblGrid[cell].nodeInfo = &(gblInfo[cell]);
+			gblGrid[cell].parent = NULL;
+			gblGrid[cell].state = NEW;
+			gblGrid[cell].id = cell;
+			gblInfo[cell].x = cell % gblGridX;
+			gblInfo[cell].y = cell / gblGridX;
+		}
 		
-	root->g = 0;
-	root->h = hfunction(root);
-	root->f = root->g + root->h;
+		cb.gcalc = gfunction;
+		cb.hcalc = hfunction;
+		cb.robotNode = robot;
+		cb.neighbors = getNeighbors;
+		cb.cost = cost;
+		cb.printNode = printNode;
+		cb.pruneNeighbors = NULL;
+		cb.data = gblRobot;
+		planner = DStarPlannerCreate(&cb, &params);
+	}
+	if(planner == NULL) {
+		printf("Not enough memory for a %d x %d planner\n", gblGridX, gblGridY);
+		return(1);
+	}
+	gblPlanner = planner;
+
+	// record the map, where the robot starts and every planner call
+	if(gblTraceName != NULL) {
+		traceFile = fopen(gblTraceName, "wb");
+		if(traceFile != NULL)
+			trace = DTraceCreate(1 << 20, traceFile);
+		if(trace == NULL) {
+			printf("Unable to write a trace to %s\n", gblTraceName);
+			return(1);
+		}
+		DMapTrace(gblMap, trace);
+		cell = CELL(gblRobot[0], gblRobot[1]);
+		DTraceRecord(trace, DTRACE_ROBOT, &cell, sizeof(cell));
+		DStarPlannerTrace(planner, trace);
+	}
 
-	// put it in the initial array
-	initial[0] = root;
-	numInitial = 1;
+	// call the D* algorithm from the goal
+	if(gblCompact) {
+		initialCell[0] = CELL(gblGoal[0], gblGoal[1]);
+		status = DStarPlannerSearchIndex(planner, initialCell, 1, costR, &pathCell);
+	}
+	else {
+		// setup the root node
+		root = &(gblGrid[CELL(gblGoal[0], gblGoal[1])]);
+		
+		root->g = 0;
+		root->h = hfunction(root, gblRobot);
+		root->f = root->g + root->h;
 
-	costR[0] = costR[1] = 1e+7;
+		// put it in the initial array
+		initial[0] = root;
+		numInitial = 1;
 
-	// call the D* algorithm
-	path = DStarSearch(initial, numInitial, gfunction, hfunction, robot, getNeighbors, cost, costR, printNode);
+		status = DStarPlannerSearch(planner, initial, numInitial, costR, &path);
+		pathCell = path == NULL ? -1 : path->id;
+	}
+	printStatus(planner, status);
+	status = improve(planner, status, costR, &pathCell);
 	
 	// D* returned failure (couldn't reach the robot's location)
-	if(path == NULL) {
+	if(pathCell < 0) {
 		printf("No path found, terminating\n");
 		return(0);
 	}
 	
 	// otherwise, we had a successful search
-	p = path;
+	cell = pathCell;
 	step = 0;
-	while(p != NULL) {
-		ni = (NodeInfo *)p->nodeInfo;
-		printf("Step %03d: (%4d, %4d)\n", step++, ni->x, ni->y);
-		gblImage[ni->y][ni->x] = 'x';
-		p = (Node *)p->parent;
+	while(cell >= 0) {
+		x = cell % gblGridX;
+		y = cell / gblGridX;
+		printf("Step %03d: (%4d, %4d)\n", step++, x, y);
+		gblImage[y][x] = 'x';
+		cell = parentCell(cell);
 	}
 	gblImage[gblGoal[1]][gblGoal[0]] = 'G';
 	gblImage[gblRobot[1]][gblRobot[0]] = 'R';
@@ -359,23 +697,28 @@ main() {
 		}
 	}
 	
-	for(i=GRIDY-1;i>=0;i--) {
+	for(i=gblGridY-1;i>=0;i--) {
 		printf("%s\n", gblImage[i]);
 	}
 	
+	if(gblFleet > 0)
+		fleet(planner, gblFleet);
+
 	printf("Finished with initial search\n");
 	sleep(4);
 	
 	// increment the number of obstacles: first increment
 	gblNumObstacles++;
+	k = gblNumObstacles - 1;
+	DMapAddRect(gblMap, gblObstacle[k][0], gblObstacle[k][1], gblObstacle[k][2], gblObstacle[k][3]);
 
 	// robot change positions
 	gblRobot[0]=12;
 	gblRobot[1]=15;
 
 	// redraw the grid for the second search
-	for(i=0;i<GRIDY;i++) {
-		for(j=0;j<GRIDX;j++) {
+	for(i=0;i<gblGridY;i++) {
+		for(j=0;j<gblGridX;j++) {
 		  gblImage[i][j] = gblImage[i][j] == 'x' ? 'o' : gblImage[i][j];
 		}
 	}
@@ -393,24 +736,32 @@ main() {
 	gblImage[gblGoal[1]][gblGoal[0]] = 'G';
 	gblImage[gblRobot[1]][gblRobot[0]] = 'R';
 
-	for(i=GRIDY-1;i>=0;i--) {
+	for(i=gblGridY-1;i>=0;i--) {
 		printf("%s\n", gblImage[i]);
 	}
 
 	printf("Replace initial search path with old mark\n");
 	sleep(4);
 
-	// get the new obstacle ready to go
+	// tell the planner where the robot is now
+	if(gblCompact)
+		DStarPlannerRobotAtIndex(planner, CELL(gblRobot[0], gblRobot[1]));
+	else
+		DStarPlannerRobotAt(planner, &(gblGrid[CELL(gblRobot[0], gblRobot[1])]));
+
+	// get the new obstacle ready to go: D* only needs its border, D* Lite and
+	// every cell whose edges changed cost
 	lo = gblObstacle[gblNumObstacles-1][2];
 	hi = gblObstacle[gblNumObstacles-1][0];
 	left = gblObstacle[gblNumObstacles-1][1];
 	right = gblObstacle[gblNumObstacles-1][3];
 	for(k=0,i=lo;i<=hi;i++) {
 	  for(j=left;j<=right;j++) {
-	    if(i == lo || i == hi || j == left || j == right) {
-	      if(gblGrid[i*GRIDX + j].parent != NULL) {
-		initial[k] = &(gblGrid[(i)*GRIDX + j]);
-		// leave the old f and g values and the next/prev values
+	    if(gblEngine != DSTAR_ENGINE_DSTAR || i == lo || i == hi || j == left || j == right) {
+	      if(parentCell(CELL(j, i)) >= 0) {
+		initialCell[k] = CELL(j, i);
+		initial[k] = gblCompact ? NULL : &(gblGrid[CELL(j, i)]);
+		// leave the old f and g values
 		k++;
 	      }
 	    }
@@ -418,71 +769,45 @@ main() {
 	}
 	numInitial = k;
 
-	costR[0] = gblGrid[gblRobot[1]*GRIDX + gblRobot[0]].f;
-	costR[1] = gblGrid[gblRobot[1]*GRIDX + gblRobot[0]].g;
+	cellNode(CELL(gblRobot[0], gblRobot[1]), &node);
+	costR[0] = node.f;
+	costR[1] = node.g;
 
-	// call the D* algorithm
-	path = DStarSearch(initial, numInitial, gfunction, hfunction, robot, getNeighbors, cost, costR, printNode);
+	// call the D* algorithm again with the changed nodes
+	if(gblCompact)
+		status = DStarPlannerReplanIndex(planner, initialCell, numInitial, costR, &pathCell);
+	else {
+		status = DStarPlannerReplan(planner, initial, numInitial, costR, &path);
+		pathCell = path == NULL ? -1 : path->id;
+	}
+	printStatus(planner, status);
+	status = improve(planner, status, costR, &pathCell);
 	
-	// D* returned failure (couldn't reach the robot's location)
-	if(path == NULL) {
-
-	  // follow the path from the robot node
-	  p = &(gblGrid[gblRobot[1] * GRIDX + gblRobot[0]]);
+	// D* returned failure (couldn't reach the robot's location):
+	// follow the path from the robot node
+	if(pathCell < 0)
+	  pathCell = CELL(gblRobot[0], gblRobot[1]);
 
-	  if(p->parent != NULL) {
+	if(parentCell(pathCell) >= 0 || pathCell == CELL(gblGoal[0], gblGoal[1])) {
 
-	    // try following this path
-	    pathcost = 0.0;
-	    while(p != NULL) {
-	      if(p->parent != NULL)
-		pathcost += cost(p->parent, p);
-	      p = (Node *)p->parent;
-	    }
-	    printf("pathcost = %.2lf\n", pathcost);
-
-	    if(pathcost < 1e+7) {
-	      // we had a successful search
-	      p = &(gblGrid[gblRobot[1] * GRIDX + gblRobot[0]]);
-	      step = 0;
-	      while(p != NULL) {
-		ni = (NodeInfo *)p->nodeInfo;
-		gblImage[ni->y][ni->x] = 'x';
-		p = (Node *)p->parent;
-	      }
-	    }
-	    else {
-	      printf("No free path exists\n");
-	    }
-	  }
-	  else {
-	    printf("No path found\n");
-	  }
-	}
-	else {
-	  p = path;
+	  // try following this path
 	  pathcost = 0.0;
-	  while(p != NULL) {
-	    if(p->parent != NULL)
-	      pathcost += cost(p->parent, p);
-	    p = (Node *)p->parent;
-	  }
+	  for(cell = pathCell; parentCell(cell) >= 0; cell = parentCell(cell))
+	    pathcost += cellCost(parentCell(cell), cell, NULL);
 	  printf("pathcost = %.2lf\n", pathcost);
 
 	  if(pathcost < 1e+7) {
 	    // we had a successful search
-	    p = path;
-	    step = 0;
-	    while(p != NULL) {
-	      ni = (NodeInfo *)p->nodeInfo;
-	      gblImage[ni->y][ni->x] = 'x';
-	      p = (Node *)p->parent;
-	    }
+	    for(cell = pathCell; cell >= 0; cell = parentCell(cell))
+	      gblImage[cell / gblGridX][cell % gblGridX] = 'x';
 	  }
 	  else {
 	    printf("No free path exists\n");
 	  }
 	}
+	else {
+	  printf("No path found\n");
+	}
 
 	gblImage[gblGoal[1]][gblGoal[0]] = 'G';
 	gblImage[gblRobot[1]][gblRobot[0]] = 'R';
@@ -496,7 +821,7 @@ main() {
 	}
 	
 	
-	for(i=GRIDY-1;i>=0;i--) {
+	for(i=gblGridY-1;i>=0;i--) {
 		printf("%s\n", gblImage[i]);
 	}
 
@@ -507,9 +832,20 @@ main() {
 	printf("Terminating\n"); 
 	
 	
-	// delete the nodes
+	// delete the planner and the nodes
+	DStarPlannerDestroy(planner);
 	free(gblGrid);
 	free(gblInfo);
+	DMapDestroy(gblMap);
+	if(trace != NULL) {
+		DTraceDestroy(trace);
+		fclose(traceFile);
+	}
+	free(initial);
+	free(initialCell);
+	for(i=0;i<gblGridY;i++)
+		free(gblImage[i]);
+	free(gblImage);
 	
 	
 	return(0);
@@ -0,0 +1,278 @@
+/*
+  Occupancy bitmap for grid planners.
+
+  The cells of a rectangle's row are consecutive bits, so a rectangle is
+  written a 64-bit word at a time except at the ends of each row.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "dmap.h"
+#include "dtrace.h"
+
+DMap           *DMapCreate(int width, int height)
+{
+  DMap           *map;
+  int64_t         numWords;
+
+  if (width <= 0 || height <= 0)
+    return (NULL);
+
+  map = (DMap *) malloc(sizeof(DMap));
+  if (map == NULL)
+    return (NULL);
+
+  numWords = ((int64_t) width * height + 63) / 64;
+  map->width = width;
+  map->height = height;
+  map->terrain = NULL;
+  map->trace = NULL;
+  map->bits = (uint64_t *) calloc(numWords, sizeof(uint64_t));
+  map->changed = (uint64_t *) calloc(numWords, sizeof(uint64_t));
+  if (map->bits == NULL || map->changed == NULL) {
+    free(map->bits);
+    free(map->changed);
+    free(map);
+    return (NULL);
+  }
+
+  return (map);
+}
+
+void            DMapDestroy(DMap * map)
+{
+  if (map == NULL)
+    return;
+
+  free(map->bits);
+  free(map->changed);
+  free(map->terrain);
+  free(map);
+}
+
+// set or clear the bits lo .. hi inclusive
+static void     setSpan(uint64_t * bits, int64_t lo, int64_t hi, int occupied)
+{
+  int64_t         w, wlo, whi;
+  uint64_t        mask;
+
+  wlo = lo >> 6;
+  whi = hi >> 6;
+  for (w = wlo; w <= whi; w++) {
+    mask = ~(uint64_t) 0;
+    if (w == wlo)
+      mask &= ~(uint64_t) 0 << (lo & 63);
+    if (w == whi)
+      mask &= ~(uint64_t) 0 >> (63 - (hi & 63));
+
+    if (occupied)
+      bits[w] |= mask;
+    else
+      bits[w] &= ~mask;
+  }
+}
+
+// marks the cells within one step of the rectangle, which is on the map,
+// as next to a change
+static void     markChanged(DMap * map, int top, int left, int bottom, int right)
+{
+  int             y;
+
+  bottom = bottom > 0 ? bottom - 1 : 0;
+  left = left > 0 ? left - 1 : 0;
+  top = top < map->height - 1 ? top + 1 : map->height - 1;
+  right = right < map->width - 1 ? right + 1 : map->width - 1;
+
+  for (y = bottom; y <= top; y++)
+    setSpan(map->changed, (int64_t) y * map->width + left, (int64_t) y * map->width + right, 1);
+}
+
+static void     setRect(DMap * map, int top, int left, int bottom, int right, int occupied)
+{
+  DTraceRect      rect;
+  int             y;
+
+  if (map->trace != NULL) {
+    rect.top = top;
+    rect.left = left;
+    rect.bottom = bottom;
+    rect.right = right;
+    rect.occupied = occupied;
+    DTraceRecord(map->trace, DTRACE_RECT, &rect, sizeof(rect));
+  }
+
+  // clip to the map
+  bottom = bottom < 0 ? 0 : bottom;
+  left = left < 0 ? 0 : left;
+  top = top >= map->height ? map->height - 1 : top;
+  right = right >= map->width ? map->width - 1 : right;
+
+  if (bottom > top || left > right)
+    return;
+
+  for (y = bottom; y <= top; y++)
+    setSpan(map->bits, (int64_t) y * map->width + left, (int64_t) y * map->width + right, occupied);
+  markChanged(map, top, left, bottom, right);
+}
+
+void            DMapAddRect(DMap * map, int top, int left, int bottom, int right)
+{
+  setRect(map, top, left, bottom, right, 1);
+}
+
+void            DMapClearRect(DMap * map, int top, int left, int bottom, int right)
+{
+  setRect(map, top, left, bottom, right, 0);
+}
+
+void            DMapSetCell(DMap * map, int64_t cell, int occupied)
+{
+  DTraceCell      c;
+
+  if (map->trace != NULL) {
+    c.cell = cell;
+    c.occupied = occupied;
+    DTraceRecord(map->trace, DTRACE_CELL, &c, sizeof(c));
+  }
+  setSpan(map->bits, cell, cell, occupied);
+  markChanged(map, (int)(cell / map->width), (int)(cell % map->width), (int)(cell / map->width),
+	      (int)(cell % map->width));
+}
+
+int             DMapSetTerrain(DMap * map, int64_t cell, float multiplier)
+{
+  DTraceTerrain   t;
+  int64_t         i, numCells;
+
+  if (map->trace != NULL) {
+    t.cell = cell;
+    t.multiplier = multiplier;
+    DTraceRecord(map->trace, DTRACE_TERRAIN, &t, sizeof(t));
+  }
+
+  if (map->terrain == NULL) {
+    numCells = (int64_t) map->width * map->height;
+    map->terrain = (float *) malloc(sizeof(float) * numCells);
+    if (map->terrain == NULL)
+      return (-1);
+    for (i = 0; i < numCells; i++)
+      map->terrain[i] = 1.0f;
+  }
+
+  map->terrain[cell] = multiplier;
+  return (0);
+}
+
+// the steps to the eight neighbors in the order they are written, and the
+// direction of each step (dx, dy) as [dy + 1][dx + 1]
+static const int stepX[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+static const int stepY[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+static const int direction[3][3] = { {5, 6, 7}, {4, -1, 0}, {3, 2, 1} };
+
+#define DIRBIT(dx, dy) (1 << direction[(dy) + 1][(dx) + 1])
+
+// 1 if (x, y) is on the map and occupied
+static int      blocked(const DMap * map, int x, int y)
+{
+  return (x >= 0 && x < map->width && y >= 0 && y < map->height && DMapOccupied(map, x, y));
+}
+
+int             DMapPruneNeighbors(const DMap * map, int64_t cell, int64_t parent, int64_t * neighbor, int *numKept)
+{
+  int             x, y, dx, dy, nx, ny, i, n, pass, keep;
+
+  x = (int)(cell % map->width);
+  y = (int)(cell / map->width);
+
+  // the step from the parent picks the neighbors to keep
+  keep = 0xff;
+  if (parent >= 0 && map->terrain == NULL && !((map->changed[cell >> 6] >> (cell & 63)) & 1)) {
+    dx = x - (int)(parent % map->width);
+    dy = y - (int)(parent / map->width);
+    if (dx >= -1 && dx <= 1 && dy >= -1 && dy <= 1 && (dx != 0 || dy != 0)) {
+      keep = DIRBIT(dx, dy);
+      if (dx != 0 && dy != 0) {
+	keep |= DIRBIT(dx, 0) | DIRBIT(0, dy);
+	if (blocked(map, x - dx, y))
+	  keep |= DIRBIT(-dx, dy);
+	if (blocked(map, x, y - dy))
+	  keep |= DIRBIT(dx, -dy);
+      }
+      else if (dx != 0) {
+	if (blocked(map, x, y + 1))
+	  keep |= DIRBIT(dx, 1);
+	if (blocked(map, x, y - 1))
+	  keep |= DIRBIT(dx, -1);
+      }
+      else {
+	if (blocked(map, x + 1, y))
+	  keep |= DIRBIT(1, dy);
+	if (blocked(map, x - 1, y))
+	  keep |= DIRBIT(-1, dy);
+      }
+    }
+  }
+
+  // the kept neighbors, then the others
+  n = 0;
+  for (pass = 0; pass < 2; pass++) {
+    for (i = 0; i < 8; i++) {
+      if (((keep >> i) & 1) != (pass == 0))
+	continue;
+      nx = x + stepX[i];
+      ny = y + stepY[i];
+      if (nx >= 0 && nx < map->width && ny >= 0 && ny < map->height)
+	neighbor[n++] = (int64_t) ny * map->width + nx;
+    }
+    if (pass == 0)
+      *numKept = n;
+  }
+
+  return (n);
+}
+
+void            DMapSettle(DMap * map)
+{
+  memset(map->changed, 0, sizeof(uint64_t) * (((int64_t) map->width * map->height + 63) / 64));
+}
+
+void            DMapCoords(const DMap * map, const int64_t * cell, int64_t n, int *xy)
+{
+  int64_t         i;
+
+  for (i = 0; i < n; i++) {
+    xy[2 * i] = (int)(cell[i] % map->width);
+    xy[2 * i + 1] = (int)(cell[i] / map->width);
+  }
+}
+
+size_t          DMapBytes(const DMap * map)
+{
+  size_t          bytes;
+
+  bytes = sizeof(DMap) + 2 * sizeof(uint64_t) * (((int64_t) map->width * map->height + 63) / 64);
+  if (map->terrain != NULL)
+    bytes += sizeof(float) * map->width * map->height;
+
+  return (bytes);
+}
+
+void            DMapTrace(DMap * map, DTrace * trace)
+{
+  DTraceMap       keyframe;
+  int64_t         numCells = (int64_t) map->width * map->height;
+
+  map->trace = trace;
+  if (trace == NULL)
+    return;
+
+  keyframe.width = map->width;
+  keyframe.height = map->height;
+  keyframe.terrain = map->terrain != NULL;
+  DTraceBegin(trace, DTRACE_MAP);
+  DTraceAppend(trace, &keyframe, sizeof(keyframe));
+  DTraceAppend(trace, map->bits, sizeof(uint64_t) * ((numCells + 63) / 64));
+  if (map->terrain != NULL)
+    DTraceAppend(trace, map->terrain, sizeof(float) * numCells);
+  DTraceEnd(trace);
+}
@@ -0,0 +1,103 @@
+// Include file for the grid occupancy map used by the D* examples
+
+#ifndef DMAP_H
+#define DMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// the cost added for stepping into an occupied cell
+#define DMAP_OBSTACLE 1e+7
+
+// the two step lengths of an 8-connected grid, straight and diagonal
+#define DMAP_STRAIGHT 1.0
+#define DMAP_DIAGONAL 1.41421356237309504880
+
+// One bit per cell, row-major, so testing a cell costs the same however
+// many obstacles have been added.  Rectangles are written into the bits as
+// they arrive; nothing is rebuilt.  The optional terrain multiplier scales
+// the length of every step into a cell.  A second bitmap marks the cells
+// next to an occupancy change since DMapSettle, where neighbor pruning
+// falls back to every neighbor.
+typedef struct {
+  int width;
+  int height;
+  uint64_t *bits;
+  uint64_t *changed;		// cells within one step of a change
+  float *terrain;		// per-cell multiplier, NULL if all 1
+  struct DTrace *trace;		// records every change, NULL if not traced
+} DMap;
+
+// function prototypes
+
+// an empty width x height map, NULL if there is not enough memory
+DMap *DMapCreate(int width, int height);
+void DMapDestroy(DMap *map);
+
+// mark or clear the rectangle (top, left, bottom, right), the same corners
+// as the example's obstacle table; it is clipped to the map
+void DMapAddRect(DMap *map, int top, int left, int bottom, int right);
+void DMapClearRect(DMap *map, int top, int left, int bottom, int right);
+
+// set one cell, given by its index y * width + x, to 0 or 1
+void DMapSetCell(DMap *map, int64_t cell, int occupied);
+
+// set the terrain multiplier of a cell; the multipliers are allocated, all
+// 1, on first use.  Returns -1 if there is not enough memory.
+int DMapSetTerrain(DMap *map, int64_t cell, float multiplier);
+
+// Neighbor pruning after jump point search (Harabor and Grastien) for a
+// planner's pruneNeighbors callback.  Writes the 8-connected neighbors of
+// cell that are on the map and returns their number.  First come the
+// natural neighbors in the direction from parent to cell and the forced
+// ones that an occupied cell beside that step makes necessary, *numKept
+// of them, then the rest, each group in the order E, NE, N, NW, W, SW, S,
+// SE.  Every other neighbor has a path from parent at most as long
+// that avoids cell.  All neighbors are kept if parent is -1 or not next to
+// cell, if the map has terrain, or if cell is next to a change since the
+// last DMapSettle.  The costs must be DMapStepCost's.
+int DMapPruneNeighbors(const DMap *map, int64_t cell, int64_t parent, int64_t *neighbor, int *numKept);
+
+// forget the changes, once the planners have replanned around them
+void DMapSettle(DMap *map);
+
+// the (x, y) of n cells given by index, as 2n ints one after another
+void DMapCoords(const DMap *map, const int64_t *cell, int64_t n, int *xy);
+
+// memory used by the map
+size_t DMapBytes(const DMap *map);
+
+// record the whole map in trace, then every change to it; NULL stops the
+// recording
+void DMapTrace(DMap *map, struct DTrace *trace);
+
+// 1 if the cell with index y * width + x is occupied; no bounds check
+static inline int DMapOccupiedCell(const DMap *map, int64_t cell)
+{
+  return ((map->bits[cell >> 6] >> (cell & 63)) & 1);
+}
+
+// 1 if (x, y) is occupied; no bounds check
+static inline int DMapOccupied(const DMap *map, int x, int y)
+{
+  return (DMapOccupiedCell(map, (int64_t) y * map->width + x));
+}
+
+// Cost of the step between two 8-connected neighbors, given as cell indices:
+// the step length from a table, times the terrain multiplier of the cell
+// stepped into, plus DMAP_OBSTACLE if that cell is occupied.  A step is
+// straight if the indices differ by 1 or by a row, which needs a map more
+// than 2 cells wide.
+static inline double DMapStepCost(const DMap *map, int64_t to, int64_t from)
+{
+  int64_t d = to - from;
+  double c;
+
+  c = (d == 1 || d == -1 || d == map->width || d == -map->width) ? DMAP_STRAIGHT : DMAP_DIAGONAL;
+  if (map->terrain != NULL)
+    c *= map->terrain[to];
+
+  return (DMapOccupiedCell(map, to) ? DMAP_OBSTACLE + c : c);
+}
+
+#endif
@@ -0,0 +1,253 @@
+/*
+  Work-stealing thread pool.
+
+  Each worker's share of a round is a range of task numbers behind a lock
+  of its own.  The owner takes one task at a time from the front; a thief
+  moves the back half of the range to its own share.  Tasks never create
+  tasks, so once every share is empty the round is over, and a worker
+  that finds nothing to steal is done.  The locks are only ever held for
+  a few instructions, and each share sits on a cache line of its own.
+*/
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "dpool.h"
+
+#define DPOOL_LINE 64
+
+typedef struct {
+  pthread_mutex_t lock;
+  int64_t         next;			       // the first task of the share
+  int64_t         end;			       // one past the last
+  int64_t         ran;			       // this round
+  int64_t         stolen;		       // this round
+  char            pad[DPOOL_LINE];
+} DPoolShare;
+
+typedef struct {
+  DPool          *pool;
+  int             worker;
+} DPoolWorker;
+
+struct DPool {
+  int             numThreads;
+  pthread_t      *thread;		       // workers 1 .. numThreads-1
+  DPoolWorker    *worker;
+  DPoolShare     *share;
+  pthread_mutex_t lock;			       // guards the round below
+  pthread_cond_t  start;
+  pthread_cond_t  done;
+  uint64_t        round;		       // advances when a round starts
+  int             busy;			       // workers still in the round
+  int             quit;
+  DPoolTask       task;
+  void           *arg;
+};
+
+// the next task of the worker's own share, or -1
+static int64_t  takeOwn(DPoolShare * share)
+{
+  int64_t         i = -1;
+
+  pthread_mutex_lock(&share->lock);
+  if (share->next < share->end)
+    i = share->next++;
+  pthread_mutex_unlock(&share->lock);
+
+  return (i);
+}
+
+// moves the back half of another worker's share to this one and takes its
+// first task, or gives -1 if every share is empty
+static int64_t  steal(DPool * pool, int worker)
+{
+  DPoolShare     *own = &pool->share[worker];
+  DPoolShare     *victim;
+  int64_t         mid, end;
+  int             j;
+
+  for (j = 1; j < pool->numThreads; j++) {
+    victim = &pool->share[(worker + j) % pool->numThreads];
+
+    pthread_mutex_lock(&victim->lock);
+    if (victim->next >= victim->end) {
+      pthread_mutex_unlock(&victim->lock);
+      continue;
+    }
+    end = victim->end;
+    mid = victim->next + (victim->end - victim->next) / 2;
+    victim->end = mid;
+    pthread_mutex_unlock(&victim->lock);
+
+    // the stolen range [mid, end) is not empty; keep all but its first
+    pthread_mutex_lock(&own->lock);
+    own->next = mid + 1;
+    own->end = end;
+    own->stolen += end - mid;
+    pthread_mutex_unlock(&own->lock);
+
+    return (mid);
+  }
+
+  return (-1);
+}
+
+// runs tasks until there are none left anywhere
+static void     work(DPool * pool, int worker)
+{
+  DPoolShare     *own = &pool->share[worker];
+  int64_t         i;
+
+  for (;;) {
+    i = takeOwn(own);
+    if (i < 0)
+      i = steal(pool, worker);
+    if (i < 0)
+      break;
+
+    pool->task(i, worker, pool->arg);
+    own->ran++;
+  }
+}
+
+static void    *workerMain(void *data)
+{
+  DPoolWorker    *w = (DPoolWorker *) data;
+  DPool          *pool = w->pool;
+  uint64_t        round = 0;
+
+  for (;;) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->round == round && !pool->quit)
+      pthread_cond_wait(&pool->start, &pool->lock);
+    if (pool->quit) {
+      pthread_mutex_unlock(&pool->lock);
+      break;
+    }
+    round = pool->round;
+    pthread_mutex_unlock(&pool->lock);
+
+    work(pool, w->worker);
+
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->busy == 0)
+      pthread_cond_signal(&pool->done);
+    pthread_mutex_unlock(&pool->lock);
+  }
+
+  return (NULL);
+}
+
+DPool          *DPoolCreate(int numThreads)
+{
+  DPool          *pool;
+  int             i;
+
+  if (numThreads < 1)
+    return (NULL);
+
+  pool = (DPool *) calloc(1, sizeof(DPool));
+  if (pool == NULL)
+    return (NULL);
+
+  pool->thread = (pthread_t *) malloc(sizeof(pthread_t) * numThreads);
+  pool->worker = (DPoolWorker *) malloc(sizeof(DPoolWorker) * numThreads);
+  pool->share = (DPoolShare *) calloc(numThreads, sizeof(DPoolShare));
+  if (pool->thread == NULL || pool->worker == NULL || pool->share == NULL) {
+    DPoolDestroy(pool);
+    return (NULL);
+  }
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->start, NULL);
+  pthread_cond_init(&pool->done, NULL);
+  for (i = 0; i < numThreads; i++) {
+    pthread_mutex_init(&pool->share[i].lock, NULL);
+    pool->worker[i].pool = pool;
+    pool->worker[i].worker = i;
+  }
+
+  // if a thread cannot start, only the ones before it are stopped
+  for (i = 1; i < numThreads; i++) {
+    if (pthread_create(&pool->thread[i], NULL, workerMain, &pool->worker[i]) != 0)
+      break;
+  }
+  pool->numThreads = i;
+  if (i < numThreads) {
+    DPoolDestroy(pool);
+    return (NULL);
+  }
+
+  return (pool);
+}
+
+void            DPoolDestroy(DPool * pool)
+{
+  int             i;
+
+  if (pool == NULL)
+    return;
+
+  if (pool->share != NULL && pool->numThreads > 0) {
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 1; i < pool->numThreads; i++)
+      pthread_join(pool->thread[i], NULL);
+
+    for (i = 0; i < pool->numThreads; i++)
+      pthread_mutex_destroy(&pool->share[i].lock);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+  }
+
+  free(pool->thread);
+  free(pool->worker);
+  free(pool->share);
+  free(pool);
+}
+
+int             DPoolThreads(const DPool * pool)
+{
+  return (pool->numThreads);
+}
+
+void            DPoolRun(DPool * pool, DPoolTask task, int64_t numTasks, void *arg)
+{
+  int             i;
+
+  // the shares are set before the workers are woken, under the pool lock
+  pthread_mutex_lock(&pool->lock);
+  for (i = 0; i < pool->numThreads; i++) {
+    pool->share[i].next = numTasks * i / pool->numThreads;
+    pool->share[i].end = numTasks * (i + 1) / pool->numThreads;
+    pool->share[i].ran = 0;
+    pool->share[i].stolen = 0;
+  }
+  pool->task = task;
+  pool->arg = arg;
+  pool->busy = pool->numThreads - 1;
+  pool->round++;
+  pthread_cond_broadcast(&pool->start);
+  pthread_mutex_unlock(&pool->lock);
+
+  work(pool, 0);
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->busy > 0)
+    pthread_cond_wait(&pool->done, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+int64_t         DPoolRan(const DPool * pool, int worker)
+{
+  return (pool->share[worker].ran);
+}
+
+int64_t         DPoolStolen(const DPool * pool, int worker)
+{
+  return (pool->share[worker].stolen);
+}
@@ -0,0 +1,43 @@
+// Include file for the work-stealing thread pool that runs many planners at once
+
+#ifndef DPOOL_H
+#define DPOOL_H
+
+#include <stdint.h>
+
+// A round of tasks numbered 0 .. numTasks-1 is split evenly over the
+// workers.  Each worker takes tasks from the front of its own share, and a
+// worker whose share has run out steals the back half of what is left of
+// another's, so a few slow tasks do not hold up the round.  The thread that
+// calls DPoolRun works as worker 0, so a pool of one thread runs the tasks
+// in order with no threads at all.
+//
+// The tasks of a round must not share anything they write.  Planners keep
+// all their search state to themselves, so the way to plan for many
+// agents is one index planner per worker over one DMap that nobody writes
+// to during the round, with the agent to plan for in the callbacks' data
+// (see dagents.c).  A trace must not be shared between workers.
+typedef struct DPool DPool;
+
+// runs task number i on worker number worker, 0 .. numThreads-1
+typedef void (*DPoolTask)(int64_t i, int worker, void *arg);
+
+// function prototypes
+
+// a pool of numThreads workers, NULL if the threads cannot be started
+DPool *DPoolCreate(int numThreads);
+
+// stops and joins the threads
+void DPoolDestroy(DPool *pool);
+
+int DPoolThreads(const DPool *pool);
+
+// runs tasks 0 .. numTasks-1 and returns when all of them are done; only
+// one thread may call it at a time
+void DPoolRun(DPool *pool, DPoolTask task, int64_t numTasks, void *arg);
+
+// tasks each worker ran in the last round and took from other workers
+int64_t DPoolRan(const DPool *pool, int worker);
+int64_t DPoolStolen(const DPool *pool, int worker);
+
+#endif
@@ -0,0 +1,661 @@
+/*
+	Replays a planner trace
+
+	Reads a trace written with DStarPlannerTrace and DMapTrace (see
+	dtrace.h) and runs every call in it again on an index planner over the
+	recorded grid map, as fast as it will go.  The map changes and robot
+	positions are applied in between, as they happened.  The results are
+	checked against the recorded ones, so a trace of a bad replan in the
+	field reproduces it, and the time spent in the planner is reported, so
+	a trace of real traffic serves as a benchmark.
+
+	The grid is the one of the examples: 8-connected, with the step costs
+	of dmap.h and h the Euclidean distance to the robot.  A session must
+	record where the robot starts (a DTRACE_ROBOT record) and tell the
+	planner each time it moves (DStarPlannerRobotAt).
+
+	build:	cc -O2 -o dreplay dreplay.c dstar.c dmap.c dtrace.c -lm
+	usage:	dreplay [-d | -l | -a] [-n passes] [-r bytes] [-v] file
+
+	A call that a budget cut short (DSTAR_UNFINISHED) is replayed with an
+	expansion budget of what it recorded, so the same calls stop at the
+	same places however fast the replay runs.  -d, -l and -a run D*, D*
+	Lite or Anytime D* whatever the trace used, with the recorded budgets
+	as they were; the results are then not checked.  -n runs the whole
+	trace that many times and reports the fastest pass.  -v prints each
+	call that does not match.
+
+	-r traces the replay itself into a ring of that many bytes with no
+	file, as a robot would keep one to save after a bad replan, with a
+	keyframe before every new search (see dtrace.h).  With passes enough
+	to fill it the ring wraps and drops the oldest of them; what it kept
+	is then saved, read back and replayed, and must match the results it
+	recorded.
+
+	A trace kept in a ring without a file starts wherever the oldest record
+	left in it is.  The replay waits for a map keyframe and a new search
+	before it runs any replans, and counts the ones it skipped, so such a
+	session must record a keyframe before each new search.
+
+	Every record must be as long as its type and the counts in it say, or
+	the replay stops before it; a record naming a cell off the map stops
+	the replay where it comes.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include "dstar.h"
+#include "dmap.h"
+#include "dtrace.h"
+
+int gblGridX;
+int gblGridY;
+int gblRobot[2];
+DMap *gblMap;
+
+#define CELL(x, y) ((int64_t)(y) * gblGridX + (x))
+
+// one record of the trace, read into memory before the replay starts
+typedef struct {
+	int type;
+	size_t bytes;
+	unsigned char *data;
+} Record;
+
+typedef struct {
+	int64_t calls;
+	int64_t searches;
+	int64_t replans;
+	int64_t resumes;
+	int64_t improves;
+	int64_t queries;
+	int64_t skipped;		// calls before the first map and search
+	int64_t checked;
+	int64_t mismatches;
+	int64_t expanded;
+	double seconds;			// in the planner
+	double max;			// slowest call
+} Replay;
+
+// the callbacks of the index planner
+double cellCost(int64_t to, int64_t from, void *data);
+double cellCost(int64_t to, int64_t from, void *data) {
+	return(DMapStepCost(gblMap, to, from));
+}
+
+double cellH(int64_t cell, void *data);
+double cellH(int64_t cell, void *data) {
+	double dx, dy;
+
+	dx = gblRobot[0] - cell % gblGridX;
+	dy = gblRobot[1] - cell / gblGridX;
+
+	return(sqrt(dx*dx + dy*dy));
+}
+
+int cellRobot(int64_t cell, void *data);
+int cellRobot(int64_t cell, void *data) {
+	return(cell == CELL(gblRobot[0], gblRobot[1]));
+}
+
+int cellNeighbors(int64_t cell, int64_t *neighbor, void *data);
+int cellNeighbors(int64_t cell, int64_t *neighbor, void *data) {
+	int deltax[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+	int deltay[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+	int i, x, y, n;
+
+	n = 0;
+	for(i=0;i<8;i++) {
+		x = cell % gblGridX + deltax[i];
+		y = cell / gblGridX + deltay[i];
+		if(x >= 0 && x < gblGridX && y >= 0 && y < gblGridY)
+			neighbor[n++] = CELL(x, y);
+	}
+
+	return(n);
+}
+
+double now(void);
+double now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec + 1e-9 * ts.tv_nsec);
+}
+
+// 1 if a record is as long as its type and the counts in it say, and what
+// it holds could have come from the library: a map of at least one cell,
+// a rectangle in int, params the planner takes
+int wellFormed(int type, const unsigned char *data, size_t bytes);
+int wellFormed(int type, const unsigned char *data, size_t bytes) {
+	DTraceMap keyframe;
+	DTraceRect rect;
+	DTraceParams create;
+	DTraceCall call;
+	uint64_t numCells, expect;
+	size_t each;
+
+	switch(type) {
+	case DTRACE_MAP:
+		if(bytes < sizeof(keyframe))
+			return(0);
+		memcpy(&keyframe, data, sizeof(keyframe));
+		if(keyframe.width < 1 || keyframe.width > INT_MAX || keyframe.height < 1 || keyframe.height > INT_MAX ||
+		   (keyframe.terrain != 0 && keyframe.terrain != 1))
+			return(0);
+		// every 8 cells take a byte at least, which keeps the sum below in range
+		numCells = (uint64_t)keyframe.width * (uint64_t)keyframe.height;
+		if(numCells / 8 > bytes)
+			return(0);
+		expect = sizeof(keyframe) + sizeof(uint64_t) * ((numCells + 63) / 64);
+		if(keyframe.terrain)
+			expect += sizeof(float) * numCells;
+		return(expect == bytes);
+	case DTRACE_RECT:
+		if(bytes != sizeof(rect))
+			return(0);
+		memcpy(&rect, data, sizeof(rect));
+		return(rect.top >= INT_MIN && rect.top <= INT_MAX && rect.left >= INT_MIN && rect.left <= INT_MAX &&
+		       rect.bottom >= INT_MIN && rect.bottom <= INT_MAX && rect.right >= INT_MIN && rect.right <= INT_MAX);
+	case DTRACE_CELL:
+		return(bytes == sizeof(DTraceCell));
+	case DTRACE_TERRAIN:
+		return(bytes == sizeof(DTraceTerrain));
+	case DTRACE_ROBOT:
+	case DTRACE_ROBOTAT:
+	case DTRACE_MOVED:
+		return(bytes == sizeof(int64_t));
+	case DTRACE_CREATE:
+		if(bytes != sizeof(create))
+			return(0);
+		memcpy(&create, data, sizeof(create));
+		// the grid has 8 neighbors a cell
+		return(create.maxNeighbors >= 8 && create.maxNeighbors <= INT_MAX / 16 &&
+		       create.engine >= DSTAR_ENGINE_DSTAR && create.engine <= DSTAR_ENGINE_ANYTIME);
+	case DTRACE_RESULT:
+		return(bytes == sizeof(DTraceResult));
+	case DTRACE_BUDGET:
+		return(bytes == sizeof(DTraceBudget));
+	case DTRACE_SEARCH:
+	case DTRACE_REPLAN:
+	case DTRACE_QUERY:
+	case DTRACE_RESUME:
+	case DTRACE_IMPROVE:
+		if(bytes < sizeof(call))
+			return(0);
+		memcpy(&call, data, sizeof(call));
+		each = type == DTRACE_SEARCH ? sizeof(DTraceSeed) : type == DTRACE_REPLAN || type == DTRACE_QUERY ? sizeof(int64_t) : 0;
+		if(each == 0)
+			return(call.num == 0 && bytes == sizeof(call));
+		return(call.num >= 0 && (uint64_t)call.num <= (bytes - sizeof(call)) / each &&
+		       bytes == sizeof(call) + (size_t)call.num * each);
+	}
+
+	// a type this build does not know is passed over
+	return(1);
+}
+
+// reads the whole trace; the number of records, or -1 if it is not a trace
+int64_t readTrace(FILE *fp, Record **records);
+int64_t readTrace(FILE *fp, Record **records) {
+	unsigned char *buf = NULL;
+	size_t capacity = 0, bytes;
+	int64_t num = 0, size = 0;
+	Record *grown;
+	int type;
+
+	*records = NULL;
+	if(DTraceReadMagic(fp) < 0)
+		return(-1);
+
+	while((type = DTraceRead(fp, &buf, &capacity, &bytes)) > 0) {
+		if(!wellFormed(type, buf, bytes)) {
+			printf("Record %" PRId64 " of the trace, of type %d, is malformed; replaying the ones before it\n", num, type);
+			break;
+		}
+		if(num == size) {
+			size = size > 0 ? 2 * size : 1024;
+			grown = (Record *)realloc(*records, sizeof(Record) * size);
+			if(grown == NULL)
+				break;
+			*records = grown;
+		}
+		(*records)[num].type = type;
+		(*records)[num].bytes = bytes;
+		(*records)[num].data = (unsigned char *)malloc(bytes > 0 ? bytes : 1);
+		if((*records)[num].data == NULL)
+			break;
+		memcpy((*records)[num].data, buf, bytes);
+		num++;
+	}
+	if(type < 0)
+		printf("The trace ends in a short record; replaying the %" PRId64 " before it\n", num);
+	free(buf);
+
+	return(num);
+}
+
+// a new map from a keyframe; -1 if there is not enough memory
+int loadMap(Record *r);
+int loadMap(Record *r) {
+	DTraceMap keyframe;
+	int64_t numCells;
+
+	memcpy(&keyframe, r->data, sizeof(keyframe));
+	DMapDestroy(gblMap);
+	gblGridX = (int)keyframe.width;
+	gblGridY = (int)keyframe.height;
+	gblMap = DMapCreate(gblGridX, gblGridY);
+	if(gblMap == NULL)
+		return(-1);
+
+	numCells = (int64_t)gblGridX * gblGridY;
+	memcpy(gblMap->bits, r->data + sizeof(keyframe), sizeof(uint64_t) * ((numCells + 63) / 64));
+	if(keyframe.terrain) {
+		gblMap->terrain = (float *)malloc(sizeof(float) * numCells);
+		if(gblMap->terrain == NULL)
+			return(-1);
+		memcpy(gblMap->terrain, r->data + sizeof(keyframe) + sizeof(uint64_t) * ((numCells + 63) / 64),
+		       sizeof(float) * numCells);
+	}
+
+	return(0);
+}
+
+// the expansions a call recorded if its budget stopped it, otherwise 0;
+// the count of a resume goes on from the call it resumes
+int64_t sliceBudget(Record *records, int64_t numRecords, int64_t i);
+int64_t sliceBudget(Record *records, int64_t numRecords, int64_t i) {
+	DTraceResult recorded;
+
+	for(i++;i<numRecords && records[i].type != DTRACE_RESULT;i++) {
+		if(records[i].type == DTRACE_SEARCH || records[i].type == DTRACE_REPLAN ||
+		   records[i].type == DTRACE_RESUME || records[i].type == DTRACE_IMPROVE ||
+		   records[i].type == DTRACE_QUERY)
+			return(0);
+	}
+	if(i == numRecords)
+		return(0);
+
+	memcpy(&recorded, records[i].data, sizeof(recorded));
+	return(recorded.status == DSTAR_UNFINISHED ? recorded.expanded : 0);
+}
+
+// 1 if a cell or node is on the map
+int onMap(int64_t cell);
+int onMap(int64_t cell) {
+	return(gblMap != NULL && cell >= 0 && cell < (int64_t)gblGridX * gblGridY);
+}
+
+// says which record names a cell off the map; gives -2
+int offMap(int64_t record);
+int offMap(int64_t record) {
+	printf("Record %" PRId64 " names a cell off the %d x %d map\n", record, gblGridX, gblGridY);
+	return(-2);
+}
+
+// Runs the trace once.  engine is -1 to use the engine of the trace.  If
+// ring is not NULL the replay is traced into it as a session kept in a
+// ring would be: a keyframe of the map, where the robot is and the planner
+// before every new search.  Returns -1 if there is not enough memory and
+// -2 if a record names a cell off the map.
+int replay(Record *records, int64_t numRecords, int engine, int verbose, DTrace *ring, Replay *result);
+int replay(Record *records, int64_t numRecords, int engine, int verbose, DTrace *ring, Replay *result) {
+	DStarIndexCallbacks icb;
+	DStarParams params;
+	DStarPlanner *planner = NULL;
+	DTraceParams create;
+	DTraceCall call;
+	DTraceRect rect;
+	DTraceCell cell;
+	DTraceTerrain terrain;
+	DTraceResult recorded;
+	DTraceBudget budget;
+	DTraceSeed *seed;
+	int64_t i, j, node, path, *goal, *offset, *paths = NULL, numGoals = 0, expandedBefore;
+	size_t pathCapacity = 0;
+	int status = 0, ran = 0, searched = 0;
+	double costR[2], t, dt;
+	Record *r;
+
+	memset(result, 0, sizeof(Replay));
+	memset(&budget, 0, sizeof(budget));
+	DStarDefaultParams(&params);
+	goal = NULL;
+	offset = NULL;
+
+	icb.hcalc = cellH;
+	icb.robotNode = cellRobot;
+	icb.neighbors = cellNeighbors;
+	icb.cost = cellCost;
+	icb.printNode = NULL;
+	icb.pruneNeighbors = NULL;
+	icb.data = NULL;
+
+	for(i=0;i<numRecords;i++) {
+		r = &records[i];
+		switch(r->type) {
+		case DTRACE_MAP:
+			DStarPlannerDestroy(planner);
+			planner = NULL;
+			searched = 0;
+			if(loadMap(r) < 0)
+				return(-1);
+			break;
+		case DTRACE_RECT:
+			memcpy(&rect, r->data, sizeof(rect));
+			if(gblMap == NULL)
+				break;
+			if(rect.occupied)
+				DMapAddRect(gblMap, (int)rect.top, (int)rect.left, (int)rect.bottom, (int)rect.right);
+			else
+				DMapClearRect(gblMap, (int)rect.top, (int)rect.left, (int)rect.bottom, (int)rect.right);
+			break;
+		case DTRACE_CELL:
+			memcpy(&cell, r->data, sizeof(cell));
+			if(gblMap != NULL && !onMap(cell.cell))
+				return(offMap(i));
+			if(gblMap != NULL)
+				DMapSetCell(gblMap, cell.cell, (int)cell.occupied);
+			break;
+		case DTRACE_TERRAIN:
+			memcpy(&terrain, r->data, sizeof(terrain));
+			if(gblMap != NULL && !onMap(terrain.cell))
+				return(offMap(i));
+			if(gblMap != NULL && DMapSetTerrain(gblMap, terrain.cell, (float)terrain.multiplier) < 0)
+				return(-1);
+			break;
+		case DTRACE_ROBOT:
+		case DTRACE_ROBOTAT:
+			memcpy(&node, r->data, sizeof(node));
+			if(gblMap == NULL)
+				break;
+			if(!onMap(node))
+				return(offMap(i));
+			gblRobot[0] = (int)(node % gblGridX);
+			gblRobot[1] = (int)(node / gblGridX);
+			if(r->type == DTRACE_ROBOTAT && planner != NULL)
+				DStarPlannerRobotAtIndex(planner, node);
+			else if(r->type == DTRACE_ROBOT && ring != NULL)
+				DTraceRecord(ring, DTRACE_ROBOT, &node, sizeof(node));
+			break;
+		case DTRACE_MOVED:
+			memcpy(&node, r->data, sizeof(node));
+			if(planner != NULL && !onMap(node))
+				return(offMap(i));
+			if(planner != NULL)
+				DStarPlannerRobotMovedIndex(planner, node);
+			break;
+		case DTRACE_CREATE:
+			memcpy(&create, r->data, sizeof(create));
+			params.maxExpand = create.maxExpand;
+			params.maxNeighbors = (int)create.maxNeighbors;
+			params.engine = (int)create.engine;
+			params.epsilon = create.epsilon;
+			params.epsilonStep = create.epsilonStep;
+			DStarPlannerDestroy(planner);
+			planner = NULL;
+			searched = 0;
+			break;
+		case DTRACE_BUDGET:
+			memcpy(&budget, r->data, sizeof(budget));
+			break;
+		case DTRACE_SEARCH:
+		case DTRACE_REPLAN:
+		case DTRACE_RESUME:
+		case DTRACE_IMPROVE:
+		case DTRACE_QUERY:
+			memcpy(&call, r->data, sizeof(call));
+			ran = 0;
+			if(gblMap == NULL || (r->type != DTRACE_SEARCH && !searched)) {
+				result->skipped++;
+				break;
+			}
+			if(planner == NULL) {
+				if(engine >= 0)
+					params.engine = engine;
+				planner = DStarPlannerCreateIndex(&icb, (int64_t)gblGridX * gblGridY, &params);
+				if(planner == NULL)
+					return(-1);
+			}
+
+			// the goals of a search go to the planner as node numbers, and
+			// so do the starts of a query, with room for their offsets
+			if(call.num > numGoals) {
+				free(goal);
+				free(offset);
+				goal = (int64_t *)malloc(sizeof(int64_t) * call.num);
+				offset = (int64_t *)malloc(sizeof(int64_t) * (call.num + 1));
+				if(goal == NULL || offset == NULL)
+					return(-1);
+				numGoals = call.num;
+			}
+			costR[0] = call.costR[0];
+			costR[1] = call.costR[1];
+			expandedBefore = r->type == DTRACE_RESUME ? DStarPlannerExpanded(planner) : 0;
+			if(engine < 0 && (j = sliceBudget(records, numRecords, i)) > 0)
+				DStarPlannerBudget(planner, j - expandedBefore, 0);
+			else if(engine < 0)
+				DStarPlannerBudget(planner, 0, 0);
+			else
+				DStarPlannerBudget(planner, budget.expansions, budget.microseconds);
+
+			if(r->type == DTRACE_SEARCH) {
+				seed = (DTraceSeed *)(r->data + sizeof(call));
+				for(j=0;j<call.num;j++)
+					goal[j] = seed[j].node;
+				for(j=0;j<call.num;j++) {
+					if(!onMap(goal[j]))
+						return(offMap(i));
+				}
+				if(ring != NULL) {
+					DMapTrace(gblMap, ring);
+					node = CELL(gblRobot[0], gblRobot[1]);
+					DTraceRecord(ring, DTRACE_ROBOT, &node, sizeof(node));
+					DStarPlannerTrace(planner, ring);
+				}
+				t = now();
+				status = DStarPlannerSearchIndex(planner, goal, call.num, costR, &path);
+				dt = now() - t;
+				result->searches++;
+				searched = 1;
+			}
+			else if(r->type == DTRACE_REPLAN) {
+				memcpy(goal, r->data + sizeof(call), sizeof(int64_t) * call.num);
+				for(j=0;j<call.num;j++) {
+					if(!onMap(goal[j]))
+						return(offMap(i));
+				}
+				t = now();
+				status = DStarPlannerReplanIndex(planner, goal, call.num, costR, &path);
+				dt = now() - t;
+				result->replans++;
+			}
+			else if(r->type == DTRACE_QUERY) {
+				memcpy(goal, r->data + sizeof(call), sizeof(int64_t) * call.num);
+				for(j=0;j<call.num;j++) {
+					if(!onMap(goal[j]))
+						return(offMap(i));
+				}
+				t = now();
+				status = DStarPlannerQueryIndex(planner, goal, call.num, &paths, &pathCapacity, offset);
+				dt = now() - t;
+				path = status == DSTAR_FOUND || status == DSTAR_NOPATH ? offset[call.num] : -1;
+				result->queries++;
+			}
+			else if(r->type == DTRACE_IMPROVE) {
+				t = now();
+				status = DStarPlannerImproveIndex(planner, costR, &path);
+				dt = now() - t;
+				result->improves++;
+			}
+			else {
+				t = now();
+				status = DStarPlannerResumeIndex(planner, costR, &path);
+				dt = now() - t;
+				result->resumes++;
+			}
+			result->calls++;
+			result->expanded += DStarPlannerExpanded(planner) - expandedBefore;
+			result->seconds += dt;
+			if(dt > result->max)
+				result->max = dt;
+			ran = 1;
+			break;
+		case DTRACE_RESULT:
+			if(!ran || engine >= 0)
+				break;
+			memcpy(&recorded, r->data, sizeof(recorded));
+			result->checked++;
+			if(recorded.status != status || recorded.path != path ||
+			   recorded.expanded != DStarPlannerExpanded(planner) || recorded.bound != DStarPlannerBound(planner)) {
+				result->mismatches++;
+				if(verbose)
+					printf("record %" PRId64 ": status %d path %" PRId64 " expanded %" PRId64 " bound %g"
+					       ", recorded status %d path %" PRId64 " expanded %" PRId64 " bound %g\n",
+					       i, status, path, DStarPlannerExpanded(planner), DStarPlannerBound(planner),
+					       (int)recorded.status, recorded.path, recorded.expanded, recorded.bound);
+			}
+			ran = 0;
+			break;
+		}
+	}
+
+	free(goal);
+	free(offset);
+	free(paths);
+	DStarPlannerDestroy(planner);
+	DMapDestroy(gblMap);
+	gblMap = NULL;
+
+	return(0);
+}
+
+// Replays what a ring kept of the replay: saved the way a robot in the
+// field would save it, then read back and checked against itself
+int replayRing(DTrace *ring, int verbose);
+int replayRing(DTrace *ring, int verbose) {
+	Record *records;
+	Replay result;
+	int64_t i, numRecords;
+	int status;
+	FILE *fp;
+
+	fp = tmpfile();
+	if(fp == NULL || DTraceSave(ring, fp) < 0) {
+		printf("Unable to save the ring\n");
+		return(1);
+	}
+	rewind(fp);
+	numRecords = readTrace(fp, &records);
+	fclose(fp);
+	if(numRecords < 0) {
+		printf("The saved ring is not a trace\n");
+		return(1);
+	}
+
+	status = replay(records, numRecords, -1, verbose, NULL, &result);
+	if(status == -1)
+		printf("Not enough memory to replay the ring\n");
+	if(status < 0)
+		return(1);
+
+	printf("ring: %" PRId64 " records dropped, %" PRId64 " kept, %" PRId64 " calls (%" PRId64 " searches, %" PRId64 " replans, %" PRId64 " skipped)\n",
+	       DTraceDropped(ring), numRecords, result.calls, result.searches, result.replans, result.skipped);
+	printf("ring: %" PRId64 " of %" PRId64 " results differ from the replay\n", result.mismatches, result.checked);
+
+	for(i=0;i<numRecords;i++)
+		free(records[i].data);
+	free(records);
+
+	return(result.mismatches > 0 || result.calls == 0);
+}
+
+int main(int argc, char *argv[]) {
+	int engine = -1, passes = 1, verbose = 0, pass, status, failed;
+	int64_t i, numRecords;
+	size_t ringBytes = 0;
+	Record *records;
+	Replay result, best;
+	DTrace *ring = NULL;
+	FILE *fp;
+
+	for(argc--,argv++;argc>1;argc--,argv++) {
+		if(strcmp(argv[0], "-d") == 0)
+			engine = DSTAR_ENGINE_DSTAR;
+		else if(strcmp(argv[0], "-l") == 0)
+			engine = DSTAR_ENGINE_LITE;
+		else if(strcmp(argv[0], "-a") == 0)
+			engine = DSTAR_ENGINE_ANYTIME;
+		else if(strcmp(argv[0], "-v") == 0)
+			verbose = 1;
+		else if(argc > 2 && strcmp(argv[0], "-n") == 0) {
+			passes = atoi(argv[1]);
+			argc--, argv++;
+		}
+		else if(argc > 2 && strcmp(argv[0], "-r") == 0) {
+			ringBytes = (size_t)atol(argv[1]);
+			argc--, argv++;
+		}
+		else
+			break;
+	}
+	if(argc != 1 || passes < 1) {
+		printf("usage: dreplay [-d | -l | -a] [-n passes] [-r bytes] [-v] file\n");
+		return(1);
+	}
+	if(ringBytes > 0) {
+		ring = DTraceCreate(ringBytes, NULL);
+		if(ring == NULL) {
+			printf("Unable to make a ring of %zu bytes\n", ringBytes);
+			return(1);
+		}
+	}
+
+	fp = fopen(argv[0], "rb");
+	if(fp == NULL) {
+		printf("Unable to open %s\n", argv[0]);
+		return(1);
+	}
+	numRecords = readTrace(fp, &records);
+	fclose(fp);
+	if(numRecords < 0) {
+		printf("%s is not a trace\n", argv[0]);
+		return(1);
+	}
+
+	for(pass=0;pass<passes;pass++) {
+		status = replay(records, numRecords, engine, verbose && pass == 0, ring, &result);
+		if(status == -1)
+			printf("Not enough memory to replay %s\n", argv[0]);
+		if(status < 0)
+			return(1);
+		if(pass == 0 || result.seconds < best.seconds)
+			best = result;
+	}
+
+	printf("%" PRId64 " records, %" PRId64 " calls (%" PRId64 " searches, %" PRId64 " replans, %" PRId64 " resumes, %" PRId64 " improves, %" PRId64 " queries, %" PRId64 " skipped)\n",
+	       numRecords, best.calls, best.searches, best.replans, best.resumes, best.improves, best.queries,
+	       best.skipped);
+	printf("%" PRId64 " expanded in %.3f ms, %.0f/s, slowest call %.3f ms\n",
+	       best.expanded, 1e3 * best.seconds, best.seconds > 0 ? best.expanded / best.seconds : 0.0, 1e3 * best.max);
+	if(engine < 0)
+		printf("%" PRId64 " of %" PRId64 " results differ from the trace\n", best.mismatches, best.checked);
+
+	failed = best.mismatches > 0;
+	if(ring != NULL) {
+		failed |= replayRing(ring, verbose);
+		DTraceDestroy(ring);
+	}
+
+	for(i=0;i<numRecords;i++)
+		free(records[i].data);
+	free(records);
+
+	return(failed);
+}
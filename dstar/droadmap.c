@@ -0,0 +1,344 @@
+/*
+	Planning over a roadmap held as a compressed sparse row graph
+
+	Scatters random nodes over the free space of a W x W world with
+	rectangular obstacles, as a probabilistic roadmap does, and joins each
+	to every node within a radius that it can see in a straight line.  The
+	edges cost their length.  The graph goes into a DGraph of dgraph.h and
+	two planners search it from the goal to the robot:
+
+	callback	an index planner whose callbacks read the graph, the cost
+			of each edge found by looking through the slots of
+			the node
+	csr		the planner of dgraph.h, which reads the neighbors and
+			the costs of their edges straight out of the slots
+
+	Then a crowd slows the middle third of the path: every edge at a node
+	there costs five times as much, set in place with DGraphSetCost, and
+	both planners replan from the graph's changed list.  For each it
+	reports the nodes expanded, the time and the cost of the path.
+
+	build:	cc -O2 -o droadmap droadmap.c dstar.c dgraph.c dmap.c dtrace.c -lm
+	usage:	droadmap [-l] [nodes [size [obstacles [seed]]]]
+
+	-l plans with D* Lite.  The defaults are 200000 nodes in a world of
+	2000 x 2000 cells with 400 obstacles.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include "dstar.h"
+#include "dmap.h"
+#include "dgraph.h"
+
+int gblSize = 2000;
+DMap *gblMap;
+DGraphRobot gblAgent;		// the graph and the robot's node, for both planners
+
+// the callbacks of the callback planner, over the same graph
+double nodeH(int64_t n, void *data);
+double nodeH(int64_t n, void *data) {
+	return(DGraphH(&gblAgent, n));
+}
+
+int nodeRobot(int64_t n, void *data);
+int nodeRobot(int64_t n, void *data) {
+	return(n == gblAgent.robot);
+}
+
+int nodeNeighbors(int64_t n, int64_t *neighbor, void *data);
+int nodeNeighbors(int64_t n, int64_t *neighbor, void *data) {
+	return(DGraphNeighbors(gblAgent.graph, n, neighbor));
+}
+
+double nodeCost(int64_t to, int64_t from, void *data);
+double nodeCost(int64_t to, int64_t from, void *data) {
+	return(DGraphCost(gblAgent.graph, to, from));
+}
+
+// random rectangles
+void scatter(int numObstacles);
+void scatter(int numObstacles) {
+	int i, x, y, w, h;
+
+	for(i=0;i<numObstacles;i++) {
+		w = 1 + rand() % (gblSize / 20 + 1);
+		h = 1 + rand() % (gblSize / 20 + 1);
+		x = rand() % gblSize;
+		y = rand() % gblSize;
+		DMapAddRect(gblMap, y + h - 1, x, y, x + w - 1);
+	}
+}
+
+// 1 if the straight line between two points crosses no occupied cell
+int clear(const double *a, const double *b);
+int clear(const double *a, const double *b) {
+	double dx = b[0] - a[0], dy = b[1] - a[1];
+	int i, steps;
+
+	steps = 1 + (int)(2.0 * sqrt(dx*dx + dy*dy));
+	for(i=0;i<=steps;i++) {
+		if(DMapOccupied(gblMap, (int)(a[0] + dx * i / steps), (int)(a[1] + dy * i / steps)))
+			return(0);
+	}
+
+	return(1);
+}
+
+// Joins each node to the ones within radius it can see, looking only in
+// the squares of side radius around it.  The edges go into *edge, grown
+// with realloc; returns their number, or -1 if there is not enough memory.
+int64_t connect(const double *xy, int64_t numNodes, double radius, DGraphEdge **edge);
+int64_t connect(const double *xy, int64_t numNodes, double radius, DGraphEdge **edge) {
+	int64_t *head, *next, numEdges = 0, capacity = 0, i, j, s;
+	int side, sx, sy, x, y;
+	double dx, dy, d;
+	DGraphEdge *grown;
+
+	side = 1 + (int)(gblSize / radius);
+	head = (int64_t *)malloc(sizeof(int64_t) * side * side);
+	next = (int64_t *)malloc(sizeof(int64_t) * numNodes);
+	if(head == NULL || next == NULL) {
+		free(head);
+		free(next);
+		return(-1);
+	}
+	for(s=0;s<(int64_t)side * side;s++)
+		head[s] = -1;
+	for(i=0;i<numNodes;i++) {
+		s = (int64_t)(xy[2*i+1] / radius) * side + (int)(xy[2*i] / radius);
+		next[i] = head[s];
+		head[s] = i;
+	}
+
+	for(i=0;i<numNodes;i++) {
+		sx = (int)(xy[2*i] / radius);
+		sy = (int)(xy[2*i+1] / radius);
+		for(y=sy-1;y<=sy+1;y++) {
+			for(x=sx-1;x<=sx+1;x++) {
+				if(x < 0 || x >= side || y < 0 || y >= side)
+					continue;
+				for(j=head[(int64_t)y * side + x];j>=0;j=next[j]) {
+					dx = xy[2*j] - xy[2*i];
+					dy = xy[2*j+1] - xy[2*i+1];
+					d = sqrt(dx*dx + dy*dy);
+					if(j <= i || d > radius || !clear(xy + 2*i, xy + 2*j))
+						continue;
+					if(numEdges == capacity) {
+						capacity = capacity > 0 ? 2 * capacity : 1024;
+						grown = (DGraphEdge *)realloc(*edge, sizeof(DGraphEdge) * capacity);
+						if(grown == NULL) {
+							free(head);
+							free(next);
+							return(-1);
+						}
+						*edge = grown;
+					}
+					(*edge)[numEdges].a = i;
+					(*edge)[numEdges].b = j;
+					(*edge)[numEdges].ab = d;
+					(*edge)[numEdges].ba = d;
+					numEdges++;
+				}
+			}
+		}
+	}
+	free(head);
+	free(next);
+
+	return(numEdges);
+}
+
+// the node nearest a point
+int64_t nearest(const double *xy, int64_t numNodes, double x, double y);
+int64_t nearest(const double *xy, int64_t numNodes, double x, double y) {
+	int64_t i, best = 0;
+	double d, bestD = HUGE_VAL;
+
+	for(i=0;i<numNodes;i++) {
+		d = (xy[2*i] - x) * (xy[2*i] - x) + (xy[2*i+1] - y) * (xy[2*i+1] - y);
+		if(d < bestD) {
+			bestD = d;
+			best = i;
+		}
+	}
+
+	return(best);
+}
+
+// cost of the path a planner's backpointers give from the robot
+double pathCost(DStarPlanner *planner, graphPlanner *csr);
+double pathCost(DStarPlanner *planner, graphPlanner *csr) {
+	int64_t n, parent;
+	double cost = 0.0;
+
+	for(n=gblAgent.robot;;n=parent) {
+		parent = planner != NULL ? DStarPlannerParent(planner, n) : graphPlannerParent(csr, n);
+		if(parent < 0)
+			break;
+		cost += DGraphCost(gblAgent.graph, parent, n);
+	}
+
+	return(cost);
+}
+
+// one line of the table
+void printPlan(char *name, DStarPlanner *planner, graphPlanner *csr, double t);
+void printPlan(char *name, DStarPlanner *planner, graphPlanner *csr, double t) {
+	printf("%-16s %12" PRId64 " %12.2f %12.2f\n", name,
+	       planner != NULL ? DStarPlannerExpanded(planner) : graphPlannerExpanded(csr),
+	       1e3 * (DStarNow() - t), pathCost(planner, csr));
+}
+
+int main(int argc, char *argv[]) {
+	int64_t numNodes = 200000, numEdges, numSeeds, goal, path, n, parent, length, i, s;
+	int numObstacles = 400, engine = DSTAR_ENGINE_DSTAR;
+	unsigned int seed = 1;
+	double *xy, radius, costR[2], t;
+	DGraphEdge *edge = NULL;
+	DGraph *graph;
+	DStarIndexCallbacks icb;
+	DStarParams params;
+	DStarPlanner *planner;
+	graphPlanner *csr;
+	int64_t *seeds;
+	char *crowd;
+	Node node;
+
+	for(argc--,argv++;argc>0 && argv[0][0] == '-';argc--,argv++) {
+		if(strcmp(argv[0], "-l") == 0)
+			engine = DSTAR_ENGINE_LITE;
+		else {
+			printf("usage: droadmap [-l] [nodes [size [obstacles [seed]]]]\n");
+			return(1);
+		}
+	}
+	if(argc > 0)
+		numNodes = atoll(argv[0]);
+	if(argc > 1)
+		gblSize = atoi(argv[1]);
+	if(argc > 2)
+		numObstacles = atoi(argv[2]);
+	if(argc > 3)
+		seed = atoi(argv[3]);
+	if(numNodes < 100 || gblSize < 20) {
+		printf("There must be at least 100 nodes in a world at least 20 cells across\n");
+		return(1);
+	}
+
+	// the nodes, on free cells
+	gblMap = DMapCreate(gblSize, gblSize);
+	xy = (double *)malloc(sizeof(double) * 2 * numNodes);
+	if(gblMap == NULL || xy == NULL) {
+		printf("Not enough memory for the world\n");
+		return(1);
+	}
+	srand(seed);
+	scatter(numObstacles);
+	for(i=0;i<numNodes;) {
+		xy[2*i] = gblSize * (rand() / (RAND_MAX + 1.0));
+		xy[2*i+1] = gblSize * (rand() / (RAND_MAX + 1.0));
+		if(!DMapOccupied(gblMap, (int)xy[2*i], (int)xy[2*i+1]))
+			i++;
+	}
+
+	// about a dozen nodes within the radius of each
+	t = DStarNow();
+	radius = sqrt(12.0 * gblSize * gblSize / (3.14159265358979 * numNodes));
+	numEdges = connect(xy, numNodes, radius, &edge);
+	graph = numEdges < 0 ? NULL : DGraphCreate(numNodes, edge, numEdges, xy);
+	if(graph == NULL) {
+		printf("Not enough memory for the graph\n");
+		return(1);
+	}
+	free(edge);
+	printf("%" PRId64 " nodes, %" PRId64 " edges, at most %d at a node, %.1f MB, built in %.1f ms, %s\n",
+	       numNodes, numEdges, graph->maxDegree, DGraphBytes(graph) / 1e6, 1e3 * (DStarNow() - t),
+	       engine == DSTAR_ENGINE_LITE ? "D* Lite" : "D*");
+
+	gblAgent.graph = graph;
+	gblAgent.robot = nearest(xy, numNodes, gblSize / 20.0, gblSize / 20.0);
+	goal = nearest(xy, numNodes, gblSize - gblSize / 20.0, gblSize - gblSize / 20.0);
+
+	DStarDefaultParams(&params);
+	params.maxExpand = 0;
+	params.maxNeighbors = graph->maxDegree;
+	params.engine = engine;
+	icb.hcalc = nodeH;
+	icb.robotNode = nodeRobot;
+	icb.neighbors = nodeNeighbors;
+	icb.cost = nodeCost;
+	icb.printNode = NULL;
+	icb.pruneNeighbors = NULL;
+	icb.data = NULL;
+	planner = DStarPlannerCreateIndex(&icb, numNodes, &params);
+	csr = DGraphPlannerCreate(&gblAgent, &params);
+	seeds = (int64_t *)malloc(sizeof(int64_t) * numNodes);
+	crowd = (char *)calloc(numNodes, 1);
+	if(planner == NULL || csr == NULL || seeds == NULL || crowd == NULL) {
+		printf("Not enough memory for the planners\n");
+		return(1);
+	}
+	DStarPlannerRobotAtIndex(planner, gblAgent.robot);
+	graphPlannerRobotAt(csr, gblAgent.robot);
+
+	printf("%-16s %12s %12s %12s\n", "", "expanded", "ms", "pathcost");
+	costR[0] = costR[1] = 1e+7;
+	t = DStarNow();
+	DStarPlannerSearchIndex(planner, &goal, 1, costR, &path);
+	printPlan("callback search", planner, NULL, t);
+	costR[0] = costR[1] = 1e+7;
+	t = DStarNow();
+	graphPlannerSearch(csr, &goal, 1, costR, &path);
+	printPlan("csr search", NULL, csr, t);
+
+	// a crowd in the middle third of the path makes every edge there five
+	// times as slow, both ways, and an edge between two nodes of the
+	// crowd only once
+	for(length=0,n=gblAgent.robot;(parent = graphPlannerParent(csr, n)) >= 0;n=parent)
+		length++;
+	for(i=0,n=gblAgent.robot;i<2*length/3;i++,n=graphPlannerParent(csr, n)) {
+		if(i < length/3)
+			continue;
+		crowd[n] = 1;
+		for(s=graph->first[n];s<graph->first[n+1];s++) {
+			if(crowd[graph->adj[s]])
+				continue;
+			DGraphSetCost(graph, n, graph->adj[s], 5.0 * graph->costOut[s]);
+			DGraphSetCost(graph, graph->adj[s], n, 5.0 * graph->costIn[s]);
+		}
+	}
+
+	// D* takes the changed nodes it has reached, D* Lite all of them
+	for(numSeeds=0,i=0;i<graph->numChanged;i++) {
+		graphPlannerNode(csr, graph->changed[i], &node);
+		if(engine == DSTAR_ENGINE_LITE || node.state != NEW)
+			seeds[numSeeds++] = graph->changed[i];
+	}
+	graphPlannerNode(csr, gblAgent.robot, &node);
+	costR[0] = node.f;
+	costR[1] = node.g;
+	t = DStarNow();
+	DStarPlannerReplanIndex(planner, seeds, numSeeds, costR, &path);
+	printPlan("callback replan", planner, NULL, t);
+	costR[0] = node.f;
+	costR[1] = node.g;
+	t = DStarNow();
+	graphPlannerReplan(csr, seeds, numSeeds, costR, &path);
+	printPlan("csr replan", NULL, csr, t);
+	printf("%" PRId64 " nodes changed, %" PRId64 " of them reached\n", graph->numChanged, numSeeds);
+	DGraphSettle(graph);
+
+	free(seeds);
+	free(crowd);
+	graphPlannerDestroy(csr);
+	DStarPlannerDestroy(planner);
+	DGraphDestroy(graph);
+	DMapDestroy(gblMap);
+	free(xy);
+
+	return(0);
+}
@@ -0,0 +1,284 @@
+/*
+	Planning over an unbounded world with a sparse node store
+
+	The world has no edges: every (x, y) that fits in 32 bits is a cell,
+	and one block of 16 x 16 cells in five is rock, drawn from a hash of
+	the block's coordinates.  The planner runs on Node structs kept in the
+	tiled store of dtile.h, which makes a tile of nodes the first time the
+	neighbors callback reaches it, so the memory follows the cells the
+	search touches rather than the size of the world.
+
+	The robot plans to a goal far away, drives a quarter of the way, finds
+	a wall across the path and replans.  Then it is sent to two more goals
+	in turn, each a new search, so the tiles left behind are recycled.
+	For each plan it reports the nodes expanded, the time, the cost of the
+	path and the memory of the store, next to what a dense grid over the
+	same box would take.
+
+	build:	cc -O2 -o dsparse dsparse.c dstar.c dtile.c dtrace.c -lm
+	usage:	dsparse [-l] [-s side] [-k keep] [distance]
+
+	-l plans with D* Lite.  -s sets the side of a tile (default 64) and -k
+	the searches an untouched tile is kept through (default 0).  The goal
+	is distance cells away across and a third of that up (default 2000).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include "dstar.h"
+#include "dmap.h"
+#include "dtile.h"
+
+int32_t gblRobot[2];
+int32_t gblGoal[2];
+int32_t gblWall[4];		// (top, left, bottom, right), empty until it drops
+DTileStore *gblStore;
+
+// rock by the hash of the 16 x 16 block, never in the blocks of the robot's
+// start or the goals, and the wall once it has dropped
+int blocked(int32_t x, int32_t y);
+int blocked(int32_t x, int32_t y) {
+	uint32_t h;
+
+	if(y <= gblWall[0] && x >= gblWall[1] && y >= gblWall[2] && x <= gblWall[3])
+		return(1);
+	if((x >> 4) == 0 && (y >> 4) == 0)
+		return(0);
+	if((x >> 4) == (gblGoal[0] >> 4) && (y >> 4) == (gblGoal[1] >> 4))
+		return(0);
+
+	h = (uint32_t)(x >> 4) * 73856093u ^ (uint32_t)(y >> 4) * 19349663u;
+	h ^= h >> 13;
+	h *= 0x5bd1e995u;
+	h ^= h >> 15;
+
+	return(h % 5 == 0);
+}
+
+// the callbacks, on the nodes of the store
+double hfunction(Node *p, void *data);
+double hfunction(Node *p, void *data) {
+	double dx, dy;
+
+	dx = gblRobot[0] - DTILE_X(p->id);
+	dy = gblRobot[1] - DTILE_Y(p->id);
+
+	return(sqrt(dx*dx + dy*dy));
+}
+
+int robot(Node *p, void *data);
+int robot(Node *p, void *data) {
+	return(DTILE_X(p->id) == gblRobot[0] && DTILE_Y(p->id) == gblRobot[1]);
+}
+
+int getNeighbors(Node *parent, Node **neighbor, void *data);
+int getNeighbors(Node *parent, Node **neighbor, void *data) {
+	int deltax[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+	int deltay[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+	int32_t x = DTILE_X(parent->id), y = DTILE_Y(parent->id);
+	int i, n;
+	Node *p;
+
+	n = 0;
+	for(i=0;i<8;i++) {
+		p = DTileStoreNode(gblStore, x + deltax[i], y + deltay[i]);
+		if(p != NULL)
+			neighbor[n++] = p;
+	}
+
+	return(n);
+}
+
+double cost(Node *to, Node *from, void *data);
+double cost(Node *to, Node *from, void *data) {
+	double c;
+
+	c = DTILE_X(to->id) != DTILE_X(from->id) && DTILE_Y(to->id) != DTILE_Y(from->id) ? DMAP_DIAGONAL : DMAP_STRAIGHT;
+
+	return(blocked(DTILE_X(to->id), DTILE_Y(to->id)) ? DMAP_OBSTACLE + c : c);
+}
+
+// cost of the path the backpointers give from the robot
+double pathCost(void);
+double pathCost(void) {
+	Node *p, *parent;
+	double c = 0.0;
+
+	for(p=DTileStoreFind(gblStore, gblRobot[0], gblRobot[1]);p != NULL && p->parent != NULL;p=parent) {
+		parent = (Node *)p->parent;
+		c += cost(parent, p, NULL);
+	}
+
+	return(c);
+}
+
+// one line of the table
+void printPlan(char *name, DStarPlanner *planner, int status, double t);
+void printPlan(char *name, DStarPlanner *planner, int status, double t) {
+	DTileStats stats;
+	double w, h;
+
+	// a dense grid over the box around the robot and goal, with a margin
+	// of a quarter of the distance on each side
+	w = fabs((double)gblGoal[0] - gblRobot[0]);
+	h = fabs((double)gblGoal[1] - gblRobot[1]);
+	w = w + (w > h ? w : h) / 2 + 1;
+	h = h + (w > h ? w : h) / 2 + 1;
+
+	DTileStoreStats(gblStore, &stats);
+	printf("%-10s %s %10" PRId64 " %10.1f %10.2f %10.1f %10.1f %8" PRId64 " %8" PRId64 " %8" PRId64 "\n", name,
+	       status == DSTAR_FOUND ? "  " : "??", DStarPlannerExpanded(planner), 1e3 * (DStarNow() - t), pathCost(),
+	       DTileStoreBytes(gblStore) / 1e6, w * h * sizeof(Node) / 1e6, stats.tiles, stats.recycled, stats.reused);
+}
+
+// a new search from the goal to where the robot is
+int plan(DStarPlanner *planner, char *name);
+int plan(DStarPlanner *planner, char *name) {
+	double costR[2] = {1e+9, 1e+9}, t;
+	Node *root, *path;
+	int status;
+
+	// the planner lets go of the last search's nodes before the store
+	// recycles them
+	t = DStarNow();
+	DStarPlannerReset(planner);
+	DTileStoreNewSearch(gblStore);
+	root = DTileStoreNode(gblStore, gblGoal[0], gblGoal[1]);
+	if(root == NULL)
+		return(DSTAR_NOMEM);
+	root->g = 0;
+	root->h = hfunction(root, NULL);
+	root->f = root->g + root->h;
+	DStarPlannerRobotAt(planner, DTileStoreNode(gblStore, gblRobot[0], gblRobot[1]));
+	status = DStarPlannerSearch(planner, &root, 1, costR, &path);
+	printPlan(name, planner, status, t);
+
+	return(status);
+}
+
+int main(int argc, char *argv[]) {
+	int distance = 2000, side = 64, keep = 0, engine = DSTAR_ENGINE_DSTAR, status, step;
+	int32_t x, y, mid[2];
+	int64_t numChanged, maxChanged;
+	double costR[2], t;
+	DStarCallbacks cb;
+	DStarParams params;
+	DStarPlanner *planner;
+	Node **changed, *p, *path;
+
+	for(argc--,argv++;argc>0;argc--,argv++) {
+		if(strcmp(argv[0], "-l") == 0)
+			engine = DSTAR_ENGINE_LITE;
+		else if(argc > 1 && strcmp(argv[0], "-s") == 0) {
+			side = atoi(argv[1]);
+			argc--, argv++;
+		}
+		else if(argc > 1 && strcmp(argv[0], "-k") == 0) {
+			keep = atoi(argv[1]);
+			argc--, argv++;
+		}
+		else if(argc == 1 && argv[0][0] != '-')
+			distance = atoi(argv[0]);
+		else {
+			printf("usage: dsparse [-l] [-s side] [-k keep] [distance]\n");
+			return(1);
+		}
+	}
+	if(distance < 100 || distance > 100000000) {
+		printf("The distance must be from 100 to 100000000 cells\n");
+		return(1);
+	}
+
+	gblStore = DTileStoreCreate(side, keep);
+	if(gblStore == NULL) {
+		printf("The tile side must be a power of two from 4 to 1024\n");
+		return(1);
+	}
+	gblWall[0] = gblWall[2] = 0;
+	gblWall[1] = 1;
+	gblWall[3] = 0;
+	gblGoal[0] = distance;
+	gblGoal[1] = distance / 3;
+
+	DStarDefaultParams(&params);
+	params.maxExpand = 0;
+	params.engine = engine;
+	cb.gcalc = NULL;
+	cb.hcalc = hfunction;
+	cb.robotNode = robot;
+	cb.neighbors = getNeighbors;
+	cb.cost = cost;
+	cb.printNode = NULL;
+	cb.pruneNeighbors = NULL;
+	cb.data = NULL;
+	planner = DStarPlannerCreate(&cb, &params);
+	if(planner == NULL) {
+		printf("Not enough memory for the planner\n");
+		return(1);
+	}
+
+	printf("goal %d cells away, %d x %d tiles, %s\n", distance, side, side,
+	       engine == DSTAR_ENGINE_LITE ? "D* Lite" : "D*");
+	printf("%-10s    %10s %10s %10s %10s %10s %8s %8s %8s\n", "", "expanded", "ms", "pathcost", "store MB",
+	       "dense MB", "tiles", "recycled", "reused");
+
+	if(plan(planner, "first") != DSTAR_FOUND)
+		return(1);
+
+	// drive a quarter of the way, then a wall drops across the path a
+	// little further on
+	p = DTileStoreFind(gblStore, gblRobot[0], gblRobot[1]);
+	for(step=0;step<distance/4 && p->parent != NULL;step++)
+		p = (Node *)p->parent;
+	gblRobot[0] = DTILE_X(p->id);
+	gblRobot[1] = DTILE_Y(p->id);
+	for(step=0;step<distance/20 && p->parent != NULL;step++)
+		p = (Node *)p->parent;
+	mid[0] = DTILE_X(p->id);
+	mid[1] = DTILE_Y(p->id);
+	gblWall[0] = mid[1] + distance / 10;
+	gblWall[1] = mid[0];
+	gblWall[2] = mid[1] - distance / 10;
+	gblWall[3] = mid[0] + 1;
+
+	// the cells of the wall the search has reached; the wall is two cells
+	// thick, so for D* as for D* Lite that is every one
+	maxChanged = 2 * ((int64_t)gblWall[0] - gblWall[2] + 1);
+	changed = (Node **)malloc(sizeof(Node *) * maxChanged);
+	if(changed == NULL) {
+		printf("Not enough memory for the wall\n");
+		return(1);
+	}
+	for(numChanged=0,y=gblWall[2];y<=gblWall[0];y++) {
+		for(x=gblWall[1];x<=gblWall[3];x++) {
+			p = DTileStoreFind(gblStore, x, y);
+			if(p != NULL && p->parent != NULL)
+				changed[numChanged++] = p;
+		}
+	}
+
+	t = DStarNow();
+	p = DTileStoreNode(gblStore, gblRobot[0], gblRobot[1]);
+	DStarPlannerRobotAt(planner, p);
+	costR[0] = p->f;
+	costR[1] = p->g;
+	status = DStarPlannerReplan(planner, changed, numChanged, costR, &path);
+	printPlan("wall", planner, status, t);
+
+	// two more goals, each a new search
+	gblGoal[0] = gblRobot[0] - distance / 2;
+	gblGoal[1] = gblRobot[1] + distance / 2;
+	plan(planner, "second");
+	gblGoal[0] = gblRobot[0] + distance / 3;
+	gblGoal[1] = gblRobot[1] - distance / 2;
+	plan(planner, "third");
+
+	free(changed);
+	DStarPlannerDestroy(planner);
+	DTileStoreDestroy(gblStore);
+
+	return(0);
+}
@@ -10,340 +10,777 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/mman.h>
 #include "dstar.h"
-
-// This prints a list of the nodes to the screen
-void            printNodeList(Node * list, char *name, void (*printfunc) (Node *));
-void            printNodeList(Node * list, char *name, void (*printfunc) (Node *))
+#include "dtrace.h"
+
+#define DHEAP_TYPE NodeHeap
+#define DHEAP_ENTRY NodeHeapEntry
+#define DHEAP_NAME(x) nodeHeap##x
+#define DHEAP_ITEM Node *
+#define DHEAP_POS(n) ((n)->openIndex)
+#include "dheap.h"
+
+// An index planner is the compile-time planner of dstarinline.h with the
+// callbacks as its policies
+#define DSI_NAME(x) cb##x
+#define DSI_DATA DStarIndexCallbacks
+#define DSI_NEIGHBORS(d, n, buf) ((d)->neighbors((n), (buf), (d)->data))
+#define DSI_COST(d, to, from) ((d)->cost((to), (from), (d)->data))
+#define DSI_HCALC(d, n) ((d)->hcalc((n), (d)->data))
+#define DSI_ROBOT(d, n) ((d)->robotNode((n), (d)->data))
+#define DSI_PRINT(d, node) ((d)->printNode((node), (d)->data))
+#define DSI_CANPRINT(d) ((d)->printNode != NULL)
+#define DSI_PRUNE(d, n, p, buf, kept) ((d)->pruneNeighbors((n), (p), (buf), (kept), (d)->data))
+#define DSI_CANPRUNE(d) ((d)->pruneNeighbors != NULL)
+#include "dstarinline.h"
+
+// A chunk of the node arena, mapped on its own; the nodes follow the header
+typedef struct ArenaChunk {
+  struct ArenaChunk *next;
+  size_t          bytes;		       // of the mapping, header included
+} ArenaChunk;
+
+// the header rounded up so that what follows it is aligned for any node
+#define ARENA_ALIGN 16
+#define ARENA_HEADER ((sizeof(ArenaChunk) + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1))
+
+// The state of one incremental search
+struct DStarPlanner {
+  DStarCallbacks  cb;
+  DStarIndexCallbacks icb;
+  DStarParams     params;
+  int64_t         expanded;		       // expansions in the current call
+  DStarStats      stats;		       // of the current call, with DSTAR_STATS
+  NodeHeap        open;			       // OPEN, carried over between calls
+  Node          **neighbor;		       // 2 * params.maxNeighbors entries
+  double         *edgeCost;		       // both costs of each neighbor edge
+  Node           *robot;		       // where the robot was last seen, NULL if not known
+  double          bias;			       // distance the robot has moved, in h units
+  uint32_t        epoch;		       // advances each time the robot moves
+  int             moved;		       // the bias was raised since the last call
+  int64_t         budgetExpand;		       // expansions allowed per call, 0 for any
+  double          budgetSeconds;	       // time allowed per call, 0 for any
+  double          deadline;		       // end of the current call's time, 0 for none
+  int64_t         sliceStart;		       // expanded when the current call began
+  double          epsilon;		       // heuristic inflation of the current pass
+  double          bound;		       // epsilon of the last path found
+  Node          **passList;		       // nodes expanded in this anytime pass
+  int64_t         passSize;
+  int64_t         passCapacity;
+  Node           *target;		       // start being settled by a query, NULL if none
+  int             pruned;		       // neighbors were pruned since the last new search
+  int             raised;		       // no neighbor pruning until the next new search
+  cbPlanner      *index;		       // the index planner, if this is one
+  DTrace         *trace;		       // records every call, NULL if not traced
+  ArenaChunk     *arenaFirst;		       // the chunks of the node arena, in the order used
+  ArenaChunk     *arenaChunk;		       // the one being handed out, NULL before the first
+  char           *arenaTop;		       // next free byte of it
+  char           *arenaEnd;
+  size_t          arenaChunkBytes;	       // of each chunk
+  int             arenaFlags;		       // DSTAR_ARENA_*
+  size_t          arenaBytes;		       // mapped
+  int64_t         arenaNodes;		       // handed out since the last release
+};
+
+// the search on Node structs
+#define DS_NAME(x) node##x
+#define DS_PLANNER DStarPlanner
+#define DS_NODE Node *
+#define DS_NONE NULL
+#define DS_HEAPTYPE NodeHeap
+#define DS_HEAPNAME(x) nodeHeap##x
+#define DS_OPEN (planner->open)
+#define DS_NEIGHBORBUF (planner->neighbor)
+#define DS_STATE(n) ((n)->state)
+#define DS_G(n) ((n)->g)
+#define DS_K(n) ((n)->k)
+#define DS_H(n) ((n)->h)
+#define DS_HEPOCH(n) ((n)->hEpoch)
+#define DS_OPENINDEX(n) ((n)->openIndex)
+#define DS_F(n) ((n)->f)
+#define DS_SETF(n) ((n)->f = (n)->k + (n)->h)
+#define DS_PARENT(n) ((Node *)(n)->parent)
+#define DS_SETPARENT(n, p) ((n)->parent = (p))
+#define DS_HCALC(n) (planner->cb.hcalc((n), planner->cb.data))
+#define DS_ROBOT(n) (planner->cb.robotNode((n), planner->cb.data))
+#define DS_NEIGHBORS(n, buf) (planner->cb.neighbors((n), (buf), planner->cb.data))
+#define DS_COST(to, from) (planner->cb.cost((to), (from), planner->cb.data))
+#define DS_CANPRUNE (planner->cb.pruneNeighbors != NULL)
+#define DS_PRUNE(n, p, buf, kept) (planner->cb.pruneNeighbors((n), (p), (buf), (kept), planner->cb.data))
+#define DS_CANPRINT (planner->cb.printNode != NULL)
+#define DS_PRINT(n) (planner->cb.printNode((n), planner->cb.data))
+#include "dstarcore.h"
+
+void            DStarDefaultParams(DStarParams * params)
 {
-  Node           *p;
+  DStarParamsDefaults(params);
+}
 
-  printf("Printing list %s\n", name);
-  p = list;
-  while (p != NULL) {
-    printfunc(p);
-    p = p->next;
+DStarPlanner   *DStarPlannerCreate(const DStarCallbacks * cb, const DStarParams * params)
+{
+  DStarPlanner   *planner;
+
+  planner = (DStarPlanner *) calloc(1, sizeof(DStarPlanner));
+  if (planner == NULL)
+    return (NULL);
+
+  if (params != NULL)
+    planner->params = *params;
+  else
+    DStarDefaultParams(&planner->params);
+  planner->cb = *cb;
+  planner->expanded = 0;
+  planner->epsilon = 1.0;
+  planner->arenaChunkBytes = DSTAR_ARENA_CHUNK;
+  planner->bound = 1.0;
+  nodeHeapInit(&planner->open);
+
+  planner->neighbor = (Node **) malloc(sizeof(Node *) * 2 * planner->params.maxNeighbors);
+  planner->edgeCost = (double *) malloc(sizeof(double) * 2 * planner->params.maxNeighbors);
+  if (planner->neighbor == NULL || planner->edgeCost == NULL) {
+    DStarPlannerDestroy(planner);
+    return (NULL);
   }
+
+  return (planner);
 }
 
-Node           *insertOPEN(Node * openList, Node * newnode, double newG, double (*hcalc) (Node *), void (*printNode)(Node *));
-Node           *insertOPEN(Node * openList, Node * newnode, double newG, double (*hcalc) (Node *), void (*printNode)(Node *))
+DStarPlanner   *DStarPlannerCreateIndex(const DStarIndexCallbacks * cb, int64_t numNodes,
+					const DStarParams * params)
 {
-  Node           *p, *q;
+  DStarPlanner   *planner;
+
+  planner = (DStarPlanner *) calloc(1, sizeof(DStarPlanner));
+  if (planner == NULL)
+    return (NULL);
+
+  // the index planner points at the copy of the callbacks kept here
+  planner->icb = *cb;
+  planner->index = cbPlannerCreate(&planner->icb, numNodes, params);
+  if (planner->index == NULL) {
+    free(planner);
+    return (NULL);
+  }
+  planner->params = planner->index->params;
 
+  return (planner);
+}
 
-  if (newnode->state == NEW) {		       // set the k value for this node
+DStarPlanner   *DStarPlannerLoadIndex(const DStarIndexCallbacks * cb, const char *path)
+{
+  DStarPlanner   *planner;
+
+  planner = (DStarPlanner *) calloc(1, sizeof(DStarPlanner));
+  if (planner == NULL)
+    return (NULL);
 
-    newnode->k = newG;
+  planner->icb = *cb;
+  planner->index = cbPlannerLoad(&planner->icb, path);
+  if (planner->index == NULL) {
+    free(planner);
+    return (NULL);
   }
-  else if (newnode->state == OPEN) {	       // node is on OPEN already
+  planner->params = planner->index->params;
 
-    // update the k value if the new g value is lower
-    newnode->k = newnode->k < newG ? newnode->k : newG;
+  return (planner);
+}
 
-    // node is on the open list, so delete it and re-insert it below
-    p = (Node *)newnode->prev;
-    q = (Node *)newnode->next;
-    if (p != NULL)
-      p->next = newnode->next;
-    if (q != NULL)
-      q->prev = newnode->prev;
+int             DStarPlannerSave(const DStarPlanner * planner, FILE * fp)
+{
+  if (planner->index == NULL)
+    return (-1);
 
-    // check for the case of the node being at the head of the list
-    if (newnode == openList)
-      openList = newnode->next;
+  return (cbPlannerSave(planner->index, fp));
+}
 
-    newnode->next = NULL;
-    newnode->prev = NULL;
+// unmaps every chunk of the node arena
+static void     freeArena(DStarPlanner * planner)
+{
+  ArenaChunk     *chunk, *next;
+
+  for (chunk = planner->arenaFirst; chunk != NULL; chunk = next) {
+    next = chunk->next;
+    munmap(chunk, chunk->bytes);
   }
-  else {
-    // update the k value if the new G value is lower
-    newnode->k = newnode->g < newG ? newnode->g : newG;
+  planner->arenaFirst = planner->arenaChunk = NULL;
+  planner->arenaTop = planner->arenaEnd = NULL;
+  planner->arenaBytes = 0;
+  planner->arenaNodes = 0;
+}
+
+// Maps a chunk for the arena, of huge pages if it was asked for and the
+// system has them.  Without reserved huge pages the chunk is left to
+// transparent huge pages, where the system has those.
+static ArenaChunk *mapChunk(DStarPlanner * planner)
+{
+  size_t          bytes = planner->arenaChunkBytes;
+  void           *base = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+  if (planner->arenaFlags & DSTAR_ARENA_HUGE)
+    base = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+  if (base == MAP_FAILED) {
+    base = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+      return (NULL);
+#ifdef MADV_HUGEPAGE
+    if (planner->arenaFlags & DSTAR_ARENA_HUGE)
+      madvise(base, bytes, MADV_HUGEPAGE);
+#endif
   }
+  ((ArenaChunk *) base)->next = NULL;
+  ((ArenaChunk *) base)->bytes = bytes;
+  planner->arenaBytes += bytes;
+
+  return ((ArenaChunk *) base);
+}
+
+void            DStarPlannerDestroy(DStarPlanner * planner)
+{
+  if (planner == NULL)
+    return;
+
+  nodeHeapFree(&planner->open);
+  cbPlannerDestroy(planner->index);
+  free(planner->passList);
+  free(planner->neighbor);
+  free(planner->edgeCost);
+  freeArena(planner);
+  free(planner);
+}
+
+// a query has written its paths
+#define QUERYDONE(status) ((status) == DSTAR_FOUND || (status) == DSTAR_NOPATH)
+
+// the trace records of a call: the call and its arguments, then the result
+static void     traceCall(DStarPlanner * planner, int type, int64_t num, const double costR[2])
+{
+  DTraceCall      call;
+
+  call.num = num;
+  call.costR[0] = costR[0];
+  call.costR[1] = costR[1];
+  DTraceBegin(planner->trace, type);
+  DTraceAppend(planner->trace, &call, sizeof(call));
+}
+
+static void     traceNode(DStarPlanner * planner, int type, int64_t node)
+{
+  if (planner->trace != NULL)
+    DTraceRecord(planner->trace, type, &node, sizeof(node));
+}
+
+static int      traceResult(DStarPlanner * planner, int status, const double costR[2], int64_t path)
+{
+  DTraceResult    result;
 
-  // calculate OPEN sort key
-  newnode->g = newG;
-  newnode->h = hcalc(newnode);
-  newnode->f = newnode->k + newnode->h;
-  newnode->state = OPEN;
+  if (planner->trace == NULL)
+    return (status);
 
-  // now insert the state into the openList 
+  result.status = status;
+  result.path = path;
+  result.expanded = DStarPlannerExpanded(planner);
+  result.costR[0] = costR[0];
+  result.costR[1] = costR[1];
+  result.bound = DStarPlannerBound(planner);
+  DTraceRecord(planner->trace, DTRACE_RESULT, &result, sizeof(result));
 
-  // Test the case where openList is NULL
-  if (openList == NULL) {
-    newnode->next = openList;
-    newnode->prev = NULL;
-    return (newnode);
+  return (status);
+}
+
+void            DStarPlannerTrace(DStarPlanner * planner, DTrace * trace)
+{
+  DTraceParams    create;
+
+  planner->trace = trace;
+  if (trace == NULL)
+    return;
+
+  create.numNodes = planner->index != NULL ? planner->index->numNodes : 0;
+  create.maxExpand = planner->params.maxExpand;
+  create.maxNeighbors = planner->params.maxNeighbors;
+  create.engine = planner->params.engine;
+  create.epsilon = planner->params.epsilon;
+  create.epsilonStep = planner->params.epsilonStep;
+  DTraceRecord(trace, DTRACE_CREATE, &create, sizeof(create));
+}
+
+int             DStarPlannerSearch(DStarPlanner * planner, Node ** initial, int64_t numInitial,
+				   double costR[2], Node ** path)
+{
+  DTraceSeed      seed;
+  int64_t         i;
+  int             status;
+
+  if (planner->trace != NULL) {
+    traceCall(planner, DTRACE_SEARCH, numInitial, costR);
+    for (i = 0; i < numInitial; i++) {
+      seed.node = initial[i]->id;
+      seed.g = initial[i]->g;
+      DTraceAppend(planner->trace, &seed, sizeof(seed));
+    }
+    DTraceEnd(planner->trace);
   }
 
-  // Test the case where the new node is at the head of the list
-  if ((newnode->f < openList->f) || ((newnode->f == openList->f) && (newnode->k < openList->k))) {
-    newnode->next = openList;
-    if(openList != NULL)
-      openList->prev = newnode;
-    newnode->prev = NULL;
-    return (newnode);
+  nodeClearOPEN(planner);
+  planner->pruned = 0;
+  planner->raised = 0;
+
+  if (planner->params.engine != DSTAR_ENGINE_DSTAR)
+    status = nodeLiteSearch(planner, initial, numInitial, costR, path);
+  else
+    status = nodeSearch(planner, initial, numInitial, costR, path);
+
+  return (traceResult(planner, status, costR, *path != NULL ? (*path)->id : -1));
+}
+
+int             DStarPlannerReplan(DStarPlanner * planner, Node ** changed, int64_t numChanged,
+				   double costR[2], Node ** path)
+{
+  int64_t         i;
+  int             status;
+
+  if (planner->trace != NULL) {
+    traceCall(planner, DTRACE_REPLAN, numChanged, costR);
+    for (i = 0; i < numChanged; i++)
+      DTraceAppend(planner->trace, &changed[i]->id, sizeof(int64_t));
+    DTraceEnd(planner->trace);
   }
 
-  // start the loop through the OPEN list
-  p = openList;
-  q = p->next;
-  while (p != NULL) {
+  if (planner->params.engine != DSTAR_ENGINE_DSTAR)
+    status = nodeLiteReplan(planner, changed, numChanged, costR, path);
+  else
+    status = nodeSearch(planner, changed, numChanged, costR, path);
 
-    if (q == NULL) {			       // end of the list, insert after p
+  return (traceResult(planner, status, costR, *path != NULL ? (*path)->id : -1));
+}
 
-      p->next = newnode;
-      newnode->next = NULL;
-      newnode->prev = p;
-      return (openList);
-    }
+void            DStarPlannerReset(DStarPlanner * planner)
+{
+  if (planner->index != NULL) {
+    cbClearOPEN(planner->index);
+    planner->index->passSize = 0;
+    return;
+  }
+  nodeClearOPEN(planner);
+  planner->passSize = 0;
+}
 
-    if (newnode->f < q->f || ((newnode->f == q->f) && (newnode->k < q->k))) {
-      // insert the node before p and after q
-      newnode->next = q;
-      if (q != NULL)
-	q->prev = newnode;
+int             DStarPlannerArena(DStarPlanner * planner, size_t chunkBytes, int flags)
+{
+  size_t          page = (flags & DSTAR_ARENA_HUGE) ? DSTAR_ARENA_CHUNK : 4096;
 
-      p->next = newnode;
-      newnode->prev = p;
+  if (planner->index != NULL)
+    return (-1);
+  if (chunkBytes == 0)
+    chunkBytes = DSTAR_ARENA_CHUNK;
+  if (chunkBytes < 4096)
+    return (-1);
 
-      return (openList);
-    }
+  DStarPlannerReset(planner);
+  freeArena(planner);
+  planner->arenaChunkBytes = (chunkBytes + page - 1) / page * page;
+  planner->arenaFlags = flags;
+
+  return (0);
+}
 
-    p = (Node *) p->next;
-    q = p->next;
+Node           *DStarPlannerNewNode(DStarPlanner * planner, size_t infoBytes)
+{
+  size_t          bytes;
+  ArenaChunk     *chunk;
+  Node           *node;
+
+  bytes = (sizeof(Node) + infoBytes + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+  if (planner->index != NULL || bytes > planner->arenaChunkBytes - ARENA_HEADER)
+    return (NULL);
+
+  // on to the next chunk, which a release has left mapped or is mapped now
+  if (planner->arenaTop == NULL || (size_t) (planner->arenaEnd - planner->arenaTop) < bytes) {
+    chunk = planner->arenaChunk != NULL ? planner->arenaChunk->next : planner->arenaFirst;
+    if (chunk == NULL) {
+      chunk = mapChunk(planner);
+      if (chunk == NULL)
+	return (NULL);
+      if (planner->arenaChunk != NULL)
+	planner->arenaChunk->next = chunk;
+      else
+	planner->arenaFirst = chunk;
+    }
+    planner->arenaChunk = chunk;
+    planner->arenaTop = (char *) chunk + ARENA_HEADER;
+    planner->arenaEnd = (char *) chunk + chunk->bytes;
   }
 
-  return (openList);
+  node = (Node *) planner->arenaTop;
+  planner->arenaTop += bytes;
+
+  node->id = planner->arenaNodes++;
+  node->state = NEW;
+  node->hEpoch = 0;
+  node->g = node->h = node->f = node->k = 0.0;
+  node->parent = NULL;
+  node->openIndex = -1;
+  node->nodeInfo = infoBytes > 0 ? (void *) (node + 1) : NULL;
+  if (infoBytes > 0)
+    memset(node + 1, 0, infoBytes);
+
+  return (node);
 }
 
-#define LESS(a1, a2, b1, b2) ((a1) < (b1) ? 1 : ((a1) == (b1)) && ((a2) < (b2)) ? 1 : 0)
-#define LESSEQ(a1, a2, b1, b2) ((a1) < (b1) ? 1 : ((a1) == (b1)) && ((a2) <= (b2)) ? 1 : 0)
+void            DStarPlannerReleaseNodes(DStarPlanner * planner)
+{
+  // every node is going, so OPEN is dropped without touching any of them
+  planner->open.size = 0;
+  planner->robot = NULL;
+  planner->target = NULL;
+  planner->bias = 0.0;
+  planner->moved = 0;
+  planner->passSize = 0;
+  planner->arenaChunk = NULL;
+  planner->arenaTop = planner->arenaEnd = NULL;
+  planner->arenaNodes = 0;
+}
 
-/* 
- * 
- */
-Node           *DStarSearch(Node ** initial, 
-			    int numInitial, 
-			    double (*gcalc) (Node *), 
-			    double (*hcalc) (Node *),
-			    int (*robotNode) (Node *), 
-			    int (*neighbors) (Node *, Node **),
-			    double (*cost) (Node *, Node *), 
-			    double costR[2],  // (f = h + g, g) for the robot node, large values if never visited
-			    void (*printNode) (Node *))
-     //		    void (*drawArrow) (Node *, Node *))
+int64_t         DStarPlannerNodes(const DStarPlanner * planner)
 {
+  return (planner->arenaNodes);
+}
 
-  Node           *openList;
-  Node           *closedList;
-  Node           *current;
-  Node           *p;
-  Node           *path;
-  Node           *neighbor[MAXNEIGHBORS];
-  double          kold;
-  double          fold;
-  int             numNeighbors;
-  long            i;
-  static int      gblExpand = 0;
-  static Node     *oldOpen = NULL;
+void            DStarPlannerBudget(DStarPlanner * planner, int64_t expansions, int64_t microseconds)
+{
+  DTraceBudget    budget;
 
-  printf("Beginning search\n");
+  if (planner->trace != NULL) {
+    budget.expansions = expansions;
+    budget.microseconds = microseconds;
+    DTraceRecord(planner->trace, DTRACE_BUDGET, &budget, sizeof(budget));
+  }
 
-  // generate the open list
-  openList = NULL;
+  if (planner->index != NULL) {
+    cbPlannerBudget(planner->index, expansions, microseconds);
+    return;
+  }
+  planner->budgetExpand = expansions;
+  planner->budgetSeconds = 1e-6 * microseconds;
+}
 
-  if(oldOpen != NULL) { // this is a recall of Dstar with new information
+int             DStarPlannerResume(DStarPlanner * planner, double costR[2], Node ** path)
+{
+  int             status;
 
-printNodeList(oldOpen, "oldOpen", printNode);
+  if (planner->trace != NULL) {
+    traceCall(planner, DTRACE_RESUME, 0, costR);
+    DTraceEnd(planner->trace);
+  }
 
-    // add the old open list nodes to the new open list so their h values are updated
-    p = oldOpen;
-    while(p != NULL) {
-      p->state = CLOSED;
-      oldOpen = p->next;
+  if (planner->params.engine != DSTAR_ENGINE_DSTAR)
+    status = nodeLiteResume(planner, costR, path);
+  else
+    status = nodeResume(planner, costR, path);
 
-      openList = insertOPEN(openList, p, p->k, hcalc, printNode);
-      
-      p = oldOpen;
-    }
+  return (traceResult(planner, status, costR, *path != NULL ? (*path)->id : -1));
+}
+
+int             DStarPlannerResumeIndex(DStarPlanner * planner, double costR[2], int64_t * path)
+{
+  int             status;
+
+  if (planner->trace != NULL) {
+    traceCall(planner, DTRACE_RESUME, 0, costR);
+    DTraceEnd(planner->trace);
   }
-  // oldOpen is NULL at this point
 
-  // generate the closed list
-  closedList = NULL;
+  status = cbPlannerResume(planner->index, costR, path);
 
-  // put the initial nodes on the open list
-  for (i = 0; i < numInitial; i++)
-    openList = insertOPEN(openList, initial[i], initial[i]->g, hcalc, printNode);
+  return (traceResult(planner, status, costR, *path));
+}
 
-  //printNodeList(openList, "OPEN", printNode);
+int             DStarPlannerImprove(DStarPlanner * planner, double costR[2], Node ** path)
+{
+  int             status;
 
-  while (openList != NULL) {
+  if (planner->trace != NULL) {
+    traceCall(planner, DTRACE_IMPROVE, 0, costR);
+    DTraceEnd(planner->trace);
+  }
 
-    // assume the open list is always sorted (robot doesn't move while D* is running)
-    current = openList;
-    openList = (Node *) openList->next;
-    if (openList != NULL)
-      openList->prev = NULL;
-    gblExpand++;
+  if (planner->params.engine != DSTAR_ENGINE_DSTAR)
+    status = nodeLiteImprove(planner, costR, path);
+  else
+    status = nodeSearch(planner, NULL, 0, costR, path);
 
-    // kold = Get-KMIN()
-    kold = current->k;
-    fold = current->f;
-    current->state = CLOSED;
-    current->next = NULL;		       // need to reset this back to NULL
+  return (traceResult(planner, status, costR, *path != NULL ? (*path)->id : -1));
+}
 
-    current->prev = NULL;
+int             DStarPlannerImproveIndex(DStarPlanner * planner, double costR[2], int64_t * path)
+{
+  int             status;
 
-    //printf("Current node: ");
-    //printNode(current);
+  if (planner->trace != NULL) {
+    traceCall(planner, DTRACE_IMPROVE, 0, costR);
+    DTraceEnd(planner->trace);
+  }
 
-    /*  if(current->parent != NULL) {
-      printf("Current parent: ");
-      printNode(current->parent);
-      }*/
+  status = cbPlannerImprove(planner->index, costR, path);
 
-    /*
-    if(((Node*)current->parent)->parent != NULL) {
-      printf("Current parent's parent: ");
-      printNode(((Node *)current->parent)->parent);
-    }
-    */
+  return (traceResult(planner, status, costR, *path));
+}
 
-    if(robotNode(current)) {
-      costR[0] = current->h + current->g;
-      costR[1] = current->g;
-    } 
+int             DStarPlannerQuery(DStarPlanner * planner, Node ** start, int64_t numStarts,
+				  Node *** path, size_t * capacity, int64_t * offset)
+{
+  double          none[2] = {0.0, 0.0};
+  int64_t         i;
+  int             status;
+
+  if (planner->trace != NULL) {
+    traceCall(planner, DTRACE_QUERY, numStarts, none);
+    for (i = 0; i < numStarts; i++)
+      DTraceAppend(planner->trace, &start[i]->id, sizeof(int64_t));
+    DTraceEnd(planner->trace);
+  }
 
-    // is the current node the goal node?
-    if (robotNode(current) && current->k == current->g) { // robot node, and a LOWER node
-      // If so, return a pointer to the parent node
-      path = (Node *) current->parent;
+  status = nodeQuery(planner, start, numStarts, path, capacity, offset);
 
-      printf("Robot state reached with %d nodes expanded\n", gblExpand);
+  return (traceResult(planner, status, none, QUERYDONE(status) ? offset[numStarts] : -1));
+}
 
-      // set oldOpen to keep around these nodes
-      oldOpen = openList;
+int             DStarPlannerQueryIndex(DStarPlanner * planner, const int64_t * start, int64_t numStarts,
+				       int64_t ** path, size_t * capacity, int64_t * offset)
+{
+  double          none[2] = {0.0, 0.0};
+  int             status;
 
-      // now return the path
-      return (path);
-    }
+  if (planner->trace != NULL) {
+    traceCall(planner, DTRACE_QUERY, numStarts, none);
+    DTraceAppend(planner->trace, start, sizeof(int64_t) * numStarts);
+    DTraceEnd(planner->trace);
+  }
 
-    // has the search gone past where it needs to go?
-    if(!LESSEQ(fold, kold, costR[0], costR[1])) { // exit
-      printf("Search terminated\n");
-      oldOpen = openList;
+  status = cbPlannerQuery(planner->index, start, numStarts, path, capacity, offset);
 
-      return(NULL);
-    }
+  return (traceResult(planner, status, none, QUERYDONE(status) ? offset[numStarts] : -1));
+}
 
-    numNeighbors = neighbors(current, neighbor);
+double          DStarPlannerBound(const DStarPlanner * planner)
+{
+  if (planner->index != NULL)
+    return (cbPlannerBound(planner->index));
 
-    // if kold < g(X) then
-    if (kold < current->g) {		       // check if any of the neighbors have a better path to the
-					       // goal
+  return (planner->bound);
+}
 
-      for (i = 0; i < numNeighbors; i++) {
-	if(neighbor[i]->state == CLOSED && hcalc(neighbor[i]) != neighbor[i]->h)
-	  continue;
-	  
-	if ((neighbor[i]->state != NEW) && LESSEQ(neighbor[i]->f, neighbor[i]->g, fold, kold) &&
-	    (current->g > neighbor[i]->g + cost(neighbor[i], current))) {
+void            DStarPlannerRobotMoved(DStarPlanner * planner, Node * from)
+{
+  traceNode(planner, DTRACE_MOVED, from->id);
+  nodeRobotMoved(planner, from);
+}
+
+void            DStarPlannerRobotMovedIndex(DStarPlanner * planner, int64_t from)
+{
+  traceNode(planner, DTRACE_MOVED, from);
+  cbPlannerRobotMoved(planner->index, from);
+}
 
-	  // reset the back pointer to the better neighbor
-	  current->parent = neighbor[i];
+void            DStarPlannerRobotAt(DStarPlanner * planner, Node * robot)
+{
+  traceNode(planner, DTRACE_ROBOTAT, robot->id);
+  nodeRobotAt(planner, robot);
+}
+
+void            DStarPlannerRobotAtIndex(DStarPlanner * planner, int64_t robot)
+{
+  traceNode(planner, DTRACE_ROBOTAT, robot);
+  cbPlannerRobotAt(planner->index, robot);
+}
 
-	  // calculate the new g value for the current node
-	  current->g = neighbor[i]->g + cost(neighbor[i], current);
-	}
-      }
+int             DStarPlannerSearchIndex(DStarPlanner * planner, const int64_t * goal, int64_t numGoals,
+					double costR[2], int64_t * path)
+{
+  DTraceSeed      seed;
+  int64_t         i;
+  int             status;
+
+  if (planner->trace != NULL) {
+    traceCall(planner, DTRACE_SEARCH, numGoals, costR);
+    seed.g = 0;
+    for (i = 0; i < numGoals; i++) {
+      seed.node = goal[i];
+      DTraceAppend(planner->trace, &seed, sizeof(seed));
     }
+    DTraceEnd(planner->trace);
+  }
 
-    //printf("Node after neighbors: ");
-    //printNode(current);
+  status = cbPlannerSearch(planner->index, goal, numGoals, costR, path);
 
-    /*if(current->parent != NULL) {
-      printf("Parent after neighbors: ");
-      printNode(current->parent);
-      }*/
+  return (traceResult(planner, status, costR, *path));
+}
 
-    if (kold == current->g) {		       // LOWER state
+int             DStarPlannerReplanIndex(DStarPlanner * planner, const int64_t * changed, int64_t numChanged,
+					double costR[2], int64_t * path)
+{
+  int             status;
 
-      //printf("Lower state\n");
+  if (planner->trace != NULL) {
+    traceCall(planner, DTRACE_REPLAN, numChanged, costR);
+    DTraceAppend(planner->trace, changed, sizeof(int64_t) * numChanged);
+    DTraceEnd(planner->trace);
+  }
 
-      for (i = 0; i < numNeighbors; i++) {
-	if ((neighbor[i]->state == NEW) ||
-	((neighbor[i]->parent == current) && (neighbor[i]->g != current->g + cost(current, neighbor[i]))) ||
-	 ((neighbor[i]->parent != current) && (neighbor[i]->g > current->g + cost(current, neighbor[i])))) {
+  status = cbPlannerReplan(planner->index, changed, numChanged, costR, path);
 
-	  // printf("Updated child cost\n");
+  return (traceResult(planner, status, costR, *path));
+}
 
-	  // set the back pointer
-	  neighbor[i]->parent = current;
+void            DStarPlannerNode(const DStarPlanner * planner, int64_t id, Node * node)
+{
+  cbPlannerNode(planner->index, id, node);
+}
 
-	  // insert the neighbor into OPEN with the new G value
-	  openList = insertOPEN(openList, neighbor[i], current->g + cost(current, neighbor[i]), hcalc, printNode);
-	}
-      }
-    }
-    else {				       // RAISE state
+int64_t         DStarPlannerParent(const DStarPlanner * planner, int64_t id)
+{
+  return (cbPlannerParent(planner->index, id));
+}
 
-      //printf("Raise state\n");
+int64_t         DStarPlannerExpanded(const DStarPlanner * planner)
+{
+  if (planner->index != NULL)
+    return (cbPlannerExpanded(planner->index));
 
-      for (i = 0; i < numNeighbors; i++) {
+  return (planner->expanded);
+}
 
-	if ((neighbor[i]->state == NEW) ||
-	((neighbor[i]->parent == current) && (neighbor[i]->g != current->g + cost(current, neighbor[i])))) {
+int             DStarPlannerStats(const DStarPlanner * planner, DStarStats * stats)
+{
+  if (planner->index != NULL)
+    return (cbPlannerStats(planner->index, stats));
+
+  *stats = planner->stats;
+  stats->expanded = planner->expanded;
+#ifdef DSTAR_STATS
+  return (0);
+#else
+  return (-1);
+#endif
+}
 
-	  //printf("inserted a neighbor with a new cost value\n");
+void            DStarPlannerPrintOPEN(DStarPlanner * planner)
+{
+  if (planner->index != NULL)
+    cbPrintOPEN(planner->index, "OPEN");
+  else
+    nodePrintOPEN(planner, "OPEN");
+}
 
-	  // set the back pointer
-	  neighbor[i]->parent = current;
+size_t          DStarPlannerBytes(const DStarPlanner * planner)
+{
+  size_t          bytes = sizeof(DStarPlanner);
 
-	  // insert the neighbor into OPEN with the new g value
-	  openList = insertOPEN(openList, neighbor[i], current->g + cost(current, neighbor[i]), hcalc, printNode);
-	}
-	else {
-	  if ((neighbor[i]->parent != current) && (neighbor[i]->g > current->g + cost(current, neighbor[i]))) {
+  if (planner->index != NULL)
+    return (bytes + cbPlannerBytes(planner->index));
 
-	    //printf("inserted self as a holding action\n");
+  bytes += sizeof(NodeHeapEntry) * planner->open.capacity;
+  bytes += 2 * (sizeof(Node *) + sizeof(double)) * planner->params.maxNeighbors;
+  bytes += sizeof(Node *) * planner->passCapacity;
+  bytes += planner->arenaBytes;
 
-	    // insert the current node into OPEN as a holding action until its neighbors are optimal
-	    openList = insertOPEN(openList, current, current->g, hcalc, printNode);
-	  }
-	  else if ((neighbor[i]->parent != current) &&
-		   (current->g > neighbor[i]->g + cost(neighbor[i], current)) &&
-		   (neighbor[i]->state == CLOSED) && LESS(fold, kold, neighbor[i]->f, neighbor[i]->g)) {
+  return (bytes);
+}
 
-	    //printf("inserted neighbor as a holding action\n");
+// The old function pointer interface runs on one static planner
+static struct {
+  double          (*hcalc) (Node *);
+  int             (*robotNode) (Node *);
+  int             (*neighbors) (Node *, Node **);
+  double          (*cost) (Node *, Node *);
+  void            (*printNode) (Node *);
+} gblLegacy;
 
-	    // re-insert this CLOSED node since it is not optimal but already provides a better path
-	    openList = insertOPEN(openList, neighbor[i], neighbor[i]->g, hcalc, printNode);
-	  }
-	}
-      }
-    }
+static double   legacyH(Node * p, void *data)
+{
+  return (gblLegacy.hcalc(p));
+}
 
-    // draw the current node in the map here
-    //drawArrow(current, current->parent);
+static int      legacyRobot(Node * p, void *data)
+{
+  return (gblLegacy.robotNode(p));
+}
+
+static int      legacyNeighbors(Node * p, Node ** neighbor, void *data)
+{
+  return (gblLegacy.neighbors(p, neighbor));
+}
 
-    /*if(current->parent != NULL) {
-      printf("New parent: ");
-      printNode(current->parent);
-      }*/
+static double   legacyCost(Node * to, Node * from, void *data)
+{
+  return (gblLegacy.cost(to, from));
+}
 
-    // Test to see if we have expanded too many nodes without a solution
-    if (gblExpand > MAXNODES) {
-      printf("Expanded more than the maximum allowable nodes (%d). Terminating\n", gblExpand);
+static void     legacyPrint(Node * p, void *data)
+{
+  gblLegacy.printNode(p);
+}
 
+/* 
+ * 
+ */
+Node           *DStarSearch(Node ** initial, 
+			    int numInitial, 
+			    double (*gcalc) (Node *), 
+			    double (*hcalc) (Node *),
+			    int (*robotNode) (Node *), 
+			    int (*neighbors) (Node *, Node **),
+			    double (*cost) (Node *, Node *), 
+			    double costR[2],  // (f = h + g, g) for the robot node, large values if never visited
+			    void (*printNode) (Node *))
+     //		    void (*drawArrow) (Node *, Node *))
+{
+  static DStarPlanner *planner = NULL;
+  DStarCallbacks  cb;
+  Node           *path;
+
+  gblLegacy.hcalc = hcalc;
+  gblLegacy.robotNode = robotNode;
+  gblLegacy.neighbors = neighbors;
+  gblLegacy.cost = cost;
+  gblLegacy.printNode = printNode;
+
+  if (planner == NULL) {
+    cb.gcalc = NULL;
+    cb.hcalc = legacyH;
+    cb.robotNode = legacyRobot;
+    cb.neighbors = legacyNeighbors;
+    cb.cost = legacyCost;
+    cb.printNode = legacyPrint;
+    cb.pruneNeighbors = NULL;
+    cb.data = NULL;
+
+    planner = DStarPlannerCreate(&cb, NULL);
+    if (planner == NULL)
       return (NULL);
-    }
-  }					       // end of OPEN loop
+  }
 
-  // if we got here, then there is no path to the goal
-  oldOpen = openList;
-  printNodeList(oldOpen, "oldOpen", printNode);
+  // old callers get the messages the search used to print
+  printf("Beginning search\n");
+  switch (DStarPlannerReplan(planner, initial, numInitial, costR, &path)) {
+  case DSTAR_FOUND:
+    printf("Robot state reached with %" PRId64 " nodes expanded\n", planner->expanded);
+    break;
+  case DSTAR_TERMINATED:
+    printf("Search terminated\n");
+    break;
+  case DSTAR_LIMIT:
+    printf("Expanded more than the maximum allowable nodes (%" PRId64 "). Terminating\n", planner->expanded);
+    break;
+  case DSTAR_NOMEM:
+    printf("Out of memory for the OPEN list\n");
+    break;
+  }
 
-  return (NULL);
+  return (path);
 }
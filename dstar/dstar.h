@@ -1,32 +1,377 @@
 // Include file for D-star search algorithm
 
-// These are global parameters that constrain the search
+#ifndef DSTAR_H
+#define DSTAR_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// Default limits for a planner; DStarSearch always uses these
 
 #define MAXNODES  30000
 #define MAXNEIGHBORS	25
-#define GRIDX	60
-#define GRIDY	20
 
 // These are ueful enumerations
 #define OPEN 1
 #define NEW 0
 #define CLOSED 2
+#define EXPANDED 3		// Anytime D*: closed in this pass
+#define INCONS 4		// Anytime D*: inconsistent again, waits for the next pass
 
 typedef struct {
-  long  id;
-  int  state;   		// {OPEN, NEW, CLOSED}
+  int64_t  id;
+  int  state;   		// {OPEN, NEW, CLOSED, EXPANDED, INCONS}
+  uint32_t hEpoch;		// planner epoch h was computed in, unused while NEW
   double g;
   double h;
   double f;
   double k;
   void *parent;			// D* backpointer
-  void *next;			// used for linked list connections
-  void *prev;			// used for linked list connections
+  int64_t openIndex;		// position in the OPEN heap while state == OPEN
   void *nodeInfo;
 } Node;
 
 
+// return values of the planner calls
+#define DSTAR_FOUND       0	// robot state reached, *path is its parent
+#define DSTAR_TERMINATED  1	// search passed the robot's cost, its backpointers still hold
+#define DSTAR_NOPATH      2	// OPEN ran out before the robot state was reached
+#define DSTAR_LIMIT       3	// more than maxExpand nodes were expanded
+#define DSTAR_UNFINISHED  4	// the budget ran out, DStarPlannerResume goes on
+#define DSTAR_NOMEM      -1	// the OPEN list could not grow
+
+// What DSTAR_LIMIT leaves depends on the engine.  D* empties OPEN,
+// marking what was on it CLOSED, and forgets where the robot is: the g
+// values and backpointers so far stay but are unfinished, so only a new
+// search (or DStarPlannerReset) may follow, not a replan or resume.  D*
+// Lite and Anytime D* keep OPEN and every node as they were, since
+// dropping OPEN would leave nodes inconsistent; a replan or improve goes
+// on from there with a fresh allowance of maxExpand, and a new search
+// starts over.  A resume would count on from the spent allowance and
+// stop again at once.
+
+// The callbacks a planner uses.  Each one is passed the data pointer, so a
+// process can run one planner per robot on separate threads as long as the
+// callbacks only touch what hangs off data.  An index planner keeps its
+// search state in arrays of its own, so many of them can plan over one map
+// that nobody writes to meanwhile; dpool.h runs them on a pool of threads.
+typedef struct {
+  double (*gcalc)(Node *, void *);
+  double (*hcalc)(Node *, void *);
+  int (*robotNode)(Node *, void *);
+  int (*neighbors)(Node *, Node **, void *);
+  double (*cost)(Node *, Node *, void *);
+  void (*printNode)(Node *, void *);	// may be NULL
+  int (*pruneNeighbors)(Node *, Node *, Node **, int *, void *);	// may be NULL
+  void *data;
+} DStarCallbacks;
+
+// The callbacks of an index planner, whose nodes are numbered 0 .. numNodes-1.
+// The planner keeps g, k, h, parent and state for every node in compact
+// arrays of its own, so the caller allocates no Node structs at all.
+typedef struct {
+  double (*hcalc)(int64_t, void *);
+  int (*robotNode)(int64_t, void *);
+  int (*neighbors)(int64_t, int64_t *, void *);
+  double (*cost)(int64_t, int64_t, void *);	// (to, from)
+  void (*printNode)(Node *, void *);	// gets a copy of the node, may be NULL
+  int (*pruneNeighbors)(int64_t, int64_t, int64_t *, int *, void *);	// may be NULL
+  void *data;
+} DStarIndexCallbacks;
+
+// pruneNeighbors(n, parent, neighbor, numKept, data), when there is one,
+// is called instead of neighbors when the search is lowering n's value,
+// with the backpointer n was reached from (NULL or -1 if none).  It writes
+// the same neighbors but puts first the ones a path from parent through n
+// can improve on, gives their number in *numKept and returns the total.
+// The search passes nothing on to the others beyond n's own children, so
+// a neighbor may only be left out if a path from parent that avoids n
+// reaches it at no greater cost; dmap.h does this for uniform grids.
+
+// the search engines a planner can run
+#define DSTAR_ENGINE_DSTAR 0	// Focused D*
+#define DSTAR_ENGINE_LITE  1	// D* Lite; k holds rhs
+#define DSTAR_ENGINE_ANYTIME 2	// Anytime D*: D* Lite with an inflated heuristic
+
+// Limits and engine fixed when a planner is built
+typedef struct {
+  int64_t maxExpand;		// expansions allowed per call, 0 for no limit
+  int maxNeighbors;		// most nodes the neighbors callback returns
+  int engine;			// one of DSTAR_ENGINE_*
+  double epsilon;		// Anytime D*: heuristic inflation of a search, >= 1
+  double epsilonStep;		// Anytime D*: taken off epsilon by each improve
+} DStarParams;
+
+// A planner owns the OPEN list and counters of one incremental search
+typedef struct DStarPlanner DStarPlanner;
+
+// phases of a search or replan timed in DStarStats
+#define DSTAR_PHASE_REKEY   0	// re-keying OPEN after the robot moved
+#define DSTAR_PHASE_SEED    1	// putting the goals or changed nodes on OPEN
+#define DSTAR_PHASE_EXPAND  2	// the expansion loop
+#define DSTAR_NUMPHASES     3
+
+// What the last search or replan did.  Only expanded is kept unless the
+// library is built with DSTAR_STATS defined.
+typedef struct {
+  int64_t expanded;		// nodes taken off OPEN
+  int64_t raise;		// of those, RAISE (D* Lite: underconsistent)
+  int64_t lower;		// of those, LOWER (D* Lite: overconsistent)
+  int64_t inserts;		// nodes put on OPEN
+  int64_t reinserts;		// keys changed of nodes on OPEN, or CLOSED nodes put back
+  int64_t holds;		// of the inserts, holding actions (D* only)
+  int64_t rekeys;		// stale keys at the top of OPEN raised
+  int64_t pruned;		// neighbors skipped by pruneNeighbors
+  int64_t hcalcs;		// calls of the heuristic
+  int64_t costs;		// calls of the edge cost
+  int64_t openMax;		// most nodes on OPEN at once
+  double seconds[DSTAR_NUMPHASES];	// time in each phase
+} DStarStats;
+
+// monotonic clock in seconds for the phase timers and budgets
+static inline double DStarNow(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec + 1e-9 * ts.tv_nsec);
+}
+
+// the default params, here so that a planner made from dstarinline.h
+// without dstar.c gets the same ones; DStarDefaultParams sets these
+static inline void DStarParamsDefaults(DStarParams *params)
+{
+  params->maxExpand = MAXNODES;
+  params->maxNeighbors = MAXNEIGHBORS;
+  params->engine = DSTAR_ENGINE_DSTAR;
+  params->epsilon = 3.0;
+  params->epsilonStep = 0.5;
+}
+
 // function prototypes
+void DStarDefaultParams(DStarParams *params);
+
+// params may be NULL for the defaults
+DStarPlanner *DStarPlannerCreate(const DStarCallbacks *cb, const DStarParams *params);
+void DStarPlannerDestroy(DStarPlanner *planner);
+
+// an index planner; numNodes must be below 2^32 - 1 so parents fit in 32 bits
+DStarPlanner *DStarPlannerCreateIndex(const DStarIndexCallbacks *cb, int64_t numNodes,
+				      const DStarParams *params);
+
+// start a new search from the initial (goal) nodes; OPEN is emptied first
+int DStarPlannerSearch(DStarPlanner *planner, Node **initial, int64_t numInitial,
+		       double costR[2], Node **path);
+
+// continue after costs changed or the robot moved; changed nodes go on OPEN
+// next to whatever the last call left there.  For D* Lite, changed nodes
+// are those whose edges changed cost, in either direction.
+int DStarPlannerReplan(DStarPlanner *planner, Node **changed, int64_t numChanged,
+		       double costR[2], Node **path);
+
+// the same two calls for an index planner.  A new search forgets every
+// node, then starts from the goals with g = 0; *path is -1 if there is none.
+int DStarPlannerSearchIndex(DStarPlanner *planner, const int64_t *goal, int64_t numGoals,
+			    double costR[2], int64_t *path);
+int DStarPlannerReplanIndex(DStarPlanner *planner, const int64_t *changed, int64_t numChanged,
+			    double costR[2], int64_t *path);
+
+// Forget the last search: OPEN is emptied and where the robot is is
+// forgotten, as a new search does first.  A caller whose Node structs can
+// be recycled (dtile.h) does this before recycling them, so the planner
+// holds none of them.
+void DStarPlannerReset(DStarPlanner *planner);
+
+// A planner on Node structs can hand them out itself, from an arena of
+// chunks it maps.  Each node comes with infoBytes of zeros right after it
+// for its nodeInfo, and nodes follow one another in the order they are
+// asked for, so a graph built as the search reaches it lies in memory in
+// the order it is expanded.  DStarPlannerReleaseNodes takes every node
+// back at once, in constant time, at the end of an episode; the chunks
+// stay mapped for the next one.  Nothing is freed one node at a time.
+#define DSTAR_ARENA_CHUNK (2 << 20)	// default bytes per chunk, one huge page
+#define DSTAR_ARENA_HUGE 1		// back the chunks with huge pages
+
+// Sets the bytes of each chunk, 0 for DSTAR_ARENA_CHUNK, and the flags;
+// with DSTAR_ARENA_HUGE a chunk is rounded up to whole huge pages and
+// mapped from the reserved ones, or left to transparent huge pages if
+// there are none.  Every node is released and the chunks unmapped.  -1 for
+// an index planner or a chunk below 4096 bytes.
+int DStarPlannerArena(DStarPlanner *planner, size_t chunkBytes, int flags);
+
+// A NEW node with no parent, its id the number of nodes handed out since
+// the last release, and nodeInfo pointing at infoBytes of zeros, or NULL
+// if infoBytes is 0.  NULL for an index planner, a node that does not fit
+// in a chunk, or if there is not enough memory.
+Node *DStarPlannerNewNode(DStarPlanner *planner, size_t infoBytes);
+
+// Resets the planner as DStarPlannerReset does, then takes back every node
+// it has handed out.  None of them may be used after.
+void DStarPlannerReleaseNodes(DStarPlanner *planner);
+
+// nodes handed out since the last release
+int64_t DStarPlannerNodes(const DStarPlanner *planner);
+
+// Budget of every later search, replan or resume: it stops after
+// expansions nodes or microseconds, whichever comes first, and returns
+// DSTAR_UNFINISHED with OPEN and every node left as they were.  0 is no
+// limit for either.  The clock is read every 32 expansions, each call
+// expands at least one node, and the re-keying and seeding at the start
+// of a search or replan are never split, so a call can overrun by those.
+// Unlike maxExpand, which counts a search together with its resumes,
+// running out of budget throws nothing away.
+void DStarPlannerBudget(DStarPlanner *planner, int64_t expansions, int64_t microseconds);
+
+// Go on from where a call that returned DSTAR_UNFINISHED stopped, with the
+// costR it passed back.  Moves of the robot in between must be told with
+// DStarPlannerRobotAt or DStarPlannerRobotMoved; changed edges need a
+// replan instead, which also picks up where the search stopped.
+int DStarPlannerResume(DStarPlanner *planner, double costR[2], Node **path);
+int DStarPlannerResumeIndex(DStarPlanner *planner, double costR[2], int64_t *path);
+
+// Anytime D*: a search or replan finds a path that costs at most epsilon
+// times the optimal, which is quick to find while epsilon is large.
+// Improve lowers epsilon by params.epsilonStep, to no less than 1, and
+// runs the search again with what the last one found, giving a path at
+// least as good; call it while DStarPlannerBound is above 1 and there is
+// time left.  A replan keeps the epsilon it is at.  The other engines
+// always search with epsilon 1, so for them improve is a plain replan with
+// nothing changed.
+int DStarPlannerImprove(DStarPlanner *planner, double costR[2], Node **path);
+int DStarPlannerImproveIndex(DStarPlanner *planner, double costR[2], int64_t *path);
+
+// the suboptimality bound of the last path found: its cost is at most
+// this times the optimal
+double DStarPlannerBound(const DStarPlanner *planner);
+
+// Paths for many robots heading for the goals of the last search, from
+// one backpointer tree.  The search goes on from where the last call
+// left it until every start node is settled, and no further, then the
+// path from each start to its goal, start first, goes into one array:
+// path i is (*path)[offset[i]] .. (*path)[offset[i+1] - 1], empty if start
+// i has no path, or if its backpointers loop.  *path holds *capacity nodes and is grown with realloc
+// as needed (start with NULL and 0); offset needs numStarts + 1 entries.
+// Returns DSTAR_FOUND, or DSTAR_NOPATH if some start has no path; the
+// paths are only written with these two.  Otherwise it returns what
+// stopped the search, and after DSTAR_UNFINISHED the same query called
+// again goes on with the starts not yet settled.  The robot stays where
+// the planner last saw it, for the keys on OPEN.
+int DStarPlannerQuery(DStarPlanner *planner, Node **start, int64_t numStarts,
+		      Node ***path, size_t *capacity, int64_t *offset);
+int DStarPlannerQueryIndex(DStarPlanner *planner, const int64_t *start, int64_t numStarts,
+			   int64_t **path, size_t *capacity, int64_t *offset);
+
+// Tell the planner the robot has moved away from node from, after the
+// hcalc callback has started measuring from its new position.  Focused
+// D* then adds the distance moved to a bias instead of re-keying all of
+// OPEN, and nodes are re-keyed as they come to the top.  A planner that
+// has reached the robot node notices the move by itself; without either,
+// the next replan re-keys all of OPEN.
+void DStarPlannerRobotMoved(DStarPlanner *planner, Node *from);
+void DStarPlannerRobotMovedIndex(DStarPlanner *planner, int64_t from);
+
+// Tell the planner which node the robot is at, after the hcalc callback
+// measures from there.  A different node than last time counts as a move.
+// D* Lite needs this to stop a replan as soon as the robot's node is
+// consistent; without it, it searches until it expands the robot's node.
+void DStarPlannerRobotAt(DStarPlanner *planner, Node *robot);
+void DStarPlannerRobotAtIndex(DStarPlanner *planner, int64_t robot);
+
+// copy of a node of an index planner (parent and nodeInfo are NULL)
+void DStarPlannerNode(const DStarPlanner *planner, int64_t id, Node *node);
+
+// backpointer of a node of an index planner, -1 if it has none
+int64_t DStarPlannerParent(const DStarPlanner *planner, int64_t id);
+
+// memory owned by the planner, including an index planner's node arrays
+// and the chunks of the node arena
+size_t DStarPlannerBytes(const DStarPlanner *planner);
+
+// number of nodes expanded by the last search or replan, counting the
+// resumes of it so far
+int64_t DStarPlannerExpanded(const DStarPlanner *planner);
+
+// what the last search or replan did; returns -1, with only expanded
+// filled in, if the library was built without DSTAR_STATS
+int DStarPlannerStats(const DStarPlanner *planner, DStarStats *stats);
+
+// prints OPEN with the printNode callback, for debugging
+void DStarPlannerPrintOPEN(DStarPlanner *planner);
+
+// Record every call to the planner in trace (see dtrace.h), starting with
+// its params; NULL stops the recording.  Nodes are recorded by their id,
+// so the ids of Node structs must be unique.  dreplay runs a trace again.
+struct DTrace;
+void DStarPlannerTrace(DStarPlanner *planner, struct DTrace *trace);
+
+// A snapshot is the whole state of an index planner: a DStarSnapshotHeader,
+// then g, k and h of every node as doubles, the parents as uint32_t, the
+// states as bytes, the epochs of the h values as uint32_t, the entries of
+// OPEN as the heap holds them and the nodes of the anytime pass as
+// int64_t, each starting at its offset, a multiple of 64.  Everything is in the byte order and layout of the
+// machine that wrote it.
+#define DSTAR_SNAPSHOT_MAGIC "DSTARSN"	// 8 bytes with the terminating 0
+#define DSTAR_SNAPSHOT_VERSION 2
+#define DSTAR_SNAPSHOT_ORDER 0x01020304
+
+// the sections of a snapshot
+#define DSTAR_SNAPSHOT_G      0
+#define DSTAR_SNAPSHOT_K      1
+#define DSTAR_SNAPSHOT_H      2
+#define DSTAR_SNAPSHOT_PARENT 3
+#define DSTAR_SNAPSHOT_STATE  4
+#define DSTAR_SNAPSHOT_HEPOCH 5
+#define DSTAR_SNAPSHOT_OPEN   6	// the heap's entries as they lie, in heap order
+#define DSTAR_SNAPSHOT_PASS   7
+#define DSTAR_SNAPSHOT_SECTIONS 8
+
+typedef struct {
+  char magic[8];
+  uint32_t order;		// DSTAR_SNAPSHOT_ORDER as written
+  uint32_t version;
+  int64_t numNodes;
+  int64_t maxExpand;		// the params
+  int64_t maxNeighbors;
+  int64_t engine;
+  double paramEpsilon;
+  double epsilonStep;
+  int64_t robot;		// the rest of the planner, as it was
+  int64_t target;
+  int64_t expanded;
+  int64_t sliceStart;
+  double bias;
+  double epsilon;
+  double bound;
+  int64_t epoch;
+  int64_t moved;
+  int64_t pruned;
+  int64_t raised;
+  int64_t openSize;
+  uint64_t openSeq;
+  int64_t openEntryBytes;	// of one entry, to check the layout
+  int64_t passSize;
+  uint64_t offset[DSTAR_SNAPSHOT_SECTIONS];
+} DStarSnapshotHeader;
+
+// Write the state of an index planner to fp as a snapshot; -1 if a write
+// failed or the planner is one on Node structs, whose state is in the
+// caller's nodes.  The budget is not saved.
+int DStarPlannerSave(const DStarPlanner *planner, FILE *fp);
+
+// An index planner with the state of the snapshot at path, the callbacks
+// given and the params it was saved with.  The file is mapped copy-on-write
+// and the node arrays are used where they lie, so only OPEN, the parents
+// and the states, which are checked, and the pages the next calls touch
+// are ever read; the file is never written.  NULL if the file cannot be
+// read or mapped, with errno set by the call that failed, if it is not a
+// snapshot this build can use, names a node out of range, has a state the
+// engine does not use or an OPEN that does not match the OPEN nodes, with
+// errno EINVAL, or if there is not enough memory.
+DStarPlanner *DStarPlannerLoadIndex(const DStarIndexCallbacks *cb, const char *path);
+
+// single planner version kept for old callers; not re-entrant
 Node *DStarSearch(Node **initialList, int numInitial,
 				  double (*gcalc)(Node *), 
 				  double (*hcalc)(Node *),
@@ -36,3 +381,5 @@ Node *DStarSearch(Node **initialList, int numInitial,
 		                  double costR[2],
 				  void (*printNode)(Node *));
 //	  void (*drawArrow)(Node *, Node *));
+
+#endif
@@ -0,0 +1,786 @@
+/*
+  The D* search loop, written once for every kind of node storage.
+
+  This file is a template included by dstar.c.  Before including it, define:
+
+    DS_NAME(x)           prefixes the generated functions, e.g. node##x
+    DS_PLANNER           the planner type; it has the members expanded,
+                         stats, params (a DStarParams), edgeCost, and robot (a
+                         DS_NODE), bias, epoch and moved for the bias below,
+                         and budgetExpand, budgetSeconds, deadline and
+                         sliceStart for the budget of a call; for the
+                         anytime engine also epsilon, bound and the pass
+                         list passList, passSize and passCapacity; and
+                         target (a DS_NODE, DS_NONE outside a query);
+                         and pruned and raised for the neighbor pruning
+                         below
+    DS_NODE              node handle type (Node *, int64_t, ...)
+    DS_NONE              handle meaning "no node"
+    DS_HEAPTYPE          heap type holding DS_NODE items
+    DS_HEAPNAME(x)       prefix of that heap's functions
+    DS_OPEN              the planner's OPEN heap
+    DS_NEIGHBORBUF       the planner's neighbor array of DS_NODE
+
+    DS_STATE(n), DS_G(n), DS_K(n), DS_H(n), DS_OPENINDEX(n)
+                         lvalues for the node's fields
+    DS_HEPOCH(n)         lvalue for the planner->epoch the node's h was
+                         computed in, a uint32_t; it is only read once the
+                         node is no longer NEW
+    DS_F(n)              the node's f value
+    DS_SETF(n)           stores k + h as f, if the storage keeps f at all
+    DS_PARENT(n)         the node's backpointer, DS_NONE if it has none
+    DS_SETPARENT(n, p)   sets the backpointer
+
+    DS_HCALC(n), DS_ROBOT(n), DS_NEIGHBORS(n, buf), DS_COST(to, from)
+                         the callbacks
+    DS_COSTIN(n, i, m), DS_COSTOUT(n, i, m)
+                         optional, DS_COST(n, m) and DS_COST(m, n) for m
+                         the i-th neighbor DS_NEIGHBORS gives n, for
+                         storage that keeps the costs of each node's edges
+                         in the order of its neighbors; DS_PRUNE must then
+                         give the neighbors in that order too
+    DS_CANPRUNE          true if DS_PRUNE may be called
+    DS_PRUNE(n, p, buf, kept)
+                         the neighbors of n as DS_NEIGHBORS gives them, for
+                         n reached from its backpointer p (DS_NONE if it
+                         has none), with first the *kept of them a path
+                         through n can improve on
+    DS_CANPRINT          true if DS_PRINT(n) may be called
+    DS_PRINT(n)          prints a node
+    DS_RELAX(current, neighbor, cost, num, numKept, raise, act)
+                         optional, the tests a LOWER (raise 0) or RAISE
+                         expansion makes of each neighbor, all at once, as
+                         DStarRelax of dstarrelax.h does them; act is the
+                         planner's member relax, with room for
+                         params.maxNeighbors
+
+  All of these may refer to the variable planner, the DS_PLANNER being
+  searched.  The edge costs of the node being expanded are cached in
+  planner->edgeCost, which has room for 2 * params.maxNeighbors.
+  Everything is #undef'd at the end so the file can be included again for
+  a different storage.
+
+  Nothing is printed while searching.  The planner also has a DStarStats
+  member stats, which each call resets and fills in when DSTAR_STATS is
+  defined; without it the counting is compiled out.
+
+  Neighbor pruning only ever thins out a LOWER expansion, D* Lite's
+  overconsistent one, whose value flows on to its neighbors.  The
+  neighbors past the kept ones are skipped unless they are children of
+  the node, whose values must follow it; a RAISE or underconsistent
+  expansion, and every other look at the neighbors, sees all of them.
+  Pruning is only sound while values only come down, as in a new search,
+  an anytime pass or a replan after costs dropped: a LOWER node that D*
+  puts back as a holding action, or one whose neighbors' values a raise
+  has left behind, has to reach every neighbor.  So once a RAISE or
+  underconsistent node has been expanded, planner->raised turns pruning
+  off until the caller starts a new search and clears both flags.  From
+  then on a NEW node may still border CLOSED nodes that skipped it while
+  planner->pruned was being set, so a NEW node reached after that takes
+  the best value any of its neighbors offers, not just the one reaching
+  it.
+
+  Robot motion is handled with the bias of Focused D*.  OPEN is ordered on
+  f plus planner->bias, the distance the robot has moved so far, and each
+  entry is stamped with the planner->epoch its key was computed in.  When
+  the robot moves, the bias grows by the distance moved and the epoch
+  advances, so every stale key on OPEN is still a lower bound on its true
+  key.  A stale entry is re-keyed when it comes to the top of OPEN rather
+  than all of OPEN being re-keyed at once.  The f, g, h and k of the nodes
+  themselves carry no bias.
+
+  Each node's h is stamped with the epoch it was computed in, so it is
+  only computed again, when the node is next keyed, once the robot has
+  moved since.  The epoch also advances whenever the planner cannot tell
+  whether the robot moved: a new robot node after the last one was
+  forgotten, OPEN emptied, or a call that starts with nothing on OPEN.  A
+  node whose stamp is the epoch has an h from where the robot is now, so
+  comparing stamps tells that without calling DS_HCALC.
+
+  A call stops with DSTAR_UNFINISHED once it has spent its budget, between
+  two expansions, so OPEN and the nodes are exactly as they would be at
+  that point of a call without one.  Resume then carries on the loop
+  without re-keying or seeding anything.
+
+  dstarlite.h is included at the end, so each storage also gets the D*
+  Lite engine.  The neighbor array must then have room for
+  2 * params.maxNeighbors.
+
+  A query for many robots settles a list of start nodes one at a time by
+  making each the planner's target: the search then stops once the
+  target is settled rather than at the robot, and with the robot's
+  node out of the way it may expand past it.  Each start's path is then
+  read off the backpointers.
+*/
+
+#define LESS(a1, a2, b1, b2) ((a1) < (b1) ? 1 : ((a1) == (b1)) && ((a2) < (b2)) ? 1 : 0)
+#define LESSEQ(a1, a2, b1, b2) ((a1) < (b1) ? 1 : ((a1) == (b1)) && ((a2) <= (b2)) ? 1 : 0)
+
+// the OPEN key of a node: f plus the robot motion bias
+#define BIASEDF(n) (DS_F(n) + planner->bias)
+
+// statistics, compiled out unless DSTAR_STATS is defined
+#ifdef DSTAR_STATS
+#define STAT(field) ((void)planner->stats.field++)
+#define STATOPEN() (DS_OPEN.size > planner->stats.openMax ? (void)(planner->stats.openMax = DS_OPEN.size) : (void)0)
+#define STATCLOCK double statClock = DStarNow(), statNow
+#define STATPHASE(p) ((void)(statNow = DStarNow(), planner->stats.seconds[p] += statNow - statClock, statClock = statNow))
+#define STATRESET() memset(&planner->stats, 0, sizeof(planner->stats))
+#else
+#define STAT(field) ((void)0)
+#define STATOPEN() ((void)0)
+#define STATCLOCK
+#define STATPHASE(p) ((void)0)
+#define STATRESET() ((void)0)
+#endif
+
+// the callbacks that are counted.  The edges of a node are looked up by
+// the position of the neighbor where the storage allows it.
+#ifndef DS_COSTIN
+#define DS_COSTIN(n, i, m) DS_COST(n, m)
+#endif
+#ifndef DS_COSTOUT
+#define DS_COSTOUT(n, i, m) DS_COST(m, n)
+#endif
+#define HCALC(n) (STAT(hcalcs), DS_HCALC(n))
+#define COSTIN(n, i, m) (STAT(costs), DS_COSTIN(n, i, m))
+#define COSTOUT(n, i, m) (STAT(costs), DS_COSTOUT(n, i, m))
+
+// h of a node as it was last keyed is good while the epoch has not moved
+// on.  HUPDATE brings it up to date for a new key; HNOW only looks.
+#define HFRESH(n) (DS_STATE(n) != NEW && DS_HEPOCH(n) == planner->epoch)
+#define HUPDATE(n) (HFRESH(n) ? (void)0 : (void)(DS_H(n) = HCALC(n), DS_HEPOCH(n) = planner->epoch))
+#define HNOW(n) (HFRESH(n) ? DS_H(n) : HCALC(n))
+
+// the budget of the call is spent; the clock is only read every 32
+// expansions
+#define BUDGETSPENT() ((planner->budgetExpand > 0 && planner->expanded - planner->sliceStart >= planner->budgetExpand) || \
+		       (planner->deadline > 0.0 && ((planner->expanded - planner->sliceStart) & 31) == 0 && \
+			DStarNow() > planner->deadline))
+
+// The costs of the edges between the current node and neighbor i, cached
+// for one expansion.  COSTTO is DS_COST(current, neighbor[i]), the step the
+// robot would take from the neighbor to the current node, and is needed for
+// every neighbor that is not pruned.  COSTFROM is DS_COST(neighbor[i], current) and is only
+// looked up the first time it is needed; costs are never negative.
+#define COSTTO(i) (costTo[i])
+#define COSTFROM(i) (costFrom[i] >= 0.0 ? costFrom[i] : (costFrom[i] = COSTOUT(current, i, neighbor[i])))
+
+// a neighbor past the kept ones that is not a child of the current node
+#define PRUNED(i) ((i) >= numKept && DS_PARENT(neighbor[i]) != current)
+
+// a CLOSED neighbor of a RAISE node that already offers it a better path
+// than its own, so goes back on OPEN as a holding action
+#define REOPEN(i) ((DS_PARENT(neighbor[i]) != current) && (DS_G(current) > DS_G(neighbor[i]) + COSTFROM(i)) && \
+		   (DS_STATE(neighbor[i]) == CLOSED) && LESS(fold, kold, DS_F(neighbor[i]), DS_G(neighbor[i])))
+
+// This prints the OPEN list to the screen in expansion order
+static inline void DS_NAME(PrintOPEN)(DS_PLANNER * planner, char *name)
+{
+  DS_HEAPTYPE    *open = &DS_OPEN;
+  int64_t         i;
+
+  if (!(DS_CANPRINT))
+    return;
+
+  printf("Printing list %s\n", name);
+  DS_HEAPNAME(Sort)(open);
+  for (i = 0; i < open->size; i++)
+    DS_PRINT(open->entry[i].item);
+}
+
+// Puts newnode on OPEN with the g value newG, or re-keys it if it is already
+// there.  The caller must have reserved room in the heap.
+static inline void DS_NAME(InsertOPEN)(DS_PLANNER * planner, DS_NODE newnode, double newG)
+{
+
+  if (DS_STATE(newnode) == NEW) {	       // set the k value for this node
+
+    DS_K(newnode) = newG;
+    STAT(inserts);
+  }
+  else if (DS_STATE(newnode) == OPEN) {	       // node is on OPEN already
+
+    // update the k value if the new g value is lower
+    DS_K(newnode) = DS_K(newnode) < newG ? DS_K(newnode) : newG;
+    STAT(reinserts);
+  }
+  else {
+    // update the k value if the new G value is lower
+    DS_K(newnode) = DS_G(newnode) < newG ? DS_G(newnode) : newG;
+    STAT(reinserts);
+  }
+
+  // calculate OPEN sort key
+  DS_G(newnode) = newG;
+  HUPDATE(newnode);
+  DS_SETF(newnode);
+
+  // a node already on OPEN moves behind the nodes with an equal key, the
+  // same place a fresh insert would put it
+  if (DS_STATE(newnode) == OPEN) {
+    DS_HEAPNAME(Update)(&DS_OPEN, DS_OPENINDEX(newnode), BIASEDF(newnode), DS_K(newnode), planner->epoch);
+    return;
+  }
+
+  DS_STATE(newnode) = OPEN;
+  DS_HEAPNAME(Push)(&DS_OPEN, newnode, BIASEDF(newnode), DS_K(newnode), planner->epoch);
+  STATOPEN();
+}
+
+// Puts a NEW node on OPEN through from with the g value newG, or through a
+// CLOSED neighbor that offers less if pruning has stopped.  This uses the
+// second half of the neighbor buffer.
+static inline void DS_NAME(InsertNew)(DS_PLANNER * planner, DS_NODE n, DS_NODE from, double newG)
+{
+  DS_NODE        *succ = DS_NEIGHBORBUF + planner->params.maxNeighbors;
+  double          g;
+  int             numSucc, j;
+
+  if (planner->pruned && planner->raised) {
+    numSucc = DS_NEIGHBORS(n, succ);
+    for (j = 0; j < numSucc; j++) {
+      if (DS_STATE(succ[j]) == CLOSED && succ[j] != from && (g = DS_G(succ[j]) + COSTOUT(n, j, succ[j])) < newG) {
+	newG = g;
+	from = succ[j];
+      }
+    }
+  }
+
+  DS_SETPARENT(n, from);
+  DS_NAME(InsertOPEN)(planner, n, newG);
+}
+
+// Makes the current node the backpointer of neighbor n, with the g value
+// newG, and puts n on OPEN
+static inline void DS_NAME(Adopt)(DS_PLANNER * planner, DS_NODE n, DS_NODE current, double newG)
+{
+  if (DS_STATE(n) == NEW)
+    DS_NAME(InsertNew)(planner, n, current, newG);
+  else {
+    // set the back pointer
+    DS_SETPARENT(n, current);
+
+    // insert the neighbor into OPEN with the new g value
+    DS_NAME(InsertOPEN)(planner, n, newG);
+  }
+}
+
+// Empties OPEN; the nodes on it are left CLOSED.  With nothing on OPEN
+// the bias can start again from 0, and where the robot is is forgotten,
+// so no cached h is trusted after.
+static inline void DS_NAME(ClearOPEN)(DS_PLANNER * planner)
+{
+  DS_NODE         p;
+
+  while (DS_OPEN.size > 0) {
+    p = DS_HEAPNAME(Pop)(&DS_OPEN);
+    DS_STATE(p) = CLOSED;
+  }
+  planner->epoch++;
+  planner->robot = DS_NONE;
+  planner->bias = 0.0;
+  planner->moved = 0;
+}
+
+// The robot has moved away from the node from, and DS_HCALC now measures
+// from its new position: raise the bias by the distance moved, inflated
+// as the anytime engine inflates h
+static inline void DS_NAME(RobotMoved)(DS_PLANNER * planner, DS_NODE from)
+{
+  planner->bias += planner->epsilon * HCALC(from);
+  planner->epoch++;
+  planner->robot = DS_NONE;
+  planner->moved = 1;
+}
+
+// The robot is at node n.  If it was last seen somewhere else that counts
+// as a move; n is only remembered when the keys on OPEN are known to have
+// been computed for where the robot is now.  Where it was last seen may
+// not be known, so the cached h are dropped either way.
+static inline void DS_NAME(RobotAt)(DS_PLANNER * planner, DS_NODE n)
+{
+  if (planner->robot == n)
+    return;
+
+  if (planner->robot != DS_NONE)
+    DS_NAME(RobotMoved)(planner, planner->robot);
+  else
+    planner->epoch++;
+  if (planner->moved || DS_OPEN.size == 0)
+    planner->robot = n;
+}
+
+// Starts the budget of a call.  A search or replan also starts the count
+// of expansions and the statistics, which a resume carries on, so
+// maxExpand holds for a search and all of its resumes together.  One
+// that starts with OPEN empty, as every new search does, cannot tell
+// whether the robot moved since the h it cached, so it drops them.
+static inline void DS_NAME(StartCall)(DS_PLANNER * planner, int resume)
+{
+  if (!resume) {
+    planner->expanded = 0;
+    STATRESET();
+    if (DS_OPEN.size == 0)
+      planner->epoch++;
+  }
+  planner->sliceStart = planner->expanded;
+  planner->deadline = planner->budgetSeconds > 0.0 ? DStarNow() + planner->budgetSeconds : 0.0;
+}
+
+// Expands nodes until the robot node is reached, the search passes costR,
+// OPEN runs out or the budget is spent
+static inline int DS_NAME(Run)(DS_PLANNER * planner, double costR[2], DS_NODE * path)
+{
+  DS_HEAPTYPE    *open = &DS_OPEN;
+  DS_NODE        *neighbor = DS_NEIGHBORBUF;
+  double         *costTo = planner->edgeCost;
+  double         *costFrom = planner->edgeCost + planner->params.maxNeighbors;
+  DS_NODE         current;
+  double          kold;
+  double          fold;
+  int             numNeighbors, numKept;
+#ifdef DS_RELAX
+  int             numActs, j;
+#endif
+  int64_t         i;
+  STATCLOCK;
+
+  while (open->size > 0) {
+
+    // the smallest (f, k) is at the top of the heap (robot doesn't move while D* is running)
+    current = open->entry[0].item;
+
+    // a key from before the robot last moved is only a lower bound:
+    // re-key the node and look at the top again
+    if (open->entry[0].stamp != planner->epoch) {
+      STAT(rekeys);
+      HUPDATE(current);
+      DS_SETF(current);
+      DS_HEAPNAME(Update)(open, 0, BIASEDF(current), DS_K(current), planner->epoch);
+      continue;
+    }
+
+    // a query is done with its target once the target is CLOSED and
+    // everything on OPEN comes after it, as the robot's node is below
+    if (planner->target != DS_NONE && DS_STATE(planner->target) == CLOSED &&
+	!LESSEQ(open->entry[0].f, open->entry[0].k,
+		HNOW(planner->target) + DS_G(planner->target) + planner->bias, DS_G(planner->target))) {
+      STATPHASE(DSTAR_PHASE_EXPAND);
+      return (DSTAR_FOUND);
+    }
+
+    DS_HEAPNAME(Pop)(open);
+    planner->expanded++;
+
+    // kold = Get-KMIN()
+    kold = DS_K(current);
+    fold = DS_F(current);
+    DS_STATE(current) = CLOSED;
+
+    //printf("Current node: ");
+    //printNode(current);
+
+    if(DS_ROBOT(current)) {
+      planner->robot = current;
+      costR[0] = DS_H(current) + DS_G(current);
+      costR[1] = DS_G(current);
+    }
+
+    // is the current node the goal node?  A query goes past it.
+    if (planner->target == DS_NONE && DS_ROBOT(current) && DS_K(current) == DS_G(current)) { // robot node, and a LOWER node
+      // If so, return a pointer to the parent node
+      *path = DS_PARENT(current);
+
+      // the nodes left on OPEN stay there for the next call
+
+      // now return the path
+      STATPHASE(DSTAR_PHASE_EXPAND);
+      return (DSTAR_FOUND);
+    }
+
+    // has the search gone past where it needs to go?
+    if(planner->target == DS_NONE && !LESSEQ(fold, kold, costR[0], costR[1])) { // exit
+      STATPHASE(DSTAR_PHASE_EXPAND);
+      return(DSTAR_TERMINATED);
+    }
+
+    // a node that is LOWER as it comes off OPEN stays LOWER, and only
+    // needs the neighbors it can improve on
+    if (DS_CANPRUNE && !planner->raised && kold == DS_G(current)) {
+      numNeighbors = DS_PRUNE(current, DS_PARENT(current), neighbor, &numKept);
+      planner->pruned = 1;
+    }
+    else
+      numNeighbors = numKept = DS_NEIGHBORS(current, neighbor);
+
+    // every neighbor plus the current node may go onto OPEN below
+    if(DS_HEAPNAME(Reserve)(open, open->size + numNeighbors + 1) < 0) {
+      STATPHASE(DSTAR_PHASE_EXPAND);
+      return (DSTAR_NOMEM);
+    }
+
+    for (i = 0; i < numNeighbors; i++) {
+      costTo[i] = PRUNED(i) ? -1.0 : COSTIN(current, i, neighbor[i]);
+      costFrom[i] = -1.0;
+    }
+
+    // if kold < g(X) then
+    if (kold < DS_G(current)) {		       // check if any of the neighbors have a better path to the
+					       // goal
+
+      for (i = 0; i < numNeighbors; i++) {
+	if(DS_STATE(neighbor[i]) == CLOSED && !HFRESH(neighbor[i]))
+	  continue;
+
+	if ((DS_STATE(neighbor[i]) != NEW) && LESSEQ(DS_F(neighbor[i]), DS_G(neighbor[i]), fold, kold) &&
+	    (DS_G(current) > DS_G(neighbor[i]) + COSTFROM(i))) {
+
+	  // reset the back pointer to the better neighbor
+	  DS_SETPARENT(current, neighbor[i]);
+
+	  // calculate the new g value for the current node
+	  DS_G(current) = DS_G(neighbor[i]) + COSTFROM(i);
+	}
+      }
+    }
+
+    //printf("Node after neighbors: ");
+    //printNode(current);
+
+    if (kold == DS_G(current)) {	       // LOWER state
+
+      //printf("Lower state\n");
+      STAT(lower);
+
+#ifdef DS_RELAX
+      // the neighbors to update, tested all at once
+      numActs = DS_RELAX(current, neighbor, costTo, numNeighbors, numKept, 0, planner->relax);
+      for (j = 0; j < numActs; j++) {
+	i = planner->relax[j] >> 2;
+	DS_NAME(Adopt)(planner, neighbor[i], current, DS_G(current) + COSTTO(i));
+      }
+#ifdef DSTAR_STATS
+      for (i = numKept; i < numNeighbors; i++) {
+	if (PRUNED(i))
+	  STAT(pruned);
+      }
+#endif
+#else
+      for (i = 0; i < numNeighbors; i++) {
+	if (PRUNED(i)) {
+	  STAT(pruned);
+	  continue;
+	}
+
+	if ((DS_STATE(neighbor[i]) == NEW) ||
+	((DS_PARENT(neighbor[i]) == current) && (DS_G(neighbor[i]) != DS_G(current) + COSTTO(i))) ||
+	 ((DS_PARENT(neighbor[i]) != current) && (DS_G(neighbor[i]) > DS_G(current) + COSTTO(i)))) {
+
+	  // printf("Updated child cost\n");
+	  DS_NAME(Adopt)(planner, neighbor[i], current, DS_G(current) + COSTTO(i));
+	}
+      }
+#endif
+    }
+    else {				       // RAISE state
+
+      //printf("Raise state\n");
+      STAT(raise);
+      planner->raised = 1;
+
+#ifdef DS_RELAX
+      // the neighbors that need something done, tested all at once; the
+      // ones that may go back on OPEN are only looked at further here
+      numActs = DS_RELAX(current, neighbor, costTo, numNeighbors, numKept, 1, planner->relax);
+      for (j = 0; j < numActs; j++) {
+	i = planner->relax[j] >> 2;
+	switch (planner->relax[j] & 3) {
+	case DSTAR_RELAX_UPDATE:
+	  DS_NAME(Adopt)(planner, neighbor[i], current, DS_G(current) + COSTTO(i));
+	  break;
+	case DSTAR_RELAX_HOLD:
+	  STAT(holds);
+	  DS_NAME(InsertOPEN)(planner, current, DS_G(current));
+	  break;
+	default:
+	  if (REOPEN(i)) {
+	    STAT(holds);
+	    DS_NAME(InsertOPEN)(planner, neighbor[i], DS_G(neighbor[i]));
+	  }
+	}
+      }
+#else
+      for (i = 0; i < numNeighbors; i++) {
+
+	if ((DS_STATE(neighbor[i]) == NEW) ||
+	((DS_PARENT(neighbor[i]) == current) && (DS_G(neighbor[i]) != DS_G(current) + COSTTO(i)))) {
+
+	  //printf("inserted a neighbor with a new cost value\n");
+	  DS_NAME(Adopt)(planner, neighbor[i], current, DS_G(current) + COSTTO(i));
+	}
+	else {
+	  if ((DS_PARENT(neighbor[i]) != current) && (DS_G(neighbor[i]) > DS_G(current) + COSTTO(i))) {
+
+	    //printf("inserted self as a holding action\n");
+
+	    // insert the current node into OPEN as a holding action until its neighbors are optimal
+	    STAT(holds);
+	    DS_NAME(InsertOPEN)(planner, current, DS_G(current));
+	  }
+	  else if (REOPEN(i)) {
+
+	    //printf("inserted neighbor as a holding action\n");
+
+	    // re-insert this CLOSED node since it is not optimal but already provides a better path
+	    STAT(holds);
+	    DS_NAME(InsertOPEN)(planner, neighbor[i], DS_G(neighbor[i]));
+	  }
+	}
+      }
+#endif
+    }
+
+    // draw the current node in the map here
+    //drawArrow(current, current->parent);
+
+    // Test to see if we have expanded too many nodes without a solution
+    if (planner->params.maxExpand > 0 && planner->expanded > planner->params.maxExpand) {
+      // the partial search is thrown away
+      DS_NAME(ClearOPEN)(planner);
+
+      STATPHASE(DSTAR_PHASE_EXPAND);
+      return (DSTAR_LIMIT);
+    }
+
+    // out of budget: everything stays for Resume
+    if (BUDGETSPENT()) {
+      STATPHASE(DSTAR_PHASE_EXPAND);
+      return (DSTAR_UNFINISHED);
+    }
+  }					       // end of OPEN loop
+
+  // if we got here, then there is no path to the goal
+  STATPHASE(DSTAR_PHASE_EXPAND);
+  return (DSTAR_NOPATH);
+}
+
+/*
+ * Runs D* from whatever is on OPEN plus the initial nodes until the robot
+ * node is reached, the search passes costR, or OPEN runs out.
+ */
+static inline int DS_NAME(Search)(DS_PLANNER * planner,
+				DS_NODE const *initial,
+				int64_t numInitial,
+				double costR[2],  // (f = h + g, g) for the robot node, large values if never visited
+				DS_NODE * path)
+{
+
+  DS_HEAPTYPE    *open = &DS_OPEN;
+  DS_NODE         p;
+  int64_t         i, n;
+  STATCLOCK;
+
+  *path = DS_NONE;
+  DS_NAME(StartCall)(planner, 0);
+
+  if(open->size > 0) { // this is a recall of Dstar with new information
+
+    // if the robot has left the node it was last seen at, account for the
+    // move in the bias
+    if (planner->robot != DS_NONE && !DS_ROBOT(planner->robot))
+      DS_NAME(RobotMoved)(planner, planner->robot);
+  }
+
+  if(open->size > 0 && planner->robot == DS_NONE && !planner->moved) {
+    // where the robot was when these keys were computed is not known, so
+    // re-insert the old open list nodes in their current order so their h
+    // values are updated.  The array is sorted, so each push only writes to
+    // slots at or before the one being read.
+    planner->epoch++;
+    DS_HEAPNAME(Sort)(open);
+    n = open->size;
+    open->size = 0;
+    for(i = 0; i < n; i++) {
+      p = open->entry[i].item;
+      DS_STATE(p) = CLOSED;
+
+      DS_NAME(InsertOPEN)(planner, p, DS_K(p));
+    }
+  }
+
+  planner->moved = 0;
+  STATPHASE(DSTAR_PHASE_REKEY);
+
+  // put the initial nodes on the open list
+  if(DS_HEAPNAME(Reserve)(open, open->size + numInitial) < 0)
+    return (DSTAR_NOMEM);
+  for (i = 0; i < numInitial; i++)
+    DS_NAME(InsertOPEN)(planner, initial[i], DS_G(initial[i]));
+  STATPHASE(DSTAR_PHASE_SEED);
+
+  //DS_NAME(PrintOPEN)(planner, "OPEN");
+
+  return (DS_NAME(Run)(planner, costR, path));
+}
+
+// Goes on from where a call the budget stopped left off
+static inline int DS_NAME(Resume)(DS_PLANNER * planner, double costR[2], DS_NODE * path)
+{
+  *path = DS_NONE;
+  DS_NAME(StartCall)(planner, 1);
+
+  // a robot that has left the node it was last seen at raises the bias
+  if (planner->robot != DS_NONE && !DS_ROBOT(planner->robot))
+    DS_NAME(RobotMoved)(planner, planner->robot);
+  planner->moved = 0;
+
+  return (DS_NAME(Run)(planner, costR, path));
+}
+
+// D* Lite, on the same storage
+#include "dstarlite.h"
+
+// Writes the path from node n to its goal, n first, into path and gives
+// its length, or 0 if n has not been reached or its backpointers run into
+// a loop.  Only the first max nodes are written.  A loop is caught as
+// Brent does: the node the walk is compared with moves up to it at every
+// power of two steps, so the walk meets it within twice the loop's length
+// once inside, whatever kind of node the planner stores.
+static inline int64_t DS_NAME(Path)(DS_PLANNER * planner, DS_NODE n, DS_NODE * path, int64_t max)
+{
+  DS_NODE         mark = n;
+  int64_t         length = 0, power = 1;
+
+  if (DS_STATE(n) == NEW || DS_G(n) == HUGE_VAL)
+    return (0);
+
+  for (; n != DS_NONE; n = DS_PARENT(n)) {
+    if (length < max)
+      path[length] = n;
+    length++;
+    if (DS_PARENT(n) == mark)
+      return (0);
+    if (length == power) {
+      mark = n;
+      power *= 2;
+    }
+  }
+
+  return (length);
+}
+
+// Paths for many robots heading for the goals of the last search.  The
+// search goes on from where the last call left OPEN until every start
+// node is settled, then the path from each start goes into *path, one
+// after another: path i is (*path)[offset[i]] .. (*path)[offset[i+1] - 1].
+// *path holds *capacity nodes and is grown with realloc as needed.  The
+// paths are only written when the result is DSTAR_FOUND, or DSTAR_NOPATH
+// if some start has no path (its path is empty).
+static inline int DS_NAME(Query)(DS_PLANNER * planner, DS_NODE const *start, int64_t numStarts,
+				 DS_NODE ** path, size_t * capacity, int64_t * offset)
+{
+  double          costR[2] = {HUGE_VAL, HUGE_VAL};
+  DS_NODE         p;
+  DS_NODE        *grown;
+  size_t          total;
+  int64_t         i;
+  int             status = DSTAR_FOUND, found = 1;
+
+  DS_NAME(StartCall)(planner, 0);
+
+  // a robot that has left the node it was last seen at raises the bias
+  if (planner->robot != DS_NONE && !DS_ROBOT(planner->robot))
+    DS_NAME(RobotMoved)(planner, planner->robot);
+  planner->moved = 0;
+
+  // D* stopped at the robot's node without expanding it, so put it back
+  // for the paths that lead through it
+  if (planner->params.engine == DSTAR_ENGINE_DSTAR && planner->robot != DS_NONE &&
+      DS_STATE(planner->robot) == CLOSED) {
+    if (DS_HEAPNAME(Reserve)(&DS_OPEN, DS_OPEN.size + 1) < 0)
+      return (DSTAR_NOMEM);
+    DS_NAME(InsertOPEN)(planner, planner->robot, DS_G(planner->robot));
+  }
+
+  for (i = 0; i < numStarts && (status == DSTAR_FOUND || status == DSTAR_NOPATH); i++) {
+    planner->target = start[i];
+    if (planner->params.engine == DSTAR_ENGINE_DSTAR)
+      status = DS_NAME(Run)(planner, costR, &p);
+    else
+      status = DS_NAME(LiteRun)(planner, costR, &p);
+  }
+  planner->target = DS_NONE;
+  if (status != DSTAR_FOUND && status != DSTAR_NOPATH)
+    return (status);
+
+  // the lengths first, then the nodes
+  for (total = 0, i = 0; i < numStarts; i++) {
+    offset[i] = (int64_t) total;
+    total += DS_NAME(Path)(planner, start[i], NULL, 0);
+  }
+  offset[numStarts] = (int64_t) total;
+  if (total > *capacity) {
+    grown = (DS_NODE *) realloc(*path, sizeof(DS_NODE) * total);
+    if (grown == NULL)
+      return (DSTAR_NOMEM);
+    *path = grown;
+    *capacity = total;
+  }
+
+  for (i = 0; i < numStarts; i++) {
+    if (DS_NAME(Path)(planner, start[i], *path + offset[i], offset[i + 1] - offset[i]) == 0)
+      found = 0;
+  }
+
+  return (found ? DSTAR_FOUND : DSTAR_NOPATH);
+}
+
+#undef LESS
+#undef LESSEQ
+#undef BIASEDF
+#undef STAT
+#undef STATOPEN
+#undef STATCLOCK
+#undef STATPHASE
+#undef STATRESET
+#undef BUDGETSPENT
+#undef HCALC
+#undef HFRESH
+#undef HUPDATE
+#undef HNOW
+#undef COSTIN
+#undef COSTOUT
+#undef COSTTO
+#undef COSTFROM
+#undef PRUNED
+#undef REOPEN
+#undef DS_NAME
+#undef DS_PLANNER
+#undef DS_NODE
+#undef DS_NONE
+#undef DS_HEAPTYPE
+#undef DS_HEAPNAME
+#undef DS_OPEN
+#undef DS_NEIGHBORBUF
+#undef DS_STATE
+#undef DS_G
+#undef DS_K
+#undef DS_H
+#undef DS_HEPOCH
+#undef DS_OPENINDEX
+#undef DS_F
+#undef DS_SETF
+#undef DS_PARENT
+#undef DS_SETPARENT
+#undef DS_HCALC
+#undef DS_ROBOT
+#undef DS_NEIGHBORS
+#undef DS_COST
+#undef DS_COSTIN
+#undef DS_COSTOUT
+#undef DS_CANPRUNE
+#undef DS_PRUNE
+#undef DS_CANPRINT
+#undef DS_PRINT
+#undef DS_RELAX
@@ -0,0 +1,676 @@
+/*
+  A D* index planner whose graph, cost, heuristic and queue are fixed at
+  compile time.
+
+  DStarPlannerCreateIndex reaches the graph through function pointers, so
+  every expansion makes a dozen or more indirect calls the compiler cannot
+  inline.  Including this file instead generates a planner of its own with
+  the same incremental semantics and the same compact node arrays, where
+  each policy is a macro expanded straight into the search loop.  dstar.c
+  builds DStarPlannerCreateIndex from it, with the callbacks as policies.
+
+  Define the following, then include it:
+
+    DSI_NAME(x)                  prefixes the generated type and functions,
+                                 e.g. grid##x
+    DSI_DATA                     type of the context handed to the policies
+    DSI_NEIGHBORS(data, n, buf)  Graph: writes the neighbors of node n to
+                                 the int64_t array buf and gives their number
+    DSI_COST(data, to, from)     Cost: cost of the edge between two nodes
+    DSI_COSTIN(data, n, i, m), DSI_COSTOUT(data, n, i, m)
+                                 optional, DSI_COST(data, n, m) and
+                                 DSI_COST(data, m, n) for m the i-th
+                                 neighbor DSI_NEIGHBORS gives n, so a graph
+                                 that keeps the costs of each node's edges
+                                 beside its neighbors reads them by
+                                 position; not with DSI_PRUNE
+    DSI_HCALC(data, n)           Heuristic: h of node n
+    DSI_ROBOT(data, n)           true if node n is the robot's
+    DSI_ARITY                    Queue: branching factor of the OPEN heap,
+                                 2 or 4 (default 4)
+    DSI_PRUNE(data, n, p, buf, kept)
+                                 optional, the neighbors of n reached from
+                                 p with the *kept first that a path through
+                                 n can improve on, as pruneNeighbors in
+                                 dstar.h
+    DSI_CANPRUNE(data)           optional, true if DSI_PRUNE may be called
+    DSI_PRINT(data, node)        optional, prints a copy of a node (Node *)
+    DSI_CANPRINT(data)           optional, true if DSI_PRINT may be called
+
+  data is the DSI_DATA pointer given to the create call.  The generated
+  calls match the DStarPlanner*Index calls:
+
+    DSI_NAME(Planner)                  the planner type
+    DSI_NAME(PlannerCreate)(data, numNodes, params)
+    DSI_NAME(PlannerDestroy)(planner)
+    DSI_NAME(PlannerSearch)(planner, goal, numGoals, costR, path)
+    DSI_NAME(PlannerReplan)(planner, changed, numChanged, costR, path)
+    DSI_NAME(PlannerBudget)(planner, expansions, microseconds)
+    DSI_NAME(PlannerResume)(planner, costR, path)
+    DSI_NAME(PlannerImprove)(planner, costR, path)
+    DSI_NAME(PlannerBound)(planner)
+    DSI_NAME(PlannerQuery)(planner, start, numStarts, path, capacity, offset)
+    DSI_NAME(PlannerRobotMoved)(planner, from)
+    DSI_NAME(PlannerRobotAt)(planner, robot)
+    DSI_NAME(PlannerNode)(planner, id, node)
+    DSI_NAME(PlannerParent)(planner, id)
+    DSI_NAME(PlannerExpanded)(planner)
+    DSI_NAME(PlannerStats)(planner, stats)
+    DSI_NAME(PrintOPEN)(planner, name)
+    DSI_NAME(PlannerBytes)(planner)
+    DSI_NAME(PlannerSave)(planner, fp)
+    DSI_NAME(PlannerLoad)(data, path)
+
+  The D* expansions test their neighbors all at once with DStarRelax of
+  dstarrelax.h, four at a time with AVX2 if DSTAR_SIMD is 1, so
+  DSI_NEIGHBORS must not list a node twice.
+
+  params->engine picks D*, D* Lite or Anytime D* when the planner is
+  created.  It can
+  be included several times with different definitions.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "dstar.h"
+#include "dstarrelax.h"
+
+#ifndef DSTAR_NOPARENT
+#define DSTAR_NOPARENT 0xffffffffu
+#endif
+
+// OPEN, with the heap positions in an array of the planner's
+#define DHEAP_TYPE DSI_NAME(Heap)
+#define DHEAP_ENTRY DSI_NAME(HeapEntry)
+#define DHEAP_NAME(x) DSI_NAME(Heap##x)
+#define DHEAP_ITEM int64_t
+#define DHEAP_FIELDS uint32_t *pos;
+#define DHEAP_POS(n) (heap->pos[n])
+#ifdef DSI_ARITY
+#define DHEAP_ARITY DSI_ARITY
+#endif
+#include "dheap.h"
+
+// The nodes are kept one array per field.  The parent is a 32-bit index,
+// f is always k + h so it is not stored, and coordinates are left to the
+// policies to derive from the index.
+typedef struct {
+  DSI_DATA       *data;
+  DStarParams     params;
+  int64_t         expanded;		       // expansions in the current call
+  DStarStats      stats;		       // of the current call, with DSTAR_STATS
+  int64_t         numNodes;
+  double         *g;
+  double         *k;
+  double         *h;
+  uint32_t       *parent;		       // DSTAR_NOPARENT if none
+  unsigned char  *state;
+  uint32_t       *hEpoch;		       // epoch each h was computed in
+  DSI_NAME(Heap)  open;			       // OPEN, carried over between calls
+  int64_t        *neighbor;		       // 2 * params.maxNeighbors entries
+  double         *edgeCost;		       // both costs of each neighbor edge
+  int            *relax;		       // params.maxNeighbors actions of DStarRelax
+  int             relaxAVX2;		       // DStarRelaxSelect of the planner's creation
+  int64_t         robot;		       // where the robot was last seen, -1 if not known
+  double          bias;			       // distance the robot has moved, in h units
+  uint32_t        epoch;		       // advances each time the robot moves
+  int             moved;		       // the bias was raised since the last call
+  int64_t         budgetExpand;		       // expansions allowed per call, 0 for any
+  double          budgetSeconds;	       // time allowed per call, 0 for any
+  double          deadline;		       // end of the current call's time, 0 for none
+  int64_t         sliceStart;		       // expanded when the current call began
+  double          epsilon;		       // heuristic inflation of the current pass
+  double          bound;		       // epsilon of the last path found
+  int64_t        *passList;		       // nodes expanded in this anytime pass
+  int64_t         passSize;
+  int64_t         passCapacity;
+  int64_t         target;		       // start being settled by a query, -1 if none
+  int             pruned;		       // neighbors were pruned since the last new search
+  int             raised;		       // no neighbor pruning until the next new search
+  void           *mapping;		       // snapshot the node arrays lie in, NULL if malloc'd
+  size_t          mappingBytes;
+} DSI_NAME(Planner);
+
+static inline void DSI_NAME(PlannerNode)(const DSI_NAME(Planner) * planner, int64_t id, Node * node)
+{
+  node->id = id;
+  node->state = planner->state[id];
+  node->g = planner->g[id];
+  node->h = planner->h[id];
+  node->hEpoch = planner->hEpoch[id];
+  node->k = planner->k[id];
+  node->f = node->k + node->h;
+  node->parent = NULL;
+  node->openIndex = planner->state[id] == OPEN ? (int64_t) planner->open.pos[id] : -1;
+  node->nodeInfo = NULL;
+}
+
+#ifdef DSI_PRINT
+// the print policy gets a copy of the node
+static inline void DSI_NAME(PrintNode)(DSI_NAME(Planner) * planner, int64_t id)
+{
+  Node            node;
+
+  DSI_NAME(PlannerNode)(planner, id, &node);
+  DSI_PRINT(planner->data, &node);
+}
+#endif
+
+#define DS_NAME(x) DSI_NAME(x)
+#define DS_PLANNER DSI_NAME(Planner)
+#define DS_NODE int64_t
+#define DS_NONE ((int64_t)-1)
+#define DS_HEAPTYPE DSI_NAME(Heap)
+#define DS_HEAPNAME(x) DSI_NAME(Heap##x)
+#define DS_OPEN (planner->open)
+#define DS_NEIGHBORBUF (planner->neighbor)
+#define DS_STATE(n) (planner->state[n])
+#define DS_G(n) (planner->g[n])
+#define DS_K(n) (planner->k[n])
+#define DS_H(n) (planner->h[n])
+#define DS_HEPOCH(n) (planner->hEpoch[n])
+#define DS_OPENINDEX(n) (planner->open.pos[n])
+#define DS_F(n) (planner->k[n] + planner->h[n])
+#define DS_SETF(n) ((void)0)
+#define DS_PARENT(n) (planner->parent[n] == DSTAR_NOPARENT ? DS_NONE : (int64_t)planner->parent[n])
+#define DS_SETPARENT(n, p) (planner->parent[n] = (uint32_t)(p))
+#define DS_HCALC(n) DSI_HCALC(planner->data, (n))
+#define DS_ROBOT(n) DSI_ROBOT(planner->data, (n))
+#define DS_NEIGHBORS(n, buf) DSI_NEIGHBORS(planner->data, (n), (buf))
+#define DS_COST(to, from) DSI_COST(planner->data, (to), (from))
+#ifdef DSI_COSTIN
+#ifdef DSI_PRUNE
+#error DSI_COSTIN and DSI_COSTOUT need the neighbors in the order DSI_NEIGHBORS gives them
+#endif
+#define DS_COSTIN(n, i, m) DSI_COSTIN(planner->data, (n), (i), (m))
+#define DS_COSTOUT(n, i, m) DSI_COSTOUT(planner->data, (n), (i), (m))
+#endif
+#ifdef DSI_PRUNE
+#ifdef DSI_CANPRUNE
+#define DS_CANPRUNE DSI_CANPRUNE(planner->data)
+#else
+#define DS_CANPRUNE 1
+#endif
+#define DS_PRUNE(n, p, buf, kept) DSI_PRUNE(planner->data, (n), (p), (buf), (kept))
+#else
+#define DS_CANPRUNE 0
+#define DS_PRUNE(n, p, buf, kept) (*(kept) = DS_NEIGHBORS((n), (buf)))
+#endif
+#ifdef DSI_PRINT
+#ifdef DSI_CANPRINT
+#define DS_CANPRINT DSI_CANPRINT(planner->data)
+#else
+#define DS_CANPRINT 1
+#endif
+#define DS_PRINT(n) DSI_NAME(PrintNode)(planner, (n))
+#else
+#define DS_CANPRINT 0
+#define DS_PRINT(n) ((void)0)
+#endif
+#define DS_RELAX(current, neighbor, cost, num, numKept, raise, act)				\
+  DStarRelax(planner->relaxAVX2, planner->g, planner->state, planner->parent, (neighbor), (cost),	\
+	     (num), (numKept), (uint32_t) (current), planner->g[current], (raise), (act))
+#include "dstarcore.h"
+
+static inline void DSI_NAME(PlannerDestroy)(DSI_NAME(Planner) * planner)
+{
+  if (planner == NULL)
+    return;
+
+  free(planner->open.pos);
+  DSI_NAME(HeapFree)(&planner->open);
+  if (planner->mapping != NULL)
+    munmap(planner->mapping, planner->mappingBytes);
+  else {
+    free(planner->g);
+    free(planner->k);
+    free(planner->h);
+    free(planner->parent);
+    free(planner->state);
+    free(planner->hEpoch);
+  }
+  free(planner->neighbor);
+  free(planner->edgeCost);
+  free(planner->relax);
+  free(planner->passList);
+  free(planner);
+}
+
+// numNodes must be below 2^32 - 1 so parents fit in 32 bits; params may be
+// NULL for the defaults
+static inline DSI_NAME(Planner) *DSI_NAME(PlannerCreate)(DSI_DATA * data, int64_t numNodes,
+							  const DStarParams * params)
+{
+  DSI_NAME(Planner) *planner;
+
+  // the top index is DSTAR_NOPARENT
+  if (numNodes <= 0 || numNodes >= (int64_t) DSTAR_NOPARENT)
+    return (NULL);
+
+  planner = (DSI_NAME(Planner) *) calloc(1, sizeof(DSI_NAME(Planner)));
+  if (planner == NULL)
+    return (NULL);
+
+  if (params != NULL)
+    planner->params = *params;
+  else
+    DStarParamsDefaults(&planner->params);
+  planner->data = data;
+  planner->numNodes = numNodes;
+  planner->robot = -1;
+  planner->target = -1;
+  planner->epsilon = 1.0;
+  planner->bound = 1.0;
+  DSI_NAME(HeapInit)(&planner->open);
+
+  planner->g = (double *) malloc(sizeof(double) * numNodes);
+  planner->k = (double *) malloc(sizeof(double) * numNodes);
+  planner->h = (double *) malloc(sizeof(double) * numNodes);
+  planner->parent = (uint32_t *) malloc(sizeof(uint32_t) * numNodes);
+  planner->state = (unsigned char *) malloc(numNodes);
+  planner->hEpoch = (uint32_t *) malloc(sizeof(uint32_t) * numNodes);
+  planner->open.pos = (uint32_t *) malloc(sizeof(uint32_t) * numNodes);
+  planner->neighbor = (int64_t *) malloc(sizeof(int64_t) * 2 * planner->params.maxNeighbors);
+  planner->edgeCost = (double *) malloc(sizeof(double) * 2 * planner->params.maxNeighbors);
+  planner->relax = (int *) malloc(sizeof(int) * planner->params.maxNeighbors);
+  planner->relaxAVX2 = DStarRelaxSelect();
+
+  if (planner->g == NULL || planner->k == NULL || planner->h == NULL || planner->parent == NULL ||
+      planner->state == NULL || planner->hEpoch == NULL || planner->open.pos == NULL || planner->neighbor == NULL ||
+      planner->edgeCost == NULL || planner->relax == NULL) {
+    DSI_NAME(PlannerDestroy)(planner);
+    return (NULL);
+  }
+
+  memset(planner->state, NEW, numNodes);
+  memset(planner->parent, 0xff, sizeof(uint32_t) * numNodes);
+
+  return (planner);
+}
+
+// a new search forgets every node, then starts from the goals with g = 0;
+// *path is -1 if there is none
+static inline int DSI_NAME(PlannerSearch)(DSI_NAME(Planner) * planner, const int64_t * goal, int64_t numGoals,
+					  double costR[2], int64_t * path)
+{
+  int64_t         i;
+
+  planner->open.size = 0;
+  planner->robot = -1;
+  planner->bias = 0.0;
+  planner->moved = 0;
+  planner->pruned = 0;
+  planner->raised = 0;
+  memset(planner->state, NEW, planner->numNodes);
+  memset(planner->parent, 0xff, sizeof(uint32_t) * planner->numNodes);
+
+  for (i = 0; i < numGoals; i++)
+    planner->g[goal[i]] = 0.0;
+
+  if (planner->params.engine != DSTAR_ENGINE_DSTAR)
+    return (DSI_NAME(LiteSearch)(planner, goal, numGoals, costR, path));
+
+  return (DSI_NAME(Search)(planner, goal, numGoals, costR, path));
+}
+
+// continue after costs changed or the robot moved; changed nodes go on OPEN
+// next to whatever the last call left there
+static inline int DSI_NAME(PlannerReplan)(DSI_NAME(Planner) * planner, const int64_t * changed, int64_t numChanged,
+					  double costR[2], int64_t * path)
+{
+  if (planner->params.engine != DSTAR_ENGINE_DSTAR)
+    return (DSI_NAME(LiteReplan)(planner, changed, numChanged, costR, path));
+
+  return (DSI_NAME(Search)(planner, changed, numChanged, costR, path));
+}
+
+// the budget of each later call; 0 is no limit for either
+static inline void DSI_NAME(PlannerBudget)(DSI_NAME(Planner) * planner, int64_t expansions, int64_t microseconds)
+{
+  planner->budgetExpand = expansions;
+  planner->budgetSeconds = 1e-6 * microseconds;
+}
+
+// go on from where a call that returned DSTAR_UNFINISHED stopped
+static inline int DSI_NAME(PlannerResume)(DSI_NAME(Planner) * planner, double costR[2], int64_t * path)
+{
+  if (planner->params.engine != DSTAR_ENGINE_DSTAR)
+    return (DSI_NAME(LiteResume)(planner, costR, path));
+
+  return (DSI_NAME(Resume)(planner, costR, path));
+}
+
+// Anytime D*: lower epsilon a step and improve the path; for the other
+// engines a replan with nothing changed
+static inline int DSI_NAME(PlannerImprove)(DSI_NAME(Planner) * planner, double costR[2], int64_t * path)
+{
+  if (planner->params.engine != DSTAR_ENGINE_DSTAR)
+    return (DSI_NAME(LiteImprove)(planner, costR, path));
+
+  return (DSI_NAME(Search)(planner, NULL, 0, costR, path));
+}
+
+// paths from many start nodes to the goals of the last search, one after
+// another in *path; path i runs from offset[i] to offset[i+1] - 1
+static inline int DSI_NAME(PlannerQuery)(DSI_NAME(Planner) * planner, const int64_t * start, int64_t numStarts,
+					 int64_t ** path, size_t * capacity, int64_t * offset)
+{
+  return (DSI_NAME(Query)(planner, start, numStarts, path, capacity, offset));
+}
+
+// the last path found costs at most this times the optimal
+static inline double DSI_NAME(PlannerBound)(const DSI_NAME(Planner) * planner)
+{
+  return (planner->bound);
+}
+
+// tell the planner the robot has moved away from node from, once the
+// heuristic measures from its new position.  The keys on OPEN are then
+// updated as they are needed rather than all at the next replan.
+static inline void DSI_NAME(PlannerRobotMoved)(DSI_NAME(Planner) * planner, int64_t from)
+{
+  DSI_NAME(RobotMoved)(planner, from);
+}
+
+// tell the planner which node the robot is at; a different node than last
+// time counts as a move
+static inline void DSI_NAME(PlannerRobotAt)(DSI_NAME(Planner) * planner, int64_t robot)
+{
+  DSI_NAME(RobotAt)(planner, robot);
+}
+
+// backpointer of a node, -1 if it has none
+static inline int64_t DSI_NAME(PlannerParent)(const DSI_NAME(Planner) * planner, int64_t id)
+{
+  uint32_t        parent = planner->parent[id];
+
+  return (parent == DSTAR_NOPARENT ? -1 : (int64_t) parent);
+}
+
+static inline int64_t DSI_NAME(PlannerExpanded)(const DSI_NAME(Planner) * planner)
+{
+  return (planner->expanded);
+}
+
+// what the last call did; -1 if only expanded is counted
+static inline int DSI_NAME(PlannerStats)(const DSI_NAME(Planner) * planner, DStarStats * stats)
+{
+  *stats = planner->stats;
+  stats->expanded = planner->expanded;
+#ifdef DSTAR_STATS
+  return (0);
+#else
+  return (-1);
+#endif
+}
+
+// memory owned by the planner, node arrays included
+static inline size_t DSI_NAME(PlannerBytes)(const DSI_NAME(Planner) * planner)
+{
+  size_t          bytes = sizeof(DSI_NAME(Planner));
+
+  bytes += (3 * sizeof(double) + 3 * sizeof(uint32_t) + 1) * planner->numNodes;
+  bytes += sizeof(DSI_NAME(HeapEntry)) * planner->open.capacity;
+  bytes += (2 * (sizeof(int64_t) + sizeof(double)) + sizeof(int)) * planner->params.maxNeighbors;
+  bytes += sizeof(int64_t) * planner->passCapacity;
+
+  return (bytes);
+}
+
+// bytes of each section of a snapshot, and where they go after the
+// header, each at a multiple of 64; gives the size of the file
+static inline uint64_t DSI_NAME(SnapshotLayout)(const DStarSnapshotHeader * header, uint64_t * bytes, uint64_t * offset)
+{
+  uint64_t        at;
+  int             i;
+
+  bytes[DSTAR_SNAPSHOT_G] = sizeof(double) * header->numNodes;
+  bytes[DSTAR_SNAPSHOT_K] = sizeof(double) * header->numNodes;
+  bytes[DSTAR_SNAPSHOT_H] = sizeof(double) * header->numNodes;
+  bytes[DSTAR_SNAPSHOT_PARENT] = sizeof(uint32_t) * header->numNodes;
+  bytes[DSTAR_SNAPSHOT_STATE] = header->numNodes;
+  bytes[DSTAR_SNAPSHOT_HEPOCH] = sizeof(uint32_t) * header->numNodes;
+  bytes[DSTAR_SNAPSHOT_OPEN] = sizeof(DSI_NAME(HeapEntry)) * header->openSize;
+  bytes[DSTAR_SNAPSHOT_PASS] = sizeof(int64_t) * header->passSize;
+
+  at = (sizeof(DStarSnapshotHeader) + 63) & ~(uint64_t) 63;
+  for (i = 0; i < DSTAR_SNAPSHOT_SECTIONS; i++) {
+    offset[i] = at;
+    at = (at + bytes[i] + 63) & ~(uint64_t) 63;
+  }
+
+  return (at);
+}
+
+// write the whole state of the planner to fp as a snapshot (see dstar.h);
+// -1 if a write failed
+static inline int DSI_NAME(PlannerSave)(const DSI_NAME(Planner) * planner, FILE * fp)
+{
+  static const char zero[64];
+  DStarSnapshotHeader header;
+  uint64_t        bytes[DSTAR_SNAPSHOT_SECTIONS], at, end;
+  const void     *section[DSTAR_SNAPSHOT_SECTIONS];
+  int             i;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, DSTAR_SNAPSHOT_MAGIC, sizeof(DSTAR_SNAPSHOT_MAGIC));
+  header.order = DSTAR_SNAPSHOT_ORDER;
+  header.version = DSTAR_SNAPSHOT_VERSION;
+  header.numNodes = planner->numNodes;
+  header.maxExpand = planner->params.maxExpand;
+  header.maxNeighbors = planner->params.maxNeighbors;
+  header.engine = planner->params.engine;
+  header.paramEpsilon = planner->params.epsilon;
+  header.epsilonStep = planner->params.epsilonStep;
+  header.robot = planner->robot;
+  header.target = planner->target;
+  header.expanded = planner->expanded;
+  header.sliceStart = planner->sliceStart;
+  header.bias = planner->bias;
+  header.epsilon = planner->epsilon;
+  header.bound = planner->bound;
+  header.epoch = planner->epoch;
+  header.moved = planner->moved;
+  header.pruned = planner->pruned;
+  header.raised = planner->raised;
+  header.openSize = planner->open.size;
+  header.openSeq = planner->open.seq;
+  header.openEntryBytes = sizeof(DSI_NAME(HeapEntry));
+  header.passSize = planner->passSize;
+  end = DSI_NAME(SnapshotLayout)(&header, bytes, header.offset);
+
+  section[DSTAR_SNAPSHOT_G] = planner->g;
+  section[DSTAR_SNAPSHOT_K] = planner->k;
+  section[DSTAR_SNAPSHOT_H] = planner->h;
+  section[DSTAR_SNAPSHOT_PARENT] = planner->parent;
+  section[DSTAR_SNAPSHOT_STATE] = planner->state;
+  section[DSTAR_SNAPSHOT_HEPOCH] = planner->hEpoch;
+  section[DSTAR_SNAPSHOT_OPEN] = planner->open.entry;
+  section[DSTAR_SNAPSHOT_PASS] = planner->passList;
+
+  if (fwrite(&header, sizeof(header), 1, fp) != 1)
+    return (-1);
+  at = sizeof(header);
+  for (i = 0; i < DSTAR_SNAPSHOT_SECTIONS; i++) {
+    // the padding up to each section is less than 64 bytes
+    if (fwrite(zero, 1, header.offset[i] - at, fp) != header.offset[i] - at)
+      return (-1);
+    if (bytes[i] > 0 && fwrite(section[i], 1, bytes[i], fp) != bytes[i])
+      return (-1);
+    at = header.offset[i] + bytes[i];
+  }
+  if (fwrite(zero, 1, end - at, fp) != end - at)
+    return (-1);
+
+  return (fflush(fp) == 0 ? 0 : -1);
+}
+
+// A planner with the state of the snapshot at path.  The node arrays are
+// left where they lie in a copy-on-write mapping of the file; OPEN and the
+// anytime pass are copied, since they grow.  NULL with errno set if the
+// file cannot be used.
+static inline DSI_NAME(Planner) *DSI_NAME(PlannerLoad)(DSI_DATA * data, const char *path)
+{
+  DSI_NAME(Planner) *planner;
+  DStarSnapshotHeader header;
+  uint64_t        bytes[DSTAR_SNAPSHOT_SECTIONS], offset[DSTAR_SNAPSHOT_SECTIONS];
+  struct stat     st;
+  void           *base;
+  int64_t         i, item, numOpen;
+  int             fd, saved, valid;
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return (NULL);
+  if (fstat(fd, &st) < 0 || read(fd, &header, sizeof(header)) != (ssize_t) sizeof(header)) {
+    saved = errno;
+    close(fd);
+    errno = saved == 0 ? EINVAL : saved;
+    return (NULL);
+  }
+
+  valid = memcmp(header.magic, DSTAR_SNAPSHOT_MAGIC, sizeof(DSTAR_SNAPSHOT_MAGIC)) == 0 &&
+    header.order == DSTAR_SNAPSHOT_ORDER && header.version == DSTAR_SNAPSHOT_VERSION &&
+    header.numNodes > 0 && header.numNodes < (int64_t) DSTAR_NOPARENT &&
+    header.openSize >= 0 && header.openSize <= header.numNodes &&
+    header.passSize >= 0 && header.passSize <= st.st_size &&
+    header.openEntryBytes == sizeof(DSI_NAME(HeapEntry)) && header.maxNeighbors > 0 &&
+    header.maxNeighbors <= INT_MAX / 16 && header.maxNeighbors <= header.numNodes + MAXNEIGHBORS &&
+    header.engine >= DSTAR_ENGINE_DSTAR && header.engine <= DSTAR_ENGINE_ANYTIME &&
+    header.robot >= -1 && header.robot < header.numNodes &&
+    header.target >= -1 && header.target < header.numNodes;
+  if (valid) {
+    DSI_NAME(SnapshotLayout)(&header, bytes, offset);
+    for (i = 0; i < DSTAR_SNAPSHOT_SECTIONS; i++)
+      valid = valid && header.offset[i] == offset[i] && offset[i] + bytes[i] <= (uint64_t) st.st_size;
+  }
+  if (!valid) {
+    close(fd);
+    errno = EINVAL;
+    return (NULL);
+  }
+
+  base = mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  saved = errno;
+  close(fd);
+  if (base == MAP_FAILED) {
+    errno = saved;
+    return (NULL);
+  }
+
+  planner = (DSI_NAME(Planner) *) calloc(1, sizeof(DSI_NAME(Planner)));
+  if (planner == NULL) {
+    munmap(base, (size_t) st.st_size);
+    errno = ENOMEM;
+    return (NULL);
+  }
+  planner->mapping = base;
+  planner->mappingBytes = (size_t) st.st_size;
+  planner->g = (double *) ((char *) base + offset[DSTAR_SNAPSHOT_G]);
+  planner->k = (double *) ((char *) base + offset[DSTAR_SNAPSHOT_K]);
+  planner->h = (double *) ((char *) base + offset[DSTAR_SNAPSHOT_H]);
+  planner->parent = (uint32_t *) ((char *) base + offset[DSTAR_SNAPSHOT_PARENT]);
+  planner->state = (unsigned char *) base + offset[DSTAR_SNAPSHOT_STATE];
+  planner->hEpoch = (uint32_t *) ((char *) base + offset[DSTAR_SNAPSHOT_HEPOCH]);
+
+  planner->data = data;
+  planner->numNodes = header.numNodes;
+  planner->params.maxExpand = header.maxExpand;
+  planner->params.maxNeighbors = (int) header.maxNeighbors;
+  planner->params.engine = (int) header.engine;
+  planner->params.epsilon = header.paramEpsilon;
+  planner->params.epsilonStep = header.epsilonStep;
+  planner->robot = header.robot;
+  planner->target = header.target;
+  planner->expanded = header.expanded;
+  planner->sliceStart = header.sliceStart;
+  planner->bias = header.bias;
+  planner->epsilon = header.epsilon;
+  planner->bound = header.bound;
+  planner->epoch = (uint32_t) header.epoch;
+  planner->moved = (int) header.moved;
+  planner->pruned = (int) header.pruned;
+  planner->raised = (int) header.raised;
+  DSI_NAME(HeapInit)(&planner->open);
+
+  planner->open.pos = (uint32_t *) malloc(sizeof(uint32_t) * header.numNodes);
+  planner->neighbor = (int64_t *) malloc(sizeof(int64_t) * 2 * planner->params.maxNeighbors);
+  planner->edgeCost = (double *) malloc(sizeof(double) * 2 * planner->params.maxNeighbors);
+  planner->relax = (int *) malloc(sizeof(int) * planner->params.maxNeighbors);
+  planner->relaxAVX2 = DStarRelaxSelect();
+  if (header.passSize > 0)
+    planner->passList = (int64_t *) malloc(bytes[DSTAR_SNAPSHOT_PASS]);
+  if (planner->open.pos == NULL || planner->neighbor == NULL || planner->edgeCost == NULL ||
+      planner->relax == NULL ||
+      (header.passSize > 0 && planner->passList == NULL) ||
+      DSI_NAME(HeapReserve)(&planner->open, header.openSize) < 0) {
+    DSI_NAME(PlannerDestroy)(planner);
+    errno = ENOMEM;
+    return (NULL);
+  }
+
+  // the heap positions are not saved; each entry knows its node, which
+  // must be OPEN and on the heap only once, or the first update of it
+  // would move the wrong entry
+  if (header.openSize > 0)
+    memcpy(planner->open.entry, (char *) base + offset[DSTAR_SNAPSHOT_OPEN], bytes[DSTAR_SNAPSHOT_OPEN]);
+  planner->open.size = header.openSize;
+  planner->open.seq = header.openSeq;
+  memset(planner->open.pos, 0xff, sizeof(uint32_t) * header.numNodes);
+  for (i = 0; i < header.openSize; i++) {
+    item = planner->open.entry[i].item;
+    if (item < 0 || item >= header.numNodes || planner->state[item] != OPEN || planner->open.pos[item] != UINT32_MAX) {
+      DSI_NAME(PlannerDestroy)(planner);
+      errno = EINVAL;
+      return (NULL);
+    }
+    planner->open.pos[item] = (uint32_t) i;
+  }
+
+  if (header.passSize > 0)
+    memcpy(planner->passList, (char *) base + offset[DSTAR_SNAPSHOT_PASS], bytes[DSTAR_SNAPSHOT_PASS]);
+  planner->passSize = planner->passCapacity = header.passSize;
+
+  // the parents are walked and the pass is expanded again, so every node
+  // they name must be one of ours.  Every state is one the engine uses,
+  // and each OPEN node is on the heap, which holds none but them.
+  valid = 1;
+  numOpen = 0;
+  for (i = 0; i < header.numNodes && valid; i++) {
+    valid = (planner->parent[i] < (uint32_t) header.numNodes || planner->parent[i] == DSTAR_NOPARENT) &&
+      (planner->state[i] <= CLOSED || (planner->state[i] <= INCONS && planner->params.engine != DSTAR_ENGINE_DSTAR));
+    numOpen += planner->state[i] == OPEN;
+  }
+  valid = valid && numOpen == header.openSize;
+  for (i = 0; i < header.passSize && valid; i++)
+    valid = planner->passList[i] >= 0 && planner->passList[i] < header.numNodes;
+  if (!valid) {
+    DSI_NAME(PlannerDestroy)(planner);
+    errno = EINVAL;
+    return (NULL);
+  }
+
+  return (planner);
+}
+
+#undef DSI_NAME
+#undef DSI_DATA
+#undef DSI_NEIGHBORS
+#undef DSI_COST
+#undef DSI_COSTIN
+#undef DSI_COSTOUT
+#undef DSI_HCALC
+#undef DSI_ROBOT
+#undef DSI_ARITY
+#undef DSI_PRUNE
+#undef DSI_CANPRUNE
+#undef DSI_PRINT
+#undef DSI_CANPRINT
@@ -0,0 +1,462 @@
+/*
+  D* Lite (Koenig and Likhachev), the second search engine.
+
+  dstarcore.h includes this file while its DS_* macros are still defined,
+  so D* Lite runs on exactly the node storage, callbacks and OPEN heap of
+  the D* search, and generates DS_NAME(LiteSearch), DS_NAME(LiteReplan),
+  DS_NAME(LiteResume) and DS_NAME(LiteImprove).
+
+  The search runs from the goals toward the robot, as D* does.  g is the
+  cost to the goal and the k field holds rhs, the one-step lookahead of g.
+  OPEN is keyed on (min(g, rhs) + h + km, min(g, rhs)), with
+  planner->bias as km, and a node is on OPEN exactly when g != rhs: there
+  are no RAISE or LOWER states.  The backpointer of a node is the neighbor
+  its rhs came from, so the path is followed the same way as with D*.
+  A touched node with no backpointer and a finite rhs is a goal.
+
+  The anytime engine is Anytime D* (Likhachev et al.) on top of this: the
+  h of an overconsistent node is inflated by planner->epsilon, so the
+  search heads for the robot more greedily and the path it finds costs at
+  most epsilon times the optimal.  Each call is a pass in which a node is
+  expanded as overconsistent at most once.  Such a node is EXPANDED for
+  the rest of the pass and goes on planner->passList; if it becomes
+  inconsistent again it is INCONS, held back for the next pass instead of
+  going back on OPEN.  The next call puts the INCONS nodes back on OPEN,
+  and DS_NAME(LiteImprove) lowers epsilon before it does, so every pass
+  reuses the work of the ones before it.  With epsilon 1 none of this
+  happens and the engine is exactly D* Lite.
+*/
+
+#include <math.h>
+
+#define LITE_INF HUGE_VAL
+
+// g and rhs, infinite for a node the search has not touched
+#define LITE_G(n) (DS_STATE(n) == NEW ? LITE_INF : DS_G(n))
+#define LITE_RHS(n) (DS_STATE(n) == NEW ? LITE_INF : DS_K(n))
+#define LITE_GOAL(n) (DS_STATE(n) != NEW && DS_PARENT(n) == DS_NONE && DS_K(n) != LITE_INF)
+
+// expanded as overconsistent in this anytime pass
+#define LITE_PASSED(n) (DS_STATE(n) == EXPANDED || DS_STATE(n) == INCONS)
+
+// the first time the search touches a node, g and rhs start out infinite
+static inline void DS_NAME(LiteTouch)(DS_PLANNER * planner, DS_NODE n)
+{
+  if (DS_STATE(n) != NEW)
+    return;
+
+  DS_STATE(n) = CLOSED;
+  DS_G(n) = LITE_INF;
+  DS_K(n) = LITE_INF;
+  DS_SETPARENT(n, DS_NONE);
+  DS_HEPOCH(n) = planner->epoch - 1;
+}
+
+// the OPEN key of a node, with h inflated by epsilon for an
+// overconsistent node; this also brings its h up to date
+static inline void DS_NAME(LiteKey)(DS_PLANNER * planner, DS_NODE n, double key[2])
+{
+  HUPDATE(n);
+  DS_SETF(n);
+  if (DS_G(n) > DS_K(n)) {
+    key[0] = DS_K(n) + planner->epsilon * DS_H(n) + planner->bias;
+    key[1] = DS_K(n);
+  }
+  else {
+    key[0] = DS_G(n) + DS_H(n) + planner->bias;
+    key[1] = DS_G(n);
+  }
+}
+
+// puts an inconsistent node on OPEN, or re-keys it, and takes a consistent
+// one off; a node expanded in this pass is held back instead.  The caller
+// must have reserved room in the heap.
+static inline void DS_NAME(LiteQueue)(DS_PLANNER * planner, DS_NODE n)
+{
+  double          key[2];
+
+  if (DS_G(n) != DS_K(n) && LITE_PASSED(n))
+    DS_STATE(n) = INCONS;
+  else if (DS_G(n) != DS_K(n)) {
+    DS_NAME(LiteKey)(planner, n, key);
+    if (DS_STATE(n) == OPEN) {
+      DS_HEAPNAME(Update)(&DS_OPEN, DS_OPENINDEX(n), key[0], key[1], planner->epoch);
+      STAT(reinserts);
+    }
+    else {
+      DS_STATE(n) = OPEN;
+      DS_HEAPNAME(Push)(&DS_OPEN, n, key[0], key[1], planner->epoch);
+      STAT(inserts);
+      STATOPEN();
+    }
+  }
+  else if (DS_STATE(n) == OPEN) {
+    DS_HEAPNAME(Remove)(&DS_OPEN, DS_OPENINDEX(n));
+    DS_STATE(n) = CLOSED;
+  }
+  else if (DS_STATE(n) == INCONS)
+    DS_STATE(n) = EXPANDED;
+}
+
+// room for n more nodes on the pass list; -1 if it cannot grow
+static inline int DS_NAME(LiteReserve)(DS_PLANNER * planner, int64_t n)
+{
+  DS_NODE        *grown;
+  int64_t         capacity;
+
+  if (planner->passSize + n <= planner->passCapacity)
+    return (0);
+
+  capacity = planner->passCapacity > 0 ? 2 * planner->passCapacity : 1024;
+  while (capacity < planner->passSize + n)
+    capacity *= 2;
+  grown = (DS_NODE *) realloc(planner->passList, sizeof(DS_NODE) * capacity);
+  if (grown == NULL)
+    return (-1);
+  planner->passList = grown;
+  planner->passCapacity = capacity;
+
+  return (0);
+}
+
+// rhs of a node from its neighbors, with the backpointer to the best one.
+// This uses the second half of the neighbor buffer.
+static inline void DS_NAME(LiteRhs)(DS_PLANNER * planner, DS_NODE n)
+{
+  DS_NODE        *succ = DS_NEIGHBORBUF + planner->params.maxNeighbors;
+  DS_NODE         best = DS_NONE;
+  double          rhs = LITE_INF;
+  double          c;
+  int             numSucc, j;
+
+  numSucc = DS_NEIGHBORS(n, succ);
+  for (j = 0; j < numSucc; j++) {
+    if (LITE_G(succ[j]) == LITE_INF)
+      continue;
+
+    c = COSTOUT(n, j, succ[j]) + DS_G(succ[j]);
+    if (c < rhs) {
+      rhs = c;
+      best = succ[j];
+    }
+  }
+
+  DS_K(n) = rhs;
+  DS_SETPARENT(n, best);
+}
+
+// Expands nodes until the robot's node is consistent, or expanded in this
+// anytime pass, and nothing on OPEN has a smaller key.  While the planner
+// does not know which node is the robot's, costR stands in for the robot's
+// (f, g) as in D*.  A query's target takes the place of the robot's node.
+// The time spent here is the expand phase.
+static inline int DS_NAME(LiteRun)(DS_PLANNER * planner, double costR[2], DS_NODE * path)
+{
+  DS_HEAPTYPE    *open = &DS_OPEN;
+  DS_NODE        *neighbor = DS_NEIGHBORBUF;
+  double         *costTo = planner->edgeCost;
+  DS_NODE         current;
+  DS_NODE         s;
+  DS_NODE         robot;
+  double          kold[2], knew[2], kstart[2];
+  int             numNeighbors, numKept;
+  int64_t         i;
+  STATCLOCK;
+
+  // a robot that has moved onto a node the search never touched is
+  // infinitely far from the goal until the search gets there
+  robot = planner->target != DS_NONE ? planner->target : planner->robot;
+  if (robot != DS_NONE)
+    DS_NAME(LiteTouch)(planner, robot);
+
+  while (open->size > 0) {
+    current = open->entry[0].item;
+    kold[0] = open->entry[0].f;
+    kold[1] = open->entry[0].k;
+
+    // is there anything left to do for the robot?
+    robot = planner->target != DS_NONE ? planner->target : planner->robot;
+    if (robot != DS_NONE) {
+      DS_NAME(LiteKey)(planner, robot, kstart);
+      if ((DS_G(robot) == DS_K(robot) || LITE_PASSED(robot)) && !LESS(kold[0], kold[1], kstart[0], kstart[1]))
+	break;
+    }
+    else if (!LESSEQ(kold[0], kold[1], costR[0] + planner->bias, costR[1])) {
+      STATPHASE(DSTAR_PHASE_EXPAND);
+      return (DSTAR_TERMINATED);
+    }
+
+    // a key from before the robot moved is only a lower bound
+    DS_NAME(LiteKey)(planner, current, knew);
+    if (LESS(kold[0], kold[1], knew[0], knew[1])) {
+      STAT(rekeys);
+      DS_HEAPNAME(Update)(open, 0, knew[0], knew[1], planner->epoch);
+      continue;
+    }
+
+    DS_HEAPNAME(Pop)(open);
+    DS_STATE(current) = CLOSED;
+    planner->expanded++;
+
+    if (DS_ROBOT(current))
+      planner->robot = current;
+
+    // an overconsistent node only needs the neighbors it can improve on,
+    // unless the anytime heuristic is inflated and nodes come off OPEN out
+    // of order
+    if (DS_CANPRUNE && !planner->raised && planner->epsilon <= 1.0 && DS_G(current) > DS_K(current)) {
+      numNeighbors = DS_PRUNE(current, DS_PARENT(current), neighbor, &numKept);
+      planner->pruned = 1;
+    }
+    else
+      numNeighbors = numKept = DS_NEIGHBORS(current, neighbor);
+
+    // every neighbor plus the current node may go onto OPEN below, and the
+    // current node onto the pass list
+    if (DS_HEAPNAME(Reserve)(open, open->size + numNeighbors + 1) < 0 ||
+	(planner->epsilon > 1.0 && DS_NAME(LiteReserve)(planner, 1) < 0)) {
+      STATPHASE(DSTAR_PHASE_EXPAND);
+      return (DSTAR_NOMEM);
+    }
+
+    // the step from each neighbor to the current node
+    for (i = 0; i < numNeighbors; i++)
+      costTo[i] = PRUNED(i) ? -1.0 : COSTIN(current, i, neighbor[i]);
+
+    if (DS_G(current) > DS_K(current)) {       // overconsistent: g comes down to rhs
+      STAT(lower);
+      DS_G(current) = DS_K(current);
+      if (planner->epsilon > 1.0) {
+	DS_STATE(current) = EXPANDED;
+	planner->passList[planner->passSize++] = current;
+      }
+
+      for (i = 0; i < numNeighbors; i++) {
+	if (PRUNED(i)) {
+	  STAT(pruned);
+	  continue;
+	}
+
+	s = neighbor[i];
+
+	// after pruning has stopped, a NEW node looks at all its neighbors,
+	// as D* does in InsertNew
+	if (DS_STATE(s) == NEW && planner->pruned && planner->raised) {
+	  DS_NAME(LiteTouch)(planner, s);
+	  DS_NAME(LiteRhs)(planner, s);
+	  DS_NAME(LiteQueue)(planner, s);
+	  continue;
+	}
+
+	DS_NAME(LiteTouch)(planner, s);
+	if (!LITE_GOAL(s) && DS_G(current) + costTo[i] < DS_K(s)) {
+	  DS_K(s) = DS_G(current) + costTo[i];
+	  DS_SETPARENT(s, current);
+	  DS_NAME(LiteQueue)(planner, s);
+	}
+      }
+    }
+    else {				       // underconsistent: g goes up to infinity
+      STAT(raise);
+      planner->raised = 1;
+      DS_G(current) = LITE_INF;
+
+      // the neighbors whose rhs came through this node look again
+      for (i = 0; i < numNeighbors; i++) {
+	s = neighbor[i];
+	if (DS_STATE(s) != NEW && !LITE_GOAL(s) && DS_PARENT(s) == current) {
+	  DS_NAME(LiteRhs)(planner, s);
+	  DS_NAME(LiteQueue)(planner, s);
+	}
+      }
+      DS_NAME(LiteQueue)(planner, current);
+    }
+
+    if (planner->params.maxExpand > 0 && planner->expanded > planner->params.maxExpand) {
+      // OPEN is kept: dropping it would leave nodes inconsistent
+      STATPHASE(DSTAR_PHASE_EXPAND);
+      return (DSTAR_LIMIT);
+    }
+
+    if (BUDGETSPENT()) {
+      STATPHASE(DSTAR_PHASE_EXPAND);
+      return (DSTAR_UNFINISHED);
+    }
+  }
+  STATPHASE(DSTAR_PHASE_EXPAND);
+
+  robot = planner->target != DS_NONE ? planner->target : planner->robot;
+  if (robot == DS_NONE || (DS_G(robot) != DS_K(robot) && !LITE_PASSED(robot)) || DS_G(robot) == LITE_INF)
+    return (DSTAR_NOPATH);
+
+  costR[0] = costR[1] = DS_G(robot);
+  *path = DS_PARENT(robot);
+  planner->bound = planner->epsilon;
+
+  return (DSTAR_FOUND);
+}
+
+// A new search from the goals, whose rhs is the g they were given (0 for a
+// plain goal).  OPEN must be empty and the other nodes NEW.
+static inline int DS_NAME(LiteSearch)(DS_PLANNER * planner, DS_NODE const *goal, int64_t numGoals,
+				      double costR[2], DS_NODE * path)
+{
+  int64_t         i;
+  double          rhs;
+  STATCLOCK;
+
+  *path = DS_NONE;
+  DS_NAME(StartCall)(planner, 0);
+  planner->moved = 0;
+  planner->passSize = 0;
+  planner->epsilon = planner->params.engine == DSTAR_ENGINE_ANYTIME ? planner->params.epsilon : 1.0;
+
+  if (DS_HEAPNAME(Reserve)(&DS_OPEN, DS_OPEN.size + numGoals) < 0)
+    return (DSTAR_NOMEM);
+  for (i = 0; i < numGoals; i++) {
+    rhs = DS_G(goal[i]);
+    DS_STATE(goal[i]) = CLOSED;
+    DS_G(goal[i]) = LITE_INF;
+    DS_K(goal[i]) = rhs;
+    DS_SETPARENT(goal[i], DS_NONE);
+    DS_HEPOCH(goal[i]) = planner->epoch - 1;
+    DS_NAME(LiteQueue)(planner, goal[i]);
+  }
+  STATPHASE(DSTAR_PHASE_SEED);
+
+  return (DS_NAME(LiteRun)(planner, costR, path));
+}
+
+// Starts a pass of a replan or improve: accounts for a move of the robot,
+// puts the nodes the last pass held back on OPEN and re-keys OPEN if its
+// keys can no longer be trusted.  rekey is set when epsilon has changed.
+// Returns -1 if OPEN cannot grow.
+static inline int DS_NAME(LiteBegin)(DS_PLANNER * planner, int rekey)
+{
+  DS_HEAPTYPE    *open = &DS_OPEN;
+  DS_NODE         p;
+  double          key[2];
+  int64_t         i;
+
+  // if the robot has left the node it was last seen at, account for the
+  // move in km
+  if (planner->robot != DS_NONE && !DS_ROBOT(planner->robot))
+    DS_NAME(RobotMoved)(planner, planner->robot);
+
+  if (DS_HEAPNAME(Reserve)(open, open->size + planner->passSize) < 0)
+    return (-1);
+  for (i = 0; i < planner->passSize; i++) {
+    p = planner->passList[i];
+    if (DS_STATE(p) == EXPANDED)
+      DS_STATE(p) = CLOSED;
+    else if (DS_STATE(p) == INCONS) {
+      DS_STATE(p) = CLOSED;
+      DS_NAME(LiteQueue)(planner, p);
+    }
+  }
+  planner->passSize = 0;
+
+  // where the robot was when the keys on OPEN were computed is not known,
+  // or epsilon has changed, so compute them all again
+  if (open->size > 0 && (rekey || (planner->robot == DS_NONE && !planner->moved))) {
+    for (i = 0; i < open->size; i++) {
+      p = open->entry[i].item;
+      DS_NAME(LiteKey)(planner, p, key);
+      open->entry[i].f = key[0];
+      open->entry[i].k = key[1];
+    }
+    DS_HEAPNAME(Sort)(open);
+  }
+  planner->moved = 0;
+
+  return (0);
+}
+
+// Continues after the costs of the edges at the changed nodes have changed
+// or the robot has moved
+static inline int DS_NAME(LiteReplan)(DS_PLANNER * planner, DS_NODE const *changed, int64_t numChanged,
+				      double costR[2], DS_NODE * path)
+{
+  DS_HEAPTYPE    *open = &DS_OPEN;
+  DS_NODE        *neighbor = DS_NEIGHBORBUF;
+  DS_NODE         c;
+  DS_NODE         p;
+  int             numNeighbors, j;
+  int64_t         i;
+  STATCLOCK;
+
+  *path = DS_NONE;
+  DS_NAME(StartCall)(planner, 0);
+  if (DS_NAME(LiteBegin)(planner, 0) < 0)
+    return (DSTAR_NOMEM);
+  STATPHASE(DSTAR_PHASE_REKEY);
+
+  // the edges at a changed node change the rhs of the node and of each of
+  // its neighbors
+  for (i = 0; i < numChanged; i++) {
+    c = changed[i];
+    if (DS_STATE(c) == NEW)
+      continue;
+
+    if (!LITE_GOAL(c))
+      DS_NAME(LiteRhs)(planner, c);
+
+    numNeighbors = DS_NEIGHBORS(c, neighbor);
+    if (DS_HEAPNAME(Reserve)(open, open->size + numNeighbors + 1) < 0)
+      return (DSTAR_NOMEM);
+    DS_NAME(LiteQueue)(planner, c);
+
+    for (j = 0; j < numNeighbors; j++) {
+      p = neighbor[j];
+      if (DS_STATE(p) == NEW || LITE_GOAL(p))
+	continue;
+      DS_NAME(LiteRhs)(planner, p);
+      DS_NAME(LiteQueue)(planner, p);
+    }
+  }
+  STATPHASE(DSTAR_PHASE_SEED);
+
+  return (DS_NAME(LiteRun)(planner, costR, path));
+}
+
+// Goes on from where a call the budget stopped left off
+static inline int DS_NAME(LiteResume)(DS_PLANNER * planner, double costR[2], DS_NODE * path)
+{
+  *path = DS_NONE;
+  DS_NAME(StartCall)(planner, 1);
+
+  if (planner->robot != DS_NONE && !DS_ROBOT(planner->robot))
+    DS_NAME(RobotMoved)(planner, planner->robot);
+  planner->moved = 0;
+
+  return (DS_NAME(LiteRun)(planner, costR, path));
+}
+
+// Anytime D*: lowers epsilon by one step of the schedule, to no less than
+// 1, and runs a pass that improves the path with what the passes before
+// have found
+static inline int DS_NAME(LiteImprove)(DS_PLANNER * planner, double costR[2], DS_NODE * path)
+{
+  double          epsilon = planner->epsilon;
+  STATCLOCK;
+
+  *path = DS_NONE;
+  DS_NAME(StartCall)(planner, 0);
+
+  if (planner->epsilon > 1.0) {
+    planner->epsilon -= planner->params.epsilonStep;
+    if (planner->epsilon < 1.0 || planner->params.epsilonStep <= 0.0)
+      planner->epsilon = 1.0;
+  }
+  if (DS_NAME(LiteBegin)(planner, planner->epsilon != epsilon) < 0)
+    return (DSTAR_NOMEM);
+  STATPHASE(DSTAR_PHASE_REKEY);
+
+  return (DS_NAME(LiteRun)(planner, costR, path));
+}
+
+#undef LITE_INF
+#undef LITE_G
+#undef LITE_RHS
+#undef LITE_GOAL
+#undef LITE_PASSED
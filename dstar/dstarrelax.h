@@ -0,0 +1,165 @@
+/*
+  Batch tests of the neighbors of a D* expansion over node arrays.
+
+  A LOWER or RAISE expansion tests each neighbor against the current node
+  with a chain of branches on its state, backpointer and g.  Which way a
+  test goes depends only on the neighbor's own fields, which expanding
+  the other neighbors leaves alone, so all of them can be tested up front.
+  DStarRelax does that for the planners of dstarinline.h, whose g, state
+  and parent are arrays, and writes the neighbors that need something
+  done, in order, each with what to do; the search then does just those.
+
+  With AVX2 four neighbors are tested at once: their g and parent are
+  gathered into lanes, the tests are compares that give masks, and the
+  masks are combined with bit operations, so no test branches.  Without
+  it the same tests run one neighbor at a time, still ahead of acting on
+  any of them.  DStarRelaxSelect picks between the two when a planner is
+  created, from the processor and the environment variable DSTAR_SIMD.
+  Both give the same actions, so a search expands the same nodes either
+  way.
+
+  A node may only be listed once among the neighbors.
+*/
+
+#ifndef DSTARRELAX_H
+#define DSTARRELAX_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dstar.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DSTAR_RELAX_AVX2 1
+#include <immintrin.h>
+#endif
+
+// what is done with a neighbor, in the low 2 bits of each action; the
+// neighbor's position is above them
+#define DSTAR_RELAX_UPDATE 1	// it takes the current node as its parent
+#define DSTAR_RELAX_HOLD   2	// RAISE: the current node goes back on OPEN
+#define DSTAR_RELAX_CHECK  3	// RAISE: it may go back on OPEN, which needs its
+				// cost to the current node
+
+// the action for neighbor i, 0 for none, from whether it is NEW, a child of
+// the current node, and the compares of its g with g(current) + cost
+#define DSTAR_RELAXCODE(isNew, child, ne, gt, pruned, raise)		\
+  ((isNew) || ((child) && (ne)) ? ((pruned) && !(child) ? 0 : DSTAR_RELAX_UPDATE) :	\
+   (raise) && !(child) ? ((gt) ? DSTAR_RELAX_HOLD : DSTAR_RELAX_CHECK) :		\
+   !(raise) && !(child) && (gt) && !(pruned) ? DSTAR_RELAX_UPDATE : 0)
+
+// one neighbor at a time
+static inline int DStarRelaxScalar(const double *g, const unsigned char *state, const uint32_t *parent,
+				   const int64_t *neighbor, const double *cost, int num, int numKept,
+				   uint32_t current, double gc, int raise, int *act)
+{
+  int             i, code, numActs = 0;
+  int64_t         n;
+
+  for (i = 0; i < num; i++) {
+    n = neighbor[i];
+    code = DSTAR_RELAXCODE(state[n] == NEW, parent[n] == current, g[n] != gc + cost[i],
+			   g[n] > gc + cost[i], i >= numKept, raise);
+    if (code != 0)
+      act[numActs++] = i << 2 | code;
+  }
+
+  return (numActs);
+}
+
+#ifdef DSTAR_RELAX_AVX2
+// Four neighbors at a time, the tests as masks of four bits, one per lane
+static inline __attribute__ ((target("avx2")))
+int             DStarRelaxAVX2(const double *g, const unsigned char *state, const uint32_t *parent,
+			       const int64_t *neighbor, const double *cost, int num, int numKept,
+			       uint32_t current, double gc, int raise, int *act)
+{
+  __m256d         gc4 = _mm256_set1_pd(gc);
+  __m128i         current4 = _mm_set1_epi32((int) current);
+  __m128i         new4 = _mm_set1_epi32(NEW);
+  __m256i         index;
+  __m256d         gn, via;
+  __m128i         pn, st;
+  unsigned        isNew, child, ne, gt, pruned, base, update, hold, check, low, high, all;
+  int             i, b, numActs = 0;
+
+  for (i = 0; i + 4 <= num; i += 4) {
+    index = _mm256_loadu_si256((const __m256i *) (neighbor + i));
+    gn = _mm256_i64gather_pd(g, index, 8);
+    pn = _mm256_i64gather_epi32((const int *) parent, index, 4);
+    st = _mm_set_epi32(state[neighbor[i + 3]], state[neighbor[i + 2]], state[neighbor[i + 1]], state[neighbor[i]]);
+    via = _mm256_add_pd(gc4, _mm256_loadu_pd(cost + i));
+
+    isNew = (unsigned) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(st, new4)));
+    child = (unsigned) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(pn, current4)));
+    ne = (unsigned) _mm256_movemask_pd(_mm256_cmp_pd(gn, via, _CMP_NEQ_UQ));
+    gt = (unsigned) _mm256_movemask_pd(_mm256_cmp_pd(gn, via, _CMP_GT_OQ));
+    pruned = i + 4 <= numKept ? 0 : i >= numKept ? 0xf : 0xfu << (numKept - i) & 0xf;
+
+    // the same tests as DSTAR_RELAXCODE, on every lane at once
+    base = isNew | (child & ne);
+    update = base & ~(pruned & ~child);
+    if (raise) {
+      hold = ~base & ~child & gt & 0xf;
+      check = ~base & ~child & ~gt & 0xf;
+    }
+    else {
+      update |= ~base & ~child & gt & ~pruned & 0xf;
+      hold = check = 0;
+    }
+
+    // the two bits of each lane's code
+    low = update | check;
+    high = hold | check;
+    for (all = low | high; all != 0; all &= all - 1) {
+      b = __builtin_ctz(all);
+      act[numActs++] = (i + b) << 2 | (low >> b & 1) | (high >> b & 1) << 1;
+    }
+  }
+
+  // the ones left over
+  for (; i < num; i++) {
+    b = DSTAR_RELAXCODE(state[neighbor[i]] == NEW, parent[neighbor[i]] == current,
+			g[neighbor[i]] != gc + cost[i], g[neighbor[i]] > gc + cost[i], i >= numKept, raise);
+    if (b != 0)
+      act[numActs++] = i << 2 | b;
+  }
+
+  return (numActs);
+}
+#endif
+
+// 1 if DStarRelax is to use AVX2: the environment variable DSTAR_SIMD is 1
+// and the processor has it.  On the processors it was measured on, the
+// gathers cost more than the branches they save, so it is not the default.
+static inline int DStarRelaxSelect(void)
+{
+  const char     *simd = getenv("DSTAR_SIMD");
+
+  if (simd == NULL || strcmp(simd, "1") != 0)
+    return (0);
+#ifdef DSTAR_RELAX_AVX2
+  __builtin_cpu_init();
+  return (__builtin_cpu_supports("avx2") ? 1 : 0);
+#else
+  return (0);
+#endif
+}
+
+// The actions for the num neighbors of an expansion of current, a RAISE
+// one if raise is set, into act; returns their number.  g, state and
+// parent are the node arrays, cost the steps from the neighbors to
+// current, and the neighbors from numKept on were left out by pruning
+// unless they are children of current.  avx2 is what DStarRelaxSelect gave.
+static inline int DStarRelax(int avx2, const double *g, const unsigned char *state, const uint32_t *parent,
+			     const int64_t *neighbor, const double *cost, int num, int numKept,
+			     uint32_t current, double gc, int raise, int *act)
+{
+#ifdef DSTAR_RELAX_AVX2
+  if (avx2)
+    return (DStarRelaxAVX2(g, state, parent, neighbor, cost, num, numKept, current, gc, raise, act));
+#endif
+  return (DStarRelaxScalar(g, state, parent, neighbor, cost, num, numKept, current, gc, raise, act));
+}
+
+#endif
@@ -0,0 +1,636 @@
+/*
+	Replanning benchmark suite
+
+	Builds synthetic maps, plans across each with the index planner and
+	then drives the robot along its path while obstacles keep dropping
+	onto the path ahead of it, replanning after every drop.  The maps:
+
+	random	rectangles scattered over a fifth of the grid
+	maze	a braided maze of corridors
+	corridor	one long corridor winding back and forth across the grid
+	open	no obstacles at all
+
+	Each map is run at every size from 100 x 100 up to 4000 x 4000 cells,
+	with each engine.  For each run it reports the expansions per second
+	over the whole run, the p50, p99 and max latency of the replans and
+	the peak memory, as a table on stdout and one CSV line per run in the
+	output file, so that runs can be compared across changes to the
+	planner.
+
+	build:	cc -O2 -o dsuite dsuite.c dstar.c dmap.c dtrace.c -lm
+	usage:	dsuite [-d | -l | -a] [-m maxsize] [-e events] [-s seed] [-b us] [-o file] [map ...]
+
+	-d, -l and -a run only D*, D* Lite or Anytime D*, -m skips sizes
+	above maxsize, -e sets the number of obstacle drops per run (default
+	100) and -o the CSV file (default dsuite.csv).  -b gives every planner call a budget of
+	that many microseconds, as a control loop would, and resumes a call
+	the budget stopped until it finishes; slices counts the calls and
+	resumes, and slice_max_ms is the longest of them.
+
+	Anytime D* takes the first path its initial search finds, then
+	improves it until it is optimal before the robot sets off; first_ms
+	is how long the first path took and first_bound how far from optimal
+	it could be.  initial_ms and initial_expanded include the improving.
+
+	peak_bytes is the planner and map of one run; maxrss_kb is the peak of
+	the whole process so far, so it only grows down the file.  A replan
+	that expands more than 25 nodes per cell gives up and is followed by a
+	new search; the limits column counts these.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "dstar.h"
+#include "dmap.h"
+
+int gblGridX;
+int gblGridY;
+int gblGoal[2];
+int gblRobot[2];
+DMap *gblMap;
+
+#define CELL(x, y) ((int64_t)(y) * gblGridX + (x))
+
+#define NUMSIZES 6
+int gblSizes[NUMSIZES] = {100, 250, 500, 1000, 2000, 4000};
+
+#define NUMMAPS 4
+char *gblMapName[NUMMAPS] = {"random", "maze", "corridor", "open"};
+
+#define NUMENGINES 3
+char *gblEngineName[NUMENGINES] = {"dstar", "lite", "anytime"};
+
+// budget of each planner call in microseconds (-b), 0 for none
+int64_t gblBudget = 0;
+
+// the callbacks of the index planner
+double cellCost(int64_t to, int64_t from, void *data);
+double cellCost(int64_t to, int64_t from, void *data) {
+	return(DMapStepCost(gblMap, to, from));
+}
+
+double cellH(int64_t cell, void *data);
+double cellH(int64_t cell, void *data) {
+	double dx, dy;
+
+	dx = gblRobot[0] - cell % gblGridX;
+	dy = gblRobot[1] - cell / gblGridX;
+
+	return(sqrt(dx*dx + dy*dy));
+}
+
+int cellRobot(int64_t cell, void *data);
+int cellRobot(int64_t cell, void *data) {
+	return(cell == CELL(gblRobot[0], gblRobot[1]));
+}
+
+int cellNeighbors(int64_t cell, int64_t *neighbor, void *data);
+int cellNeighbors(int64_t cell, int64_t *neighbor, void *data) {
+	int deltax[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+	int deltay[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+	int i, x, y, n;
+
+	n = 0;
+	for(i=0;i<8;i++) {
+		x = cell % gblGridX + deltax[i];
+		y = cell / gblGridX + deltay[i];
+		if(x >= 0 && x < gblGridX && y >= 0 && y < gblGridY)
+			neighbor[n++] = CELL(x, y);
+	}
+
+	return(n);
+}
+
+double now(void);
+double now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec + 1e-9 * ts.tv_nsec);
+}
+
+// width of the corridors of the maze and corridor maps
+int corridorWidth(int size);
+int corridorWidth(int size) {
+	return(size / 64 < 2 ? 2 : size / 64);
+}
+
+// start near one corner and the goal near the other, with clear boxes
+// around both
+void corners(int size);
+void corners(int size) {
+	int r = size / 20;
+
+	gblRobot[0] = gblRobot[1] = r;
+	gblGoal[0] = gblGoal[1] = size - 1 - r;
+	DMapClearRect(gblMap, gblRobot[1] + r, gblRobot[0] - r, gblRobot[1] - r, gblRobot[0] + r);
+	DMapClearRect(gblMap, gblGoal[1] + r, gblGoal[0] - r, gblGoal[1] - r, gblGoal[0] + r);
+}
+
+void randomMap(int size);
+void randomMap(int size) {
+	int64_t i, count;
+	int a, x, y, w, h;
+
+	// sides of 1 .. 2a + 1 cover about (a + 1)^2 cells each
+	a = size / 100 + 1;
+	count = (int64_t)(0.2 * size * size / ((a + 1) * (a + 1)));
+	for(i=0;i<count;i++) {
+		w = 1 + rand() % (2 * a + 1);
+		h = 1 + rand() % (2 * a + 1);
+		x = rand() % size;
+		y = rand() % size;
+		DMapAddRect(gblMap, y + h - 1, x, y, x + w - 1);
+	}
+	corners(size);
+}
+
+// Rooms of the corridor width on a grid with walls as thick as the rooms,
+// joined by a depth-first search and then braided so that most walls have
+// a way around them
+int mazeMap(int size);
+int mazeMap(int size) {
+	int cw, pitch, nx, ny, i, n, x, y, dir, d, top, cx, cy;
+	int dx[4] = {1, 0, -1, 0};
+	int dy[4] = {0, 1, 0, -1};
+	int *stack;
+	char *seen;
+
+	cw = corridorWidth(size);
+	pitch = 2 * cw;
+	nx = (size - cw) / pitch;
+	ny = nx;
+	stack = (int *)malloc(sizeof(int) * nx * ny);
+	seen = (char *)calloc(nx * ny, 1);
+	if(stack == NULL || seen == NULL)
+		return(-1);
+
+	DMapAddRect(gblMap, size - 1, 0, 0, size - 1);
+	for(y=0;y<ny;y++) {
+		for(x=0;x<nx;x++)
+			DMapClearRect(gblMap, cw + y * pitch + cw - 1, cw + x * pitch,
+				      cw + y * pitch, cw + x * pitch + cw - 1);
+	}
+
+	// knock through to an unseen neighbor room until there are none
+	top = 0;
+	stack[top++] = 0;
+	seen[0] = 1;
+	while(top > 0) {
+		cx = stack[top - 1] % nx;
+		cy = stack[top - 1] / nx;
+		n = 0;
+		for(d=0;d<4;d++) {
+			x = cx + dx[d];
+			y = cy + dy[d];
+			if(x >= 0 && x < nx && y >= 0 && y < ny && !seen[y * nx + x])
+				n++;
+		}
+		if(n == 0) {
+			top--;
+			continue;
+		}
+		i = rand() % n;
+		for(dir=-1,d=0;d<4;d++) {
+			x = cx + dx[d];
+			y = cy + dy[d];
+			if(x >= 0 && x < nx && y >= 0 && y < ny && !seen[y * nx + x] && i-- == 0)
+				dir = d;
+		}
+		x = cx + dx[dir];
+		y = cy + dy[dir];
+		DMapClearRect(gblMap, cw + (cy > y ? cy : y) * pitch + cw - 1, cw + (cx < x ? cx : x) * pitch,
+			      cw + (cy < y ? cy : y) * pitch, cw + (cx > x ? cx : x) * pitch + cw - 1);
+		seen[y * nx + x] = 1;
+		stack[top++] = y * nx + x;
+	}
+
+	// braid: open one in ten of the walls between rooms
+	for(y=0;y<ny;y++) {
+		for(x=0;x<nx;x++) {
+			if(x + 1 < nx && rand() % 10 == 0)
+				DMapClearRect(gblMap, cw + y * pitch + cw - 1, cw + x * pitch,
+					      cw + y * pitch, cw + (x + 1) * pitch + cw - 1);
+			if(y + 1 < ny && rand() % 10 == 0)
+				DMapClearRect(gblMap, cw + (y + 1) * pitch + cw - 1, cw + x * pitch,
+					      cw + y * pitch, cw + x * pitch + cw - 1);
+		}
+	}
+
+	gblRobot[0] = gblRobot[1] = cw + cw / 2;
+	gblGoal[0] = gblGoal[1] = cw + (nx - 1) * pitch + cw / 2;
+
+	free(stack);
+	free(seen);
+
+	return(0);
+}
+
+// Walls across the grid a corridor width apart, each with a gap at the
+// opposite end from the one below it
+void corridorMap(int size);
+void corridorMap(int size) {
+	int cw, t, y, k;
+
+	cw = corridorWidth(size);
+	t = cw / 4 < 1 ? 1 : cw / 4;
+	for(k=0,y=cw;y+t<size;k++,y+=cw+t) {
+		if(k % 2 == 0)
+			DMapAddRect(gblMap, y + t - 1, 0, y, size - 1 - cw);
+		else
+			DMapAddRect(gblMap, y + t - 1, cw, y, size - 1);
+	}
+
+	gblRobot[0] = cw / 2;
+	gblRobot[1] = cw / 2;
+	gblGoal[0] = size / 2;
+	gblGoal[1] = size - 1;
+	DMapClearRect(gblMap, gblGoal[1], gblGoal[0], gblGoal[1], gblGoal[0]);
+}
+
+// builds map m at the given size; -1 if there is not enough memory
+int buildMap(int m, int size);
+int buildMap(int m, int size) {
+	gblGridX = gblGridY = size;
+	gblMap = DMapCreate(size, size);
+	if(gblMap == NULL)
+		return(-1);
+
+	if(m == 0)
+		randomMap(size);
+	else if(m == 1)
+		return(mazeMap(size));
+	else if(m == 2)
+		corridorMap(size);
+	else
+		corners(size);
+
+	return(0);
+}
+
+// cost of following the backpointers from a cell to the goal; DMAP_OBSTACLE
+// or more if that runs into an obstacle or never reaches the goal
+double pathCost(DStarPlanner *planner, int64_t cell);
+double pathCost(DStarPlanner *planner, int64_t cell) {
+	double cost = 0.0;
+	int64_t parent, steps, numCells;
+
+	numCells = (int64_t)gblGridX * gblGridY;
+	for(steps=0;steps<numCells;steps++) {
+		if(cell == CELL(gblGoal[0], gblGoal[1]))
+			return(cost);
+		parent = DStarPlannerParent(planner, cell);
+		if(parent < 0)
+			break;
+		cost += cellCost(parent, cell, NULL);
+		cell = parent;
+	}
+
+	return(DMAP_OBSTACLE);
+}
+
+int compareDouble(const void *a, const void *b);
+int compareDouble(const void *a, const void *b) {
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return(x < y ? -1 : x > y ? 1 : 0);
+}
+
+// nearest-rank percentile of n sorted values
+double percentile(double *v, int n, double p);
+double percentile(double *v, int n, double p) {
+	int i;
+
+	if(n == 0)
+		return(0.0);
+	i = (int)ceil(p * n) - 1;
+	return(v[i < 0 ? 0 : i]);
+}
+
+typedef struct {
+	int replans;
+	int limits;			// replans that hit maxExpand
+	int64_t expanded[2];		// initial search, all replans
+	double seconds[2];
+	double p50, p99, max;		// replan latency, seconds
+	size_t peakBytes;		// planner plus map
+	long maxrss;			// of the process so far, kB
+	double pathcost;		// when the run ended
+	char *status;			// why it ended
+	int64_t slices;			// planner calls, resumes included
+	double sliceMax;		// longest of them, seconds
+	double first;			// to the first path of the initial search, seconds
+	double firstBound;		// suboptimality bound of that path
+} Result;
+
+// the planner's memory high-water mark, map included
+void notePeak(DStarPlanner *planner, Result *result);
+void notePeak(DStarPlanner *planner, Result *result) {
+	size_t bytes = DStarPlannerBytes(planner) + DMapBytes(gblMap);
+
+	if(bytes > result->peakBytes)
+		result->peakBytes = bytes;
+}
+
+// Resumes a call the budget stopped until it finishes, as a control loop
+// would over several ticks, and adds up its expansions.  start is when
+// the call began.
+int finish(DStarPlanner *planner, int status, double start, double costR[2], int64_t *path,
+	   int64_t *expanded, Result *result);
+int finish(DStarPlanner *planner, int status, double start, double costR[2], int64_t *path,
+	   int64_t *expanded, Result *result) {
+	double t = now();
+
+	for(;;) {
+		result->slices++;
+		if(t - start > result->sliceMax)
+			result->sliceMax = t - start;
+		if(status != DSTAR_UNFINISHED)
+			break;
+		start = now();
+		status = DStarPlannerResumeIndex(planner, costR, path);
+		t = now();
+	}
+	*expanded += DStarPlannerExpanded(planner);
+
+	return(status);
+}
+
+// Replans from the changed cells that were on the tree, timing the call.
+// A replan that expands more than maxExpand nodes has thrown its OPEN list
+// away, so it is followed by a new search, timed with it.
+void replan(DStarPlanner *planner, int64_t *changed, int64_t numChanged, int64_t *seed,
+	    double *latency, Result *result);
+void replan(DStarPlanner *planner, int64_t *changed, int64_t numChanged, int64_t *seed,
+	    double *latency, Result *result) {
+	Node robotNode;
+	double costR[2], t, start;
+	int64_t pathCell, goalCell, numSeeds, i;
+	int status;
+
+	for(numSeeds=0,i=0;i<numChanged;i++) {
+		if(DStarPlannerParent(planner, changed[i]) >= 0)
+			seed[numSeeds++] = changed[i];
+	}
+
+	DStarPlannerNode(planner, CELL(gblRobot[0], gblRobot[1]), &robotNode);
+	costR[0] = robotNode.state == NEW ? DMAP_OBSTACLE : robotNode.f;
+	costR[1] = robotNode.state == NEW ? DMAP_OBSTACLE : robotNode.g;
+
+	t = now();
+	status = DStarPlannerReplanIndex(planner, seed, numSeeds, costR, &pathCell);
+	status = finish(planner, status, t, costR, &pathCell, &result->expanded[1], result);
+	if(status == DSTAR_LIMIT) {
+		result->limits++;
+		goalCell = CELL(gblGoal[0], gblGoal[1]);
+		costR[0] = costR[1] = DMAP_OBSTACLE;
+		start = now();
+		status = DStarPlannerSearchIndex(planner, &goalCell, 1, costR, &pathCell);
+		finish(planner, status, start, costR, &pathCell, &result->expanded[1], result);
+	}
+	latency[result->replans] = now() - t;
+	result->seconds[1] += latency[result->replans++];
+	notePeak(planner, result);
+}
+
+// Runs the initial search, then numEvents rounds of moving the robot along
+// its path and dropping an obstacle on the path ahead of it.  An obstacle
+// that shuts the robot in is lifted again with a second replan.
+int run(int engine, int numEvents, int size, int cw, Result *result);
+int run(int engine, int numEvents, int size, int cw, Result *result) {
+	DStarIndexCallbacks icb;
+	DStarParams params;
+	DStarPlanner *planner;
+	struct rusage usage;
+	double costR[2], t, start, *latency;
+	int64_t numCells, goalCell, pathCell, cell, parent, *drop, *seed, numDrop, i;
+	int event, steps, ahead, side, x, y, x0, y0, status;
+
+	numCells = (int64_t)size * size;
+	memset(result, 0, sizeof(Result));
+
+	// allow each cell to be expanded a few times over, as dmain does
+	DStarDefaultParams(&params);
+	params.maxExpand = 25 * numCells;
+	params.engine = engine;
+	icb.hcalc = cellH;
+	icb.robotNode = cellRobot;
+	icb.neighbors = cellNeighbors;
+	icb.cost = cellCost;
+	icb.printNode = NULL;
+	icb.pruneNeighbors = NULL;
+	icb.data = NULL;
+	planner = DStarPlannerCreateIndex(&icb, numCells, &params);
+	latency = (double *)malloc(sizeof(double) * 2 * numEvents);
+	drop = (int64_t *)malloc(sizeof(int64_t) * (size / 50 + 3) * (size / 50 + 3));
+	seed = (int64_t *)malloc(sizeof(int64_t) * (size / 50 + 3) * (size / 50 + 3));
+	if(planner == NULL || latency == NULL || drop == NULL || seed == NULL) {
+		printf("Not enough memory for a %d x %d planner\n", size, size);
+		return(-1);
+	}
+
+	DStarPlannerBudget(planner, 0, gblBudget);
+
+	// initial search
+	goalCell = CELL(gblGoal[0], gblGoal[1]);
+	costR[0] = costR[1] = DMAP_OBSTACLE;
+	t = now();
+	status = DStarPlannerSearchIndex(planner, &goalCell, 1, costR, &pathCell);
+	status = finish(planner, status, t, costR, &pathCell, &result->expanded[0], result);
+	result->first = now() - t;
+	result->firstBound = DStarPlannerBound(planner);
+
+	// Anytime D*: improve the first path until it is optimal
+	while(status == DSTAR_FOUND && DStarPlannerBound(planner) > 1.0) {
+		start = now();
+		status = DStarPlannerImproveIndex(planner, costR, &pathCell);
+		status = finish(planner, status, start, costR, &pathCell, &result->expanded[0], result);
+	}
+	result->seconds[0] = now() - t;
+	notePeak(planner, result);
+	result->status = "events";
+
+	for(event=0;event<numEvents;event++) {
+		cell = CELL(gblRobot[0], gblRobot[1]);
+		result->pathcost = pathCost(planner, cell);
+		if(result->pathcost >= DMAP_OBSTACLE) {
+			result->status = "blocked";
+			break;
+		}
+		if(cell == goalCell) {
+			result->status = "goal";
+			break;
+		}
+
+		// move a few steps along the path
+		for(steps=0;steps<size/100+1 && cell != goalCell;steps++)
+			cell = DStarPlannerParent(planner, cell);
+		gblRobot[0] = cell % size;
+		gblRobot[1] = cell / size;
+		DStarPlannerRobotAtIndex(planner, cell);
+
+		// drop a square on the path a little way ahead; in the maze and
+		// corridor it is kept narrower than the corridor
+		ahead = 3 + rand() % (2 * (size / 100) + 6);
+		for(;ahead>0 && cell != goalCell;ahead--) {
+			parent = DStarPlannerParent(planner, cell);
+			if(parent < 0)
+				break;
+			cell = parent;
+		}
+		side = cw > 0 ? 1 + rand() % (cw / 2 > 1 ? cw / 2 : 1) : 1 + rand() % (size / 50 + 2);
+		x0 = cell % size - side / 2;
+		y0 = cell / size - side / 2;
+		numDrop = 0;
+		for(y=y0;y<y0+side;y++) {
+			for(x=x0;x<x0+side;x++) {
+				if(x < 0 || x >= size || y < 0 || y >= size || DMapOccupied(gblMap, x, y))
+					continue;
+				if((x == gblRobot[0] && y == gblRobot[1]) || (x == gblGoal[0] && y == gblGoal[1]))
+					continue;
+				DMapSetCell(gblMap, CELL(x, y), 1);
+				drop[numDrop++] = CELL(x, y);
+			}
+		}
+		replan(planner, drop, numDrop, seed, latency, result);
+
+		if(pathCost(planner, CELL(gblRobot[0], gblRobot[1])) >= DMAP_OBSTACLE) {
+			for(i=0;i<numDrop;i++)
+				DMapSetCell(gblMap, drop[i], 0);
+			replan(planner, drop, numDrop, seed, latency, result);
+		}
+	}
+	if(event == numEvents)
+		result->pathcost = pathCost(planner, CELL(gblRobot[0], gblRobot[1]));
+
+	qsort(latency, result->replans, sizeof(double), compareDouble);
+	result->p50 = percentile(latency, result->replans, 0.50);
+	result->p99 = percentile(latency, result->replans, 0.99);
+	result->max = percentile(latency, result->replans, 1.0);
+
+	getrusage(RUSAGE_SELF, &usage);
+	result->maxrss = usage.ru_maxrss;
+
+	DStarPlannerDestroy(planner);
+	free(latency);
+	free(drop);
+	free(seed);
+
+	return(0);
+}
+
+int main(int argc, char *argv[]) {
+	int maxSize = 4000, numEvents = 100, engines[NUMENGINES] = {1, 1, 1};
+	unsigned int seed = 1;
+	char *outName = "dsuite.csv";
+	int wanted[NUMMAPS] = {0, 0, 0, 0};
+	int m, s, e, size, cw, any = 0;
+	FILE *out;
+	Result result;
+
+	for(argc--,argv++;argc>0;argc--,argv++) {
+		if(strcmp(argv[0], "-d") == 0)
+			engines[1] = engines[2] = 0;
+		else if(strcmp(argv[0], "-l") == 0)
+			engines[0] = engines[2] = 0;
+		else if(strcmp(argv[0], "-a") == 0)
+			engines[0] = engines[1] = 0;
+		else if(argc > 1 && strcmp(argv[0], "-m") == 0) {
+			maxSize = atoi(argv[1]);
+			argc--, argv++;
+		}
+		else if(argc > 1 && strcmp(argv[0], "-e") == 0) {
+			numEvents = atoi(argv[1]);
+			argc--, argv++;
+		}
+		else if(argc > 1 && strcmp(argv[0], "-s") == 0) {
+			seed = atoi(argv[1]);
+			argc--, argv++;
+		}
+		else if(argc > 1 && strcmp(argv[0], "-b") == 0) {
+			gblBudget = atoll(argv[1]);
+			argc--, argv++;
+		}
+		else if(argc > 1 && strcmp(argv[0], "-o") == 0) {
+			outName = argv[1];
+			argc--, argv++;
+		}
+		else {
+			for(m=0;m<NUMMAPS && strcmp(argv[0], gblMapName[m]) != 0;m++);
+			if(m == NUMMAPS) {
+				printf("usage: dsuite [-d | -l | -a] [-m maxsize] [-e events] [-s seed] [-b us] [-o file] [map ...]\n");
+				return(1);
+			}
+			wanted[m] = any = 1;
+		}
+	}
+	if(numEvents < 1) {
+		printf("events must be at least 1\n");
+		return(1);
+	}
+
+	out = fopen(outName, "w");
+	if(out == NULL) {
+		printf("Unable to open %s\n", outName);
+		return(1);
+	}
+	fprintf(out, "map,size,engine,seed,replans,limits,initial_expanded,initial_ms,replan_expanded,"
+		"expanded_per_s,replan_p50_ms,replan_p99_ms,replan_max_ms,peak_bytes,maxrss_kb,"
+		"pathcost,status,slices,slice_max_ms,first_ms,first_bound\n");
+
+	for(m=0;m<NUMMAPS;m++) {
+		if(any && !wanted[m])
+			continue;
+		for(s=0;s<NUMSIZES && gblSizes[s]<=maxSize;s++) {
+			size = gblSizes[s];
+			cw = m == 1 || m == 2 ? corridorWidth(size) : 0;
+			for(e=0;e<NUMENGINES;e++) {
+				if(!engines[e])
+					continue;
+
+				// the same map and events for every engine
+				srand(seed);
+				if(buildMap(m, size) < 0 || run(e, numEvents, size, cw, &result) < 0) {
+					printf("Not enough memory for %s at %d x %d\n", gblMapName[m], size, size);
+					return(1);
+				}
+
+				fprintf(out, "%s,%d,%s,%u,%d,%d,%" PRId64 ",%.3f,%" PRId64 ",%.0f,%.4f,%.4f,%.4f,%zu,%ld,%.2f,%s,%" PRId64 ",%.4f,%.3f,%.2f\n",
+					gblMapName[m], size, gblEngineName[e], seed, result.replans, result.limits,
+					result.expanded[0], 1e3 * result.seconds[0], result.expanded[1],
+					(result.expanded[0] + result.expanded[1]) / (result.seconds[0] + result.seconds[1]),
+					1e3 * result.p50, 1e3 * result.p99, 1e3 * result.max,
+					result.peakBytes, result.maxrss, result.pathcost, result.status,
+					result.slices, 1e3 * result.sliceMax, 1e3 * result.first, result.firstBound);
+				fflush(out);
+
+				printf("%-8s %5d %-7s %4d replans %3d limits %10" PRId64 " + %10" PRId64 " expanded %12.0f/s"
+				       "  p50 %9.3f p99 %9.3f max %9.3f ms  %9.1f MB  %s\n",
+				       gblMapName[m], size, gblEngineName[e], result.replans, result.limits,
+				       result.expanded[0], result.expanded[1],
+				       (result.expanded[0] + result.expanded[1]) / (result.seconds[0] + result.seconds[1]),
+				       1e3 * result.p50, 1e3 * result.p99, 1e3 * result.max,
+				       result.peakBytes / 1e6, result.status);
+				if(gblBudget > 0)
+					printf("%-8s %5d %-7s %10" PRId64 " slices of at most %" PRId64 " us, longest %.3f ms\n",
+					       gblMapName[m], size, gblEngineName[e], result.slices, gblBudget, 1e3 * result.sliceMax);
+				if(e == DSTAR_ENGINE_ANYTIME)
+					printf("%-8s %5d %-7s first path in %.3f ms within %.2f of optimal, optimal in %.3f ms\n",
+					       gblMapName[m], size, gblEngineName[e], 1e3 * result.first, result.firstBound,
+					       1e3 * result.seconds[0]);
+				fflush(stdout);
+
+				DMapDestroy(gblMap);
+			}
+		}
+	}
+
+	fclose(out);
+
+	return(0);
+}
@@ -0,0 +1,247 @@
+/*
+  Sparse tiled store of grid nodes.
+
+  The table is open addressing with linear probing on the packed tile
+  coordinates.  Tiles only leave it when a new search starts, and then
+  the table is rebuilt from the tiles that stay, so there are never any
+  deleted slots to probe past.
+*/
+
+#include <stdlib.h>
+#include "dtile.h"
+
+typedef struct DTile {
+  int32_t         tx, ty;		       // tile coordinates
+  uint32_t        used;			       // search that last touched it
+  struct DTile   *next;			       // on the spare list
+  Node            node[];		       // side * side, row-major
+} DTile;
+
+struct DTileStore {
+  int             shift;		       // log2 of the side
+  int             keep;
+  uint32_t        search;		       // advances with each new search
+  DTile         **slot;			       // the table, NULL for an empty slot
+  int64_t         numSlots;		       // a power of two
+  int64_t         numTiles;
+  DTile          *last;			       // the tile used last, NULL if none
+  DTile          *spare;		       // recycled tiles
+  int64_t         numSpares;
+  int64_t         made;
+  int64_t         reused;
+  int64_t         recycled;
+};
+
+#define TILEKEY(tx, ty) (((uint64_t)(uint32_t)(ty) << 32) | (uint32_t)(tx))
+
+static size_t   tileBytes(const DTileStore * store)
+{
+  return (sizeof(DTile) + sizeof(Node) * ((size_t) 1 << (2 * store->shift)));
+}
+
+// first slot to probe for a tile, from a multiplicative hash of its key
+static int64_t  home(const DTileStore * store, int32_t tx, int32_t ty)
+{
+  uint64_t        key = TILEKEY(tx, ty) * 0x9e3779b97f4a7c15ull;
+
+  return ((int64_t) (key >> 32) & (store->numSlots - 1));
+}
+
+// the slot of the tile, or the empty slot it would go in
+static int64_t  probe(const DTileStore * store, int32_t tx, int32_t ty)
+{
+  int64_t         i;
+  DTile          *tile;
+
+  for (i = home(store, tx, ty);; i = (i + 1) & (store->numSlots - 1)) {
+    tile = store->slot[i];
+    if (tile == NULL || (tile->tx == tx && tile->ty == ty))
+      return (i);
+  }
+}
+
+// A table of numSlots slots holding the tiles of the old one.  With
+// recycle, only those used in or after search since stay and the rest go
+// on the spare list.  -1 if there is not enough memory, with the old table
+// left as it was.
+static int      rebuild(DTileStore * store, int64_t numSlots, int recycle, uint32_t since)
+{
+  DTile         **old = store->slot;
+  int64_t         oldSlots = store->numSlots, i;
+  DTile          *tile;
+
+  store->slot = (DTile **) calloc(numSlots, sizeof(DTile *));
+  if (store->slot == NULL) {
+    store->slot = old;
+    return (-1);
+  }
+  store->numSlots = numSlots;
+  store->numTiles = 0;
+
+  for (i = 0; i < oldSlots; i++) {
+    tile = old[i];
+    if (tile == NULL)
+      continue;
+    if (recycle && (int32_t) (tile->used - since) < 0) {
+      tile->next = store->spare;
+      store->spare = tile;
+      store->numSpares++;
+      store->recycled++;
+      continue;
+    }
+    store->slot[probe(store, tile->tx, tile->ty)] = tile;
+    store->numTiles++;
+  }
+  free(old);
+
+  return (0);
+}
+
+// every node of the tile NEW, for this search
+static void     resetTile(DTileStore * store, DTile * tile)
+{
+  int             side = 1 << store->shift, x, y;
+  Node           *n = tile->node;
+
+  for (y = 0; y < side; y++) {
+    for (x = 0; x < side; x++, n++) {
+      n->id = DTILE_ID((int64_t) tile->tx * side + x, (int64_t) tile->ty * side + y);
+      n->state = NEW;
+      n->parent = NULL;
+      n->openIndex = -1;
+      n->nodeInfo = NULL;
+    }
+  }
+  tile->used = store->search;
+}
+
+DTileStore     *DTileStoreCreate(int side, int keep)
+{
+  DTileStore     *store;
+  int             shift;
+
+  for (shift = 2; shift <= 10 && side != 1 << shift; shift++)
+    ;
+  if (shift > 10 || keep < 0)
+    return (NULL);
+
+  store = (DTileStore *) calloc(1, sizeof(DTileStore));
+  if (store == NULL)
+    return (NULL);
+  store->shift = shift;
+  store->keep = keep;
+  store->numSlots = 256;
+  store->slot = (DTile **) calloc(store->numSlots, sizeof(DTile *));
+  if (store->slot == NULL) {
+    free(store);
+    return (NULL);
+  }
+
+  return (store);
+}
+
+static void     freeSpares(DTileStore * store)
+{
+  DTile          *tile;
+
+  while (store->spare != NULL) {
+    tile = store->spare;
+    store->spare = tile->next;
+    free(tile);
+  }
+  store->numSpares = 0;
+}
+
+void            DTileStoreDestroy(DTileStore * store)
+{
+  int64_t         i;
+
+  if (store == NULL)
+    return;
+
+  for (i = 0; i < store->numSlots; i++)
+    free(store->slot[i]);
+  freeSpares(store);
+  free(store->slot);
+  free(store);
+}
+
+Node           *DTileStoreNode(DTileStore * store, int32_t x, int32_t y)
+{
+  int32_t         tx = x >> store->shift, ty = y >> store->shift;
+  int             mask = (1 << store->shift) - 1;
+  DTile          *tile = store->last;
+  int64_t         i;
+
+  if (tile == NULL || tile->tx != tx || tile->ty != ty) {
+    i = probe(store, tx, ty);
+    tile = store->slot[i];
+    if (tile == NULL) {
+      // keep the table at most half full
+      if (2 * (store->numTiles + 1) > store->numSlots) {
+	if (rebuild(store, 2 * store->numSlots, 0, 0) < 0)
+	  return (NULL);
+	i = probe(store, tx, ty);
+      }
+      if (store->spare != NULL) {
+	tile = store->spare;
+	store->spare = tile->next;
+	store->numSpares--;
+	store->reused++;
+      }
+      else {
+	tile = (DTile *) malloc(tileBytes(store));
+	if (tile == NULL)
+	  return (NULL);
+	store->made++;
+      }
+      tile->tx = tx;
+      tile->ty = ty;
+      tile->used = store->search - 1;
+      store->slot[i] = tile;
+      store->numTiles++;
+    }
+    store->last = tile;
+  }
+  if (tile->used != store->search)
+    resetTile(store, tile);
+
+  return (&tile->node[((y & mask) << store->shift) | (x & mask)]);
+}
+
+Node           *DTileStoreFind(const DTileStore * store, int32_t x, int32_t y)
+{
+  int             mask = (1 << store->shift) - 1;
+  DTile          *tile;
+
+  tile = store->slot[probe(store, x >> store->shift, y >> store->shift)];
+  if (tile == NULL)
+    return (NULL);
+
+  return (&tile->node[((y & mask) << store->shift) | (x & mask)]);
+}
+
+void            DTileStoreNewSearch(DTileStore * store)
+{
+  // spares the last search did not reuse are freed, then the tiles the
+  // searches since search - keep have not touched become the new spares
+  freeSpares(store);
+  rebuild(store, store->numSlots, 1, store->search - store->keep);
+  store->search++;
+  store->last = NULL;
+}
+
+void            DTileStoreStats(const DTileStore * store, DTileStats * stats)
+{
+  stats->tiles = store->numTiles;
+  stats->spares = store->numSpares;
+  stats->made = store->made;
+  stats->reused = store->reused;
+  stats->recycled = store->recycled;
+}
+
+size_t          DTileStoreBytes(const DTileStore * store)
+{
+  return (sizeof(DTileStore) + sizeof(DTile *) * store->numSlots +
+	  tileBytes(store) * (store->numTiles + store->numSpares));
+}
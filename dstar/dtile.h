@@ -0,0 +1,70 @@
+// Include file for the sparse tiled store of grid nodes
+
+#ifndef DTILE_H
+#define DTILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "dstar.h"
+
+// A store holds the Node structs of an 8-connected grid with no edges: any
+// (x, y) that fits in 32 bits.  Nodes come in square tiles of side x side,
+// and a tile is only made the first time one of its nodes is asked for, so
+// the memory follows the area the searches reach, not the size of the
+// world.  Tiles sit in a hash table on their tile coordinates, and the
+// last tile used is looked at first, so most of the neighbors of a node
+// cost no lookup at all.
+//
+// Each search is a generation.  DTileStoreNewSearch starts one before
+// DStarPlannerSearch: a tile touched in an older generation has all its
+// nodes made NEW again the first time the new one touches it, so a new
+// search never walks the whole store.  Tiles the last keep + 1 searches
+// have not touched are recycled: they are taken out of the table and
+// reused for the next tiles made, and the ones that are not reused by the
+// search after are freed.  Within a search and its replans nothing is
+// recycled, since D* relies on every node it has reached staying as it
+// left it.
+typedef struct DTileStore DTileStore;
+
+// A node's id packs its coordinates, so callbacks can find them without
+// any node info; ids of cells with negative coordinates are negative too
+#define DTILE_ID(x, y) ((int64_t)(((uint64_t)(uint32_t)(y) << 32) | (uint32_t)(x)))
+#define DTILE_X(id) ((int32_t)(uint32_t)(id))
+#define DTILE_Y(id) ((int32_t)((id) >> 32))
+
+// what the store holds
+typedef struct {
+  int64_t         tiles;		       // in the table
+  int64_t         spares;		       // recycled and not yet reused
+  int64_t         made;			       // allocated since the store was created
+  int64_t         reused;		       // recycled tiles given out again
+  int64_t         recycled;		       // taken out of the table
+} DTileStats;
+
+// function prototypes
+
+// A store of tiles side nodes across, a power of two from 4 to 1024,
+// keeping tiles through keep searches that do not touch them.  NULL if
+// side is not one or there is not enough memory.
+DTileStore *DTileStoreCreate(int side, int keep);
+void DTileStoreDestroy(DTileStore *store);
+
+// The node at (x, y), made NEW with its id set if this search has not
+// touched it yet.  NULL if its tile cannot be made; a neighbors callback
+// leaves such a node out.
+Node *DTileStoreNode(DTileStore *store, int32_t x, int32_t y);
+
+// the node if its tile is in the store, whatever its generation; NULL if not
+Node *DTileStoreFind(const DTileStore *store, int32_t x, int32_t y);
+
+// Start a new generation and recycle the tiles left behind, before a new
+// search.  The nodes of the last one must not be used after, so the
+// planner must have let go of them with DStarPlannerReset first.
+void DTileStoreNewSearch(DTileStore *store);
+
+void DTileStoreStats(const DTileStore *store, DTileStats *stats);
+
+// memory used by the store, tiles and table
+size_t DTileStoreBytes(const DTileStore *store);
+
+#endif
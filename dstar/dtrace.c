@@ -0,0 +1,255 @@
+/*
+  Binary event trace of planner sessions.
+
+  A record is built in a scratch buffer of its own and then copied into
+  the ring in one go, so the ring only ever holds whole records and the
+  oldest one can always be found at head.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dtrace.h"
+
+struct DTrace {
+  unsigned char  *ring;
+  size_t          capacity;
+  size_t          head;			       // offset of the oldest record
+  size_t          used;			       // bytes of records in the ring
+  FILE           *out;			       // NULL to keep only the latest records
+  unsigned char  *record;		       // the record being built
+  size_t          recordBytes;
+  size_t          recordCapacity;
+  int             recordType;
+  int             recordFailed;		       // the scratch buffer could not grow
+  int64_t         dropped;
+};
+
+DTrace         *DTraceCreate(size_t capacity, FILE * out)
+{
+  DTrace         *trace;
+
+  if (capacity < sizeof(DTraceHeader))
+    return (NULL);
+
+  trace = (DTrace *) calloc(1, sizeof(DTrace));
+  if (trace == NULL)
+    return (NULL);
+
+  trace->ring = (unsigned char *) malloc(capacity);
+  if (trace->ring == NULL) {
+    free(trace);
+    return (NULL);
+  }
+  trace->capacity = capacity;
+  trace->out = out;
+
+  if (out != NULL && fwrite(DTRACE_MAGIC, 1, sizeof(DTRACE_MAGIC), out) != sizeof(DTRACE_MAGIC)) {
+    DTraceDestroy(trace);
+    return (NULL);
+  }
+
+  return (trace);
+}
+
+void            DTraceDestroy(DTrace * trace)
+{
+  if (trace == NULL)
+    return;
+
+  DTraceFlush(trace);
+  free(trace->ring);
+  free(trace->record);
+  free(trace);
+}
+
+// copy bytes into the ring at offset at, wrapping around the end
+static void     ringPut(DTrace * trace, size_t at, const void *data, size_t bytes)
+{
+  size_t          first;
+
+  at %= trace->capacity;
+  first = trace->capacity - at < bytes ? trace->capacity - at : bytes;
+  memcpy(trace->ring + at, data, first);
+  memcpy(trace->ring, (const unsigned char *)data + first, bytes - first);
+}
+
+static void     ringGet(const DTrace * trace, size_t at, void *data, size_t bytes)
+{
+  size_t          first;
+
+  at %= trace->capacity;
+  first = trace->capacity - at < bytes ? trace->capacity - at : bytes;
+  memcpy(data, trace->ring + at, first);
+  memcpy((unsigned char *)data + first, trace->ring, bytes - first);
+}
+
+// write the records in the ring, oldest first
+static int      ringWrite(const DTrace * trace, FILE * fp)
+{
+  size_t          first;
+
+  first = trace->capacity - trace->head < trace->used ? trace->capacity - trace->head : trace->used;
+  if (fwrite(trace->ring + trace->head, 1, first, fp) != first)
+    return (-1);
+  if (fwrite(trace->ring, 1, trace->used - first, fp) != trace->used - first)
+    return (-1);
+
+  return (0);
+}
+
+void            DTraceBegin(DTrace * trace, int type)
+{
+  trace->recordType = type;
+  trace->recordBytes = 0;
+  trace->recordFailed = 0;
+}
+
+void            DTraceAppend(DTrace * trace, const void *data, size_t bytes)
+{
+  size_t          capacity;
+  unsigned char  *record;
+
+  if (trace->recordFailed)
+    return;
+
+  // the header gives the size in 32 bits, so a bigger record is dropped
+  if (bytes > UINT32_MAX - trace->recordBytes) {
+    trace->recordFailed = 1;
+    return;
+  }
+
+  if (trace->recordBytes + bytes > trace->recordCapacity) {
+    capacity = trace->recordCapacity > 0 ? 2 * trace->recordCapacity : 256;
+    while (capacity < trace->recordBytes + bytes)
+      capacity *= 2;
+    record = (unsigned char *) realloc(trace->record, capacity);
+    if (record == NULL) {
+      trace->recordFailed = 1;
+      return;
+    }
+    trace->record = record;
+    trace->recordCapacity = capacity;
+  }
+
+  memcpy(trace->record + trace->recordBytes, data, bytes);
+  trace->recordBytes += bytes;
+}
+
+void            DTraceEnd(DTrace * trace)
+{
+  DTraceHeader    header, oldest;
+  size_t          total;
+
+  if (trace->recordFailed || trace->recordBytes > UINT32_MAX) {
+    trace->dropped++;
+    return;
+  }
+
+  header.type = (uint32_t) trace->recordType;
+  header.bytes = (uint32_t) trace->recordBytes;
+  total = sizeof(header) + trace->recordBytes;
+
+  if (trace->out != NULL) {
+    if (trace->used + total > trace->capacity && DTraceFlush(trace) < 0)
+      trace->dropped++;
+
+    // a record larger than the whole ring goes straight to the file
+    if (total > trace->capacity) {
+      if (fwrite(&header, sizeof(header), 1, trace->out) != 1 ||
+	  fwrite(trace->record, 1, trace->recordBytes, trace->out) != trace->recordBytes)
+	trace->dropped++;
+      return;
+    }
+  }
+  else {
+    if (total > trace->capacity) {
+      trace->dropped++;
+      return;
+    }
+
+    // make room by dropping the oldest records
+    while (trace->used + total > trace->capacity) {
+      ringGet(trace, trace->head, &oldest, sizeof(oldest));
+      trace->head = (trace->head + sizeof(oldest) + oldest.bytes) % trace->capacity;
+      trace->used -= sizeof(oldest) + oldest.bytes;
+      trace->dropped++;
+    }
+  }
+
+  ringPut(trace, trace->head + trace->used, &header, sizeof(header));
+  ringPut(trace, trace->head + trace->used + sizeof(header), trace->record, trace->recordBytes);
+  trace->used += total;
+}
+
+void            DTraceRecord(DTrace * trace, int type, const void *data, size_t bytes)
+{
+  DTraceBegin(trace, type);
+  DTraceAppend(trace, data, bytes);
+  DTraceEnd(trace);
+}
+
+int             DTraceFlush(DTrace * trace)
+{
+  int             result = 0;
+
+  if (trace->out == NULL)
+    return (0);
+
+  if (ringWrite(trace, trace->out) < 0 || fflush(trace->out) != 0)
+    result = -1;
+  trace->head = 0;
+  trace->used = 0;
+
+  return (result);
+}
+
+int             DTraceSave(const DTrace * trace, FILE * fp)
+{
+  if (fwrite(DTRACE_MAGIC, 1, sizeof(DTRACE_MAGIC), fp) != sizeof(DTRACE_MAGIC))
+    return (-1);
+
+  return (ringWrite(trace, fp));
+}
+
+int64_t         DTraceDropped(const DTrace * trace)
+{
+  return (trace->dropped);
+}
+
+int             DTraceReadMagic(FILE * fp)
+{
+  char            magic[sizeof(DTRACE_MAGIC)];
+
+  if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic) || memcmp(magic, DTRACE_MAGIC, sizeof(magic)) != 0)
+    return (-1);
+
+  return (0);
+}
+
+int             DTraceRead(FILE * fp, unsigned char **buf, size_t * capacity, size_t * bytes)
+{
+  DTraceHeader    header;
+  unsigned char  *grown;
+  size_t          n;
+
+  n = fread(&header, 1, sizeof(header), fp);
+  if (n == 0 && feof(fp))
+    return (0);
+  if (n != sizeof(header) || header.type == 0)
+    return (-1);
+
+  if (header.bytes > *capacity) {
+    grown = (unsigned char *) realloc(*buf, header.bytes);
+    if (grown == NULL)
+      return (-1);
+    *buf = grown;
+    *capacity = header.bytes;
+  }
+
+  if (fread(*buf, 1, header.bytes, fp) != header.bytes)
+    return (-1);
+  *bytes = header.bytes;
+
+  return ((int) header.type);
+}
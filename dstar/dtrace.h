@@ -0,0 +1,143 @@
+// Include file for the binary event trace of planner sessions
+
+#ifndef DTRACE_H
+#define DTRACE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A trace file is DTRACE_MAGIC followed by records, each a DTraceHeader
+// and then bytes of payload.  Everything is in the byte order of the
+// machine that wrote it.
+#define DTRACE_MAGIC "DTRACE2"		// 8 bytes with the terminating 0
+
+// record types and their payloads
+#define DTRACE_MAP      1	// DTraceMap, the occupancy words, then the terrain floats if any
+#define DTRACE_RECT     2	// DTraceRect
+#define DTRACE_CELL     3	// DTraceCell
+#define DTRACE_TERRAIN  4	// DTraceTerrain
+#define DTRACE_ROBOT    5	// int64_t cell the robot is at, from the caller
+#define DTRACE_CREATE   6	// DTraceParams, when the trace is given to a planner
+#define DTRACE_SEARCH   7	// DTraceCall, then num DTraceSeed
+#define DTRACE_REPLAN   8	// DTraceCall, then num int64_t changed nodes
+#define DTRACE_ROBOTAT  9	// int64_t node given to DStarPlannerRobotAt
+#define DTRACE_MOVED   10	// int64_t node given to DStarPlannerRobotMoved
+#define DTRACE_RESULT  11	// DTraceResult of the call before it
+#define DTRACE_BUDGET  12	// DTraceBudget given to DStarPlannerBudget
+#define DTRACE_RESUME  13	// DTraceCall with num 0
+#define DTRACE_IMPROVE 14	// DTraceCall with num 0
+#define DTRACE_QUERY   15	// DTraceCall, then num int64_t start nodes; its result's path is the total length
+
+typedef struct {
+  uint32_t type;
+  uint32_t bytes;		// of the payload
+} DTraceHeader;
+
+// a keyframe of the whole map
+typedef struct {
+  int64_t width;
+  int64_t height;
+  int64_t terrain;		// 1 if width * height floats follow the bits
+} DTraceMap;
+
+// a rectangle added (occupied 1) or cleared (0)
+typedef struct {
+  int64_t top, left, bottom, right;
+  int64_t occupied;
+} DTraceRect;
+
+typedef struct {
+  int64_t cell;
+  int64_t occupied;
+} DTraceCell;
+
+typedef struct {
+  int64_t cell;
+  double multiplier;
+} DTraceTerrain;
+
+// nodes are cell indices for an index planner and Node ids otherwise
+typedef struct {
+  int64_t numNodes;		// 0 for a planner on Node structs
+  int64_t maxExpand;
+  int64_t maxNeighbors;
+  int64_t engine;
+  double epsilon;
+  double epsilonStep;
+} DTraceParams;
+
+typedef struct {
+  int64_t num;			// goals or changed nodes that follow
+  double costR[2];		// as passed in
+} DTraceCall;
+
+typedef struct {
+  int64_t node;
+  double g;
+} DTraceSeed;
+
+typedef struct {
+  int64_t expansions;
+  int64_t microseconds;
+} DTraceBudget;
+
+typedef struct {
+  int64_t status;
+  int64_t path;			// -1 if none
+  int64_t expanded;
+  double costR[2];		// as passed back
+  double bound;			// DStarPlannerBound after the call
+} DTraceResult;
+
+// The records go into a ring buffer of a fixed size.  With a file to
+// write to, the ring is written out whenever the next record does not fit,
+// so the file holds the whole session.  Without one, the oldest records
+// are dropped to make room and the ring keeps the most recent ones until
+// DTraceSave writes them out.
+//
+// The map keyframe and the planner's DTRACE_CREATE are only recorded when
+// DMapTrace and DStarPlannerTrace are called, and a replan can only be
+// replayed from the search it follows, so they are among the first records
+// a ring drops.  A caller keeping a ring to reproduce a bad replan calls
+// both again, and records DTRACE_ROBOT, before every new search; the ring
+// then replays from the oldest search whose keyframe it still holds, and
+// must be big enough for one search and the calls after it.
+typedef struct DTrace DTrace;
+
+// function prototypes
+
+// a trace with a ring of capacity bytes, writing to out if it is not NULL;
+// NULL if there is not enough memory or the file header cannot be written
+DTrace *DTraceCreate(size_t capacity, FILE *out);
+
+// flushes a trace with a file, then frees it; the file is left open
+void DTraceDestroy(DTrace *trace);
+
+// a record built from any number of pieces: begin it, append the payload,
+// then end it to put it in the ring
+void DTraceBegin(DTrace *trace, int type);
+void DTraceAppend(DTrace *trace, const void *data, size_t bytes);
+void DTraceEnd(DTrace *trace);
+
+// a record of one piece
+void DTraceRecord(DTrace *trace, int type, const void *data, size_t bytes);
+
+// write what is in the ring to the file; -1 if a write failed
+int DTraceFlush(DTrace *trace);
+
+// write the records in the ring to fp as a trace file; -1 if a write failed
+int DTraceSave(const DTrace *trace, FILE *fp);
+
+// records dropped from the ring, or lost to a failed write or allocation,
+// or of 4 GiB or more, which a record header cannot give the size of
+int64_t DTraceDropped(const DTrace *trace);
+
+// Reading a trace file: check the magic, then read one record at a time
+// into *buf, which is grown as needed (start with NULL and 0).  DTraceRead
+// gives the type of the record and sets *bytes to its size, or gives 0 at
+// the end of the file and -1 on a short or unreadable record.
+int DTraceReadMagic(FILE *fp);
+int DTraceRead(FILE *fp, unsigned char **buf, size_t *capacity, size_t *bytes);
+
+#endif